@@ -5,6 +5,20 @@
 
 #define STARTING_SIZE 64
 
+namespace
+{
+	// Highest bit a value in [0, max] can have set, or 0 when max needs no bits at all
+	uint32_t getRangedBit(uint32_t max)
+	{
+		uint32_t bit = max ? 1U : 0U;
+
+		while (bit && bit <= (max >> 1))
+			bit <<= 1;
+
+		return bit;
+	}
+}
+
 namespace TechDemo
 {
 	namespace IO
@@ -128,5 +142,25 @@ namespace TechDemo
 			writeLock.unlock();
 			readLock.unlock();
 		}
+
+		void BitStream::writeRanged(uint32_t value, uint32_t max)
+		{
+			for (uint32_t bit = getRangedBit(max); bit; bit >>= 1)
+				write((value & bit) != 0U, 1);
+		}
+
+		void BitStream::readRanged(uint32_t& value, uint32_t max)
+		{
+			value = 0U;
+
+			for (uint32_t bit = getRangedBit(max); bit; bit >>= 1)
+			{
+				bool set = false;
+				read(set, 1);
+
+				if (set)
+					value |= bit;
+			}
+		}
 	}
 }
\ No newline at end of file
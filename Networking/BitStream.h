@@ -377,6 +377,11 @@ namespace TechDemo
 
 				void trim(size_t bits);
 
+				// Writes a value in [0, max] using only as many bits as max needs
+				void writeRanged(uint32_t value, uint32_t max);
+
+				void readRanged(uint32_t& value, uint32_t max);
+
 				static bool equals(BitStream const& lhs, BitStream const& rhs)
 				{
 					return lhs == rhs;
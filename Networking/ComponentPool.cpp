@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "Component.h"
+#include "ComponentPool.h"
+#include "RTTI.h"
+
+namespace TechDemo
+{
+	namespace World
+	{
+		std::unordered_map<uint32_t, std::shared_ptr<ComponentPool::Pool>> ComponentPool::pools;
+		std::mutex ComponentPool::poolsLock;
+
+		std::shared_ptr<ComponentBase> ComponentPool::create(uint32_t typeHash)
+		{
+			static const uint32_t baseHash = Util::CRC32::checksum(Util::getQualifiedName<ComponentBase>());
+
+			std::shared_ptr<Pool> pool = getPool(typeHash);
+			if (!pool)
+				return ComponentBase::create(typeHash);
+
+			Util::RTTI::Type const* type = Util::RTTI::getType(typeHash);
+			int32_t baseOffset = type->getBaseOffset(baseHash).second;
+			void (*destroyer)(char*) = type->destroyer;
+
+			char* memory = type->placer(pool->acquire());
+
+			// The pool is kept alive by its components, so those outliving the static map are still returned safely
+			return std::shared_ptr<ComponentBase>(reinterpret_cast<ComponentBase*>(memory + baseOffset), [pool, destroyer, memory](ComponentBase*)
+			{
+				destroyer(memory);
+				pool->release(memory);
+			});
+		}
+
+		void ComponentPool::prewarm(uint32_t typeHash, size_t count)
+		{
+			if (std::shared_ptr<Pool> pool = getPool(typeHash))
+			{
+				std::lock_guard guard(pool->lock);
+
+				if (pool->free.size() < count)
+					pool->grow(count - pool->free.size());
+			}
+		}
+
+		std::shared_ptr<ComponentPool::Pool> ComponentPool::getPool(uint32_t typeHash)
+		{
+			static const uint32_t baseHash = Util::CRC32::checksum(Util::getQualifiedName<ComponentBase>());
+
+			std::lock_guard guard(poolsLock);
+
+			auto iter = pools.find(typeHash);
+			if (iter != pools.end())
+				return iter->second;
+
+			// Unpoolable types are remembered as well, so they are only looked up once
+			std::shared_ptr<Pool>& pool = pools[typeHash];
+			Util::RTTI::Type const* type = Util::RTTI::getType(typeHash);
+
+			if (type && type->placer && type->destroyer && type->size && type->getBaseOffset(baseHash).first)
+			{
+				// Rounded up so that every block in a chunk stays aligned for the type
+				size_t alignment = std::max<size_t>(type->alignment, 1);
+				size_t bytes = (type->size + Util::byteSize() - 1) / Util::byteSize();
+
+				pool = std::make_shared<Pool>();
+				pool->alignment = alignment;
+				pool->blockSize = (bytes + alignment - 1) / alignment * alignment;
+			}
+
+			return pool;
+		}
+
+		char* ComponentPool::Pool::acquire()
+		{
+			std::lock_guard guard(lock);
+
+			if (free.empty())
+				grow(COMPONENT_POOL_CHUNK);
+
+			char* block = free.back();
+			free.pop_back();
+
+			return block;
+		}
+
+		void ComponentPool::Pool::release(char* block)
+		{
+			std::lock_guard guard(lock);
+			free.push_back(block);
+		}
+
+		void ComponentPool::Pool::grow(size_t blocks)
+		{
+			// Over-allocated, as types may be aligned beyond what new guarantees
+			chunks.emplace_back(new char[blockSize * blocks + alignment - 1]);
+			free.reserve(free.size() + blocks);
+
+			char* first = chunks.back().get();
+			first += (alignment - reinterpret_cast<uintptr_t>(first) % alignment) % alignment;
+
+			for (size_t i = 0; i < blocks; ++i)
+				free.push_back(first + i * blockSize);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Hash.h"
+#include "Util.h"
+
+#define COMPONENT_POOL_CHUNK 32	// Blocks a pool grows by when it runs dry
+
+namespace TechDemo
+{
+	namespace World
+	{
+		class ComponentBase;	//!< Forward declaration
+
+		// Type-segregated pools for the components created while spawning objects. Each registered component type gets its
+		// own free list of blocks sized from its RTTI size, and a component's block is recycled rather than freed once its
+		// last reference is dropped, such as when its object is removed from the scene. Types RTTI cannot construct in place
+		// fall back to ComponentBase::create.
+		class ComponentPool
+		{
+			public:
+				ComponentPool() = delete;
+
+				static std::shared_ptr<ComponentBase> create(uint32_t typeHash);
+
+				// Grows the type's pool until it holds at least count free blocks
+				static void prewarm(uint32_t typeHash, size_t count);
+
+				template <typename T>
+				static void prewarm(size_t count)
+				{
+					prewarm(Util::CRC32::checksum(Util::getQualifiedName<T>()), count);
+				}
+
+			private:
+				struct Pool
+				{
+					size_t blockSize = 0;
+					size_t alignment = 1;
+					std::vector<std::unique_ptr<char[]>> chunks;
+					std::vector<char*> free;
+					std::mutex lock;
+
+					char* acquire();
+
+					void release(char* block);
+
+					void grow(size_t blocks);
+				};
+
+				// Returns nullptr for types which cannot be pooled
+				static std::shared_ptr<Pool> getPool(uint32_t typeHash);
+
+				static std::unordered_map<uint32_t, std::shared_ptr<Pool>> pools;
+				static std::mutex poolsLock;
+		};
+	}
+}
\ No newline at end of file
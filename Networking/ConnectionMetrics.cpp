@@ -0,0 +1,242 @@
+#include <algorithm>
+
+#include <intrin.h>
+
+#include "ConnectionMetrics.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		void LatencyHistogram::record(unsigned long long value)
+		{
+			counts[getBucket(value)].fetch_add(1ULL, std::memory_order_relaxed);
+			count.fetch_add(1ULL, std::memory_order_relaxed);
+
+			for (unsigned long long current = max.load(std::memory_order_relaxed); value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed););
+		}
+
+		unsigned long long LatencyHistogram::getPercentile(float percentile) const
+		{
+			unsigned long long total = count.load(std::memory_order_relaxed);
+
+			if (!total)
+				return 0ULL;
+
+			unsigned long long target = std::max(1ULL, static_cast<unsigned long long>(std::clamp(percentile, 0.0f, 1.0f) * total + 0.5f));
+			unsigned long long seen = 0ULL;
+
+			for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+			{
+				if ((seen += counts[bucket].load(std::memory_order_relaxed)) >= target)
+					return std::min(getValue(bucket), getMax());
+			}
+
+			return getMax();
+		}
+
+		unsigned long long LatencyHistogram::getCount() const
+		{
+			return count.load(std::memory_order_relaxed);
+		}
+
+		unsigned long long LatencyHistogram::getMax() const
+		{
+			return max.load(std::memory_order_relaxed);
+		}
+
+		size_t LatencyHistogram::getBucket(unsigned long long value)
+		{
+			constexpr unsigned long long subBuckets = 1ULL << HISTOGRAM_SUB_BUCKET_BITS;
+
+			if (value < subBuckets)
+				return static_cast<size_t>(value);
+
+			unsigned long magnitude = 0;
+			_BitScanReverse64(&magnitude, value);
+
+			unsigned long shift = magnitude - HISTOGRAM_SUB_BUCKET_BITS;
+
+			return std::min(static_cast<size_t>((static_cast<unsigned long long>(shift) << HISTOGRAM_SUB_BUCKET_BITS) + (value >> shift)), bucketCount - 1);
+		}
+
+		unsigned long long LatencyHistogram::getValue(size_t bucket)
+		{
+			constexpr size_t subBuckets = 1ULL << HISTOGRAM_SUB_BUCKET_BITS;
+
+			if (bucket < subBuckets)
+				return bucket;
+
+			size_t shift = (bucket >> HISTOGRAM_SUB_BUCKET_BITS) - 1;
+			unsigned long long top = (bucket & (subBuckets - 1)) + subBuckets;
+
+			return ((top + 1ULL) << shift) - 1ULL;	// Upper bound of the bucket
+		}
+
+		void ConnectionMetrics::recordSent(Channel channel, size_t bytes)
+		{
+			ChannelCounters& counters = channels[static_cast<size_t>(channel)];
+			counters.bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+			counters.packetsSent.fetch_add(1ULL, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordReceived(Channel channel, size_t bytes)
+		{
+			ChannelCounters& counters = channels[static_cast<size_t>(channel)];
+			counters.bytesRcvd.fetch_add(bytes, std::memory_order_relaxed);
+			counters.packetsRcvd.fetch_add(1ULL, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordDatagramSent(size_t bytes)
+		{
+			bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+			packetsSent.fetch_add(1ULL, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordDatagramReceived(size_t bytes)
+		{
+			bytesRcvd.fetch_add(bytes, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordResent(size_t bytes)
+		{
+			bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+			packetsResent.fetch_add(1ULL, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordLost(unsigned long count)
+		{
+			packetsLost.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordDuplicated()
+		{
+			packetsDuplicated.fetch_add(1ULL, std::memory_order_relaxed);
+		}
+
+		void ConnectionMetrics::recordHandlerQueueDepth(size_t depth)
+		{
+			handlerQueueDepth.store(depth, std::memory_order_relaxed);
+
+			size_t current = handlerQueueDepthMax.load(std::memory_order_relaxed);
+			while (depth > current && !handlerQueueDepthMax.compare_exchange_weak(current, depth, std::memory_order_relaxed));
+		}
+
+		LatencyHistogram& ConnectionMetrics::getRTT()
+		{
+			return rtt;
+		}
+
+		LatencyHistogram& ConnectionMetrics::getQueueDelay()
+		{
+			return queueDelay;
+		}
+
+		LatencyHistogram& ConnectionMetrics::getReassemblyDelay()
+		{
+			return reassemblyDelay;
+		}
+
+		ConnectionMetrics::Totals ConnectionMetrics::getTotals() const
+		{
+			Totals totals;
+			totals.bytesSent = bytesSent.load(std::memory_order_relaxed);
+			totals.bytesRcvd = bytesRcvd.load(std::memory_order_relaxed);
+			totals.packetsSent = packetsSent.load(std::memory_order_relaxed);
+			totals.packetsResent = packetsResent.load(std::memory_order_relaxed);
+			totals.packetsLost = packetsLost.load(std::memory_order_relaxed);
+			totals.packetsDuplicated = packetsDuplicated.load(std::memory_order_relaxed);
+
+			return totals;
+		}
+
+		void ConnectionMetrics::sample()
+		{
+			Totals totals = getTotals();
+			Sample& entry = history[historyIndex.load(std::memory_order_relaxed) % METRICS_HISTORY];
+
+			entry.bytesSent.store(static_cast<unsigned long>(totals.bytesSent - lastTotals.bytesSent), std::memory_order_relaxed);
+			entry.bytesRcvd.store(static_cast<unsigned long>(totals.bytesRcvd - lastTotals.bytesRcvd), std::memory_order_relaxed);
+			entry.packetsSent.store(static_cast<unsigned long>(totals.packetsSent - lastTotals.packetsSent), std::memory_order_relaxed);
+			entry.packetsResent.store(static_cast<unsigned long>(totals.packetsResent - lastTotals.packetsResent), std::memory_order_relaxed);
+			entry.packetsLost.store(static_cast<unsigned long>(totals.packetsLost - lastTotals.packetsLost), std::memory_order_relaxed);
+			entry.packetsDuplicated.store(static_cast<unsigned long>(totals.packetsDuplicated - lastTotals.packetsDuplicated), std::memory_order_relaxed);
+
+			historyIndex.fetch_add(1U, std::memory_order_release);
+			lastTotals = totals;
+		}
+
+		void ConnectionMetrics::writeJSON(std::ostream& stream, std::string const& name) const
+		{
+			Totals totals = getTotals();
+
+			stream << "{\"connection\":\"" << name << "\",";
+			stream << "\"bytesSent\":" << totals.bytesSent << ",\"bytesRcvd\":" << totals.bytesRcvd << ",\"packetsSent\":" << totals.packetsSent << ",\"packetsResent\":" << totals.packetsResent << ",\"packetsLost\":" << totals.packetsLost << ",\"packetsDuplicated\":" << totals.packetsDuplicated << ",";
+			stream << "\"handlerQueueDepth\":" << handlerQueueDepth << ",\"handlerQueueDepthMax\":" << handlerQueueDepthMax << ",";
+
+			stream << "\"channels\":{";
+			for (size_t channel = 0; channel < static_cast<size_t>(Channel::Count); ++channel)
+			{
+				ChannelCounters const& counters = channels[channel];
+				stream << (channel ? "," : "") << "\"" << getChannelName(channel) << "\":{\"bytesSent\":" << counters.bytesSent << ",\"bytesRcvd\":" << counters.bytesRcvd << ",\"packetsSent\":" << counters.packetsSent << ",\"packetsRcvd\":" << counters.packetsRcvd << "}";
+			}
+			stream << "},";
+
+			std::pair<const char*, LatencyHistogram const*> histograms[] = { { "rtt", &rtt }, { "queueDelay", &queueDelay }, { "reassemblyDelay", &reassemblyDelay } };
+			for (auto& histogram : histograms)
+				stream << "\"" << histogram.first << "\":{\"count\":" << histogram.second->getCount() << ",\"p50\":" << histogram.second->getPercentile(0.5f) << ",\"p90\":" << histogram.second->getPercentile(0.9f) << ",\"p99\":" << histogram.second->getPercentile(0.99f) << ",\"max\":" << histogram.second->getMax() << "},";
+
+			// Oldest sample first
+			size_t samples = historyIndex.load(std::memory_order_acquire);
+			size_t first = samples > METRICS_HISTORY ? samples - METRICS_HISTORY : 0;
+
+			stream << "\"history\":[";
+			for (size_t i = first; i < samples; ++i)
+			{
+				Sample const& entry = history[i % METRICS_HISTORY];
+				stream << (i != first ? "," : "") << "{\"bytesSent\":" << entry.bytesSent << ",\"bytesRcvd\":" << entry.bytesRcvd << ",\"packetsSent\":" << entry.packetsSent << ",\"packetsResent\":" << entry.packetsResent << ",\"packetsLost\":" << entry.packetsLost << ",\"packetsDuplicated\":" << entry.packetsDuplicated << "}";
+			}
+			stream << "]}";
+		}
+
+		void ConnectionMetrics::writePrometheus(std::ostream& stream, std::string const& name) const
+		{
+			Totals totals = getTotals();
+			std::string label = "connection=\"" + name + "\"";
+
+			stream << "techdemo_datagram_bytes_sent_total{" << label << "} " << totals.bytesSent << "\n";
+			stream << "techdemo_datagram_bytes_received_total{" << label << "} " << totals.bytesRcvd << "\n";
+			stream << "techdemo_datagrams_sent_total{" << label << "} " << totals.packetsSent << "\n";
+			stream << "techdemo_datagrams_resent_total{" << label << "} " << totals.packetsResent << "\n";
+			stream << "techdemo_datagrams_lost_total{" << label << "} " << totals.packetsLost << "\n";
+			stream << "techdemo_datagrams_duplicated_total{" << label << "} " << totals.packetsDuplicated << "\n";
+			stream << "techdemo_handler_queue_depth{" << label << "} " << handlerQueueDepth << "\n";
+			stream << "techdemo_handler_queue_depth_max{" << label << "} " << handlerQueueDepthMax << "\n";
+
+			for (size_t channel = 0; channel < static_cast<size_t>(Channel::Count); ++channel)
+			{
+				ChannelCounters const& counters = channels[channel];
+				std::string channelLabel = label + ",channel=\"" + getChannelName(channel) + "\"";
+
+				stream << "techdemo_bytes_sent_total{" << channelLabel << "} " << counters.bytesSent << "\n";
+				stream << "techdemo_bytes_received_total{" << channelLabel << "} " << counters.bytesRcvd << "\n";
+				stream << "techdemo_packets_sent_total{" << channelLabel << "} " << counters.packetsSent << "\n";
+				stream << "techdemo_packets_received_total{" << channelLabel << "} " << counters.packetsRcvd << "\n";
+			}
+
+			std::pair<const char*, LatencyHistogram const*> histograms[] = { { "rtt", &rtt }, { "queue_delay", &queueDelay }, { "reassembly_delay", &reassemblyDelay } };
+			for (auto& histogram : histograms)
+			{
+				for (float quantile : { 0.5f, 0.9f, 0.99f })
+					stream << "techdemo_" << histogram.first << "_seconds{" << label << ",quantile=\"" << quantile << "\"} " << histogram.second->getPercentile(quantile) / 1e9 << "\n";
+
+				stream << "techdemo_" << histogram.first << "_seconds_count{" << label << "} " << histogram.second->getCount() << "\n";
+			}
+		}
+
+		const char* ConnectionMetrics::getChannelName(size_t channel)
+		{
+			return static_cast<Channel>(channel) == Channel::Reliable ? "reliable" : "unreliable";
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+#define METRICS_HISTORY 50			// Per-second samples kept by each connection
+#define HISTOGRAM_SUB_BUCKET_BITS 4	// 16 linear sub-buckets per power of two (~6% precision)
+#define HISTOGRAM_MAGNITUDES 44		// Covers values up to 2^48 (~78 hours in nanoseconds)
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		enum class Channel : unsigned char
+		{
+			Reliable,
+			Unreliable,
+			Count
+		};
+
+		// Log-linear (HDR style) histogram with lock-free recording
+		class LatencyHistogram
+		{
+			public:
+				static constexpr size_t bucketCount = (HISTOGRAM_MAGNITUDES + 1) << HISTOGRAM_SUB_BUCKET_BITS;
+
+				void record(unsigned long long value);
+
+				unsigned long long getPercentile(float percentile) const;
+
+				unsigned long long getCount() const;
+
+				unsigned long long getMax() const;
+
+			private:
+				static size_t getBucket(unsigned long long value);
+
+				static unsigned long long getValue(size_t bucket);
+
+				std::atomic_ullong counts[bucketCount] = {};
+				std::atomic_ullong count = 0ULL;
+				std::atomic_ullong max = 0ULL;
+		};
+
+		class ConnectionMetrics
+		{
+			public:
+				struct Totals
+				{
+					unsigned long long bytesSent = 0ULL;
+					unsigned long long bytesRcvd = 0ULL;
+					unsigned long long packetsSent = 0ULL;
+					unsigned long long packetsResent = 0ULL;
+					unsigned long long packetsLost = 0ULL;
+					unsigned long long packetsDuplicated = 0ULL;
+				};
+
+				void recordSent(Channel channel, size_t bytes);
+
+				void recordReceived(Channel channel, size_t bytes);
+
+				void recordDatagramSent(size_t bytes);
+
+				void recordDatagramReceived(size_t bytes);
+
+				void recordResent(size_t bytes);
+
+				void recordLost(unsigned long count);
+
+				void recordDuplicated();
+
+				// Packets decoded but not yet handled
+				void recordHandlerQueueDepth(size_t depth);
+
+				LatencyHistogram& getRTT();
+
+				LatencyHistogram& getQueueDelay();
+
+				LatencyHistogram& getReassemblyDelay();
+
+				Totals getTotals() const;
+
+				// Records the change in totals since the previous call into the history ring buffer
+				void sample();
+
+				void writeJSON(std::ostream& stream, std::string const& name) const;
+
+				void writePrometheus(std::ostream& stream, std::string const& name) const;
+
+			private:
+				struct ChannelCounters
+				{
+					std::atomic_ullong bytesSent = 0ULL;
+					std::atomic_ullong bytesRcvd = 0ULL;
+					std::atomic_ullong packetsSent = 0ULL;
+					std::atomic_ullong packetsRcvd = 0ULL;
+				};
+
+				struct Sample
+				{
+					std::atomic_ulong bytesSent = 0UL;
+					std::atomic_ulong bytesRcvd = 0UL;
+					std::atomic_ulong packetsSent = 0UL;
+					std::atomic_ulong packetsResent = 0UL;
+					std::atomic_ulong packetsLost = 0UL;
+					std::atomic_ulong packetsDuplicated = 0UL;
+				};
+
+				static const char* getChannelName(size_t channel);
+
+				ChannelCounters channels[static_cast<size_t>(Channel::Count)];
+
+				// Datagram level counters (fragments and retransmissions are not attributable to a channel)
+				std::atomic_ullong bytesSent = 0ULL;
+				std::atomic_ullong bytesRcvd = 0ULL;
+				std::atomic_ullong packetsSent = 0ULL;
+				std::atomic_ullong packetsResent = 0ULL;
+				std::atomic_ullong packetsLost = 0ULL;
+				std::atomic_ullong packetsDuplicated = 0ULL;
+				std::atomic_size_t handlerQueueDepth = 0U;
+				std::atomic_size_t handlerQueueDepthMax = 0U;
+
+				LatencyHistogram rtt;				// Round-trip time (ns)
+				LatencyHistogram queueDelay;		// Time from a send request until its datagrams are handed to the socket (ns)
+				LatencyHistogram reassemblyDelay;	// Time out-of-order datagrams wait for the gap before them to be filled (ns)
+
+				Sample history[METRICS_HISTORY];
+				std::atomic_size_t historyIndex = 0U;	// Total number of samples taken
+				Totals lastTotals;						// Only touched by the sampling thread
+		};
+	}
+}
\ No newline at end of file
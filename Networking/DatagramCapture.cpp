@@ -0,0 +1,261 @@
+#include <cstring>
+#include <iostream>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "DatagramCapture.h"
+#include "TimingWheel.h"
+
+#define CAPTURE_FLUSH_SIZE 65536	// Bytes of records buffered before they are written out
+#define CAPTURE_FLUSH_PERIOD 1000	// Milliseconds between flushes, however few records were buffered
+
+namespace
+{
+	void writeVarint(std::string& buffer, unsigned long long value)
+	{
+		while (value >= 0x80ULL)
+		{
+			buffer.push_back(static_cast<char>((value & 0x7FULL) | 0x80ULL));
+			value >>= 7;
+		}
+
+		buffer.push_back(static_cast<char>(value));
+	}
+
+	bool readVarint(std::istream& stream, unsigned long long& value)
+	{
+		value = 0ULL;
+
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			int byte = stream.get();
+			if (byte == std::char_traits<char>::eof())
+				return false;
+
+			value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Family, address and port, without the padding of the rest of the structure
+	std::string getAddressKey(sockaddr_storage const& address)
+	{
+		std::string key(1, static_cast<char>(address.ss_family));
+
+		if (address.ss_family == AF_INET6)
+		{
+			sockaddr_in6 const& in6 = reinterpret_cast<sockaddr_in6 const&>(address);
+			key.append(reinterpret_cast<const char*>(&in6.sin6_addr), sizeof(in6.sin6_addr));
+			key.append(reinterpret_cast<const char*>(&in6.sin6_port), sizeof(in6.sin6_port));
+		}
+		else if (address.ss_family == AF_INET)
+		{
+			sockaddr_in const& in = reinterpret_cast<sockaddr_in const&>(address);
+			key.append(reinterpret_cast<const char*>(&in.sin_addr), sizeof(in.sin_addr));
+			key.append(reinterpret_cast<const char*>(&in.sin_port), sizeof(in.sin_port));
+		}
+
+		return key;
+	}
+}
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		DatagramCapture::DatagramCapture(std::string const& path, Role role) : file(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!file)
+			{
+				std::cerr << "An error occurred while creating the capture file " << path << std::endl;
+				return;
+			}
+
+			file.write(CAPTURE_MAGIC, 4);
+			file.put(static_cast<char>(CAPTURE_VERSION));
+			file.put(static_cast<char>(role));
+
+			flushTimer = Util::TimingWheel::add(std::chrono::milliseconds(CAPTURE_FLUSH_PERIOD), [this]() { flush(); });
+		}
+
+		DatagramCapture::~DatagramCapture()
+		{
+			if (flushTimer)
+				Util::TimingWheel::remove(flushTimer);
+
+			flush();
+		}
+
+		bool DatagramCapture::isOpen() const
+		{
+			return file.is_open() && file.good();
+		}
+
+		void DatagramCapture::record(sockaddr_storage const* address, const char* data, int length)
+		{
+			if (!data || length <= 0)
+				return;
+
+			auto now = std::chrono::steady_clock::now();
+
+			std::lock_guard guard(lock);
+
+			if (!file)
+				return;
+
+			writeVarint(buffer, static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count()));
+			last = now;
+
+			// 0 for no address, the index of a known one plus 1, or one past the known ones followed by the new address
+			if (!address)
+				writeVarint(buffer, 0ULL);
+			else
+			{
+				std::string key = getAddressKey(*address);
+				auto iter = addresses.find(key);
+
+				if (iter != addresses.end())
+					writeVarint(buffer, iter->second + 1ULL);
+				else
+				{
+					unsigned index = static_cast<unsigned>(addresses.size());
+					addresses.emplace(key, index);
+
+					writeVarint(buffer, index + 1ULL);
+					writeVarint(buffer, key.size());
+					buffer.append(key);
+				}
+			}
+
+			writeVarint(buffer, static_cast<unsigned long long>(length));
+			buffer.append(data, length);
+
+			++recorded;
+
+			if (buffer.size() >= CAPTURE_FLUSH_SIZE)
+			{
+				file.write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		}
+
+		void DatagramCapture::flush()
+		{
+			std::lock_guard guard(lock);
+
+			if (!file)
+				return;
+
+			file.write(buffer.data(), buffer.size());
+			file.flush();
+			buffer.clear();
+		}
+
+		unsigned long DatagramCapture::getRecorded() const
+		{
+			std::lock_guard guard(lock);
+			return recorded;
+		}
+
+		bool DatagramCapture::Reader::open(std::string const& path)
+		{
+			file.open(path, std::ios::binary);
+
+			char magic[4] = {0};
+			if (!file.read(magic, 4) || std::memcmp(magic, CAPTURE_MAGIC, 4))
+			{
+				std::cerr << "An error occurred while opening the capture file " << path << ": not a capture" << std::endl;
+				return false;
+			}
+
+			if (file.get() != CAPTURE_VERSION)
+			{
+				std::cerr << "An error occurred while opening the capture file " << path << ": unsupported version" << std::endl;
+				return false;
+			}
+
+			role = static_cast<Role>(file.get());
+			timestamp = 0ULL;
+			addresses.clear();
+
+			return static_cast<bool>(file);
+		}
+
+		bool DatagramCapture::Reader::next(Record& record)
+		{
+			unsigned long long delta = 0ULL, address = 0ULL, length = 0ULL;
+
+			if (!readVarint(file, delta) || !readVarint(file, address))
+				return false;
+
+			if (address > addresses.size())
+			{
+				unsigned long long size = 0ULL;
+				if (address != addresses.size() + 1 || !readVarint(file, size) || size > sizeof(sockaddr_in6) + 1)
+					return false;
+
+				std::string key(static_cast<size_t>(size), '\0');
+				if (!file.read(key.data(), key.size()))
+					return false;
+
+				addresses.push_back(std::move(key));
+			}
+
+			if (!readVarint(file, length) || length > 0xFFFFULL)
+				return false;
+
+			record.data.resize(static_cast<size_t>(length));
+			if (!file.read(record.data.data(), record.data.size()))
+				return false;
+
+			timestamp += delta;
+			record.timestamp = timestamp;
+			record.address = static_cast<int>(address) - 1;
+
+			return true;
+		}
+
+		DatagramCapture::Role DatagramCapture::Reader::getRole() const
+		{
+			return role;
+		}
+
+		bool DatagramCapture::Reader::getAddress(int index, sockaddr_storage& address) const
+		{
+			if (index < 0 || static_cast<size_t>(index) >= addresses.size() || addresses[index].empty())
+				return false;
+
+			std::string const& key = addresses[index];
+			std::memset(&address, 0, sizeof(address));
+			address.ss_family = static_cast<unsigned char>(key[0]);
+
+			if (address.ss_family == AF_INET6 && key.size() == 1 + sizeof(in6_addr) + sizeof(unsigned short))
+			{
+				sockaddr_in6& in6 = reinterpret_cast<sockaddr_in6&>(address);
+				std::memcpy(&in6.sin6_addr, key.data() + 1, sizeof(in6.sin6_addr));
+				std::memcpy(&in6.sin6_port, key.data() + 1 + sizeof(in6.sin6_addr), sizeof(in6.sin6_port));
+				return true;
+			}
+
+			if (address.ss_family == AF_INET && key.size() == 1 + sizeof(in_addr) + sizeof(unsigned short))
+			{
+				sockaddr_in& in = reinterpret_cast<sockaddr_in&>(address);
+				std::memcpy(&in.sin_addr, key.data() + 1, sizeof(in.sin_addr));
+				std::memcpy(&in.sin_port, key.data() + 1 + sizeof(in.sin_addr), sizeof(in.sin_port));
+				return true;
+			}
+
+			return false;
+		}
+	}
+}
\ No newline at end of file
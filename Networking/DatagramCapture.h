@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define CAPTURE_MAGIC "TDCP"
+#define CAPTURE_VERSION 1
+
+struct sockaddr_storage;	// Forward declaration
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Records the raw datagrams a connection receives, as they come off the socket, to a compact binary file. Each record
+		// holds the microseconds since the previous one, the source address (as an index into the addresses seen so far) and
+		// the datagram, so a capture can be fed back through the receive path offline with DatagramCapture::Reader.
+		class DatagramCapture
+		{
+			public:
+				enum class Role : unsigned char
+				{
+					Client,		// Datagrams received by a client from its server, with no source address
+					Server		// Datagrams received by a server from its clients
+				};
+
+				struct Record
+				{
+					unsigned long long timestamp = 0ULL;	// Microseconds since the capture started
+					int address = -1;						// Index into the reader's addresses (-1 for none)
+					std::string data;
+				};
+
+				class Reader
+				{
+					public:
+						bool open(std::string const& path);
+
+						// Returns false at the end of the capture, or if it is truncated
+						bool next(Record& record);
+
+						Role getRole() const;
+
+						// Copies the address a record came from, returning false for records without one
+						bool getAddress(int index, sockaddr_storage& address) const;
+
+					private:
+						std::ifstream file;
+						Role role = Role::Client;
+						unsigned long long timestamp = 0ULL;
+						std::vector<std::string> addresses;	// Raw socket addresses
+				};
+
+				DatagramCapture(std::string const& path, Role role);
+
+				~DatagramCapture();
+
+				bool isOpen() const;
+
+				// Called from the receiving thread as soon as the datagram has been read from the socket
+				void record(sockaddr_storage const* address, const char* data, int length);
+
+				unsigned long getRecorded() const;
+
+			private:
+				// Writes out the buffered records, and hands the file's own buffer to the OS
+				void flush();
+
+				std::ofstream file;
+				std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+				std::unordered_map<std::string, unsigned> addresses;	// Index of each source address written
+				std::string buffer;
+				unsigned long recorded = 0UL;
+				uint64_t flushTimer = 0ULL;	// Flushes a quiet capture, so little is lost if the process dies
+				mutable std::mutex lock;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma comment (lib, "Ws2_32.lib")
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+#include "Clock.h"
+#include "Engine.h"
+#include "History.h"
+#include "NetworkManager.h"
+#include "PacketHandlerPool.h"
+#include "ServerConnection.h"
+#include "Simulation.h"
+
+// Entry point of the dedicated server. Built with HEADLESS defined and without the Graphics sources (and so without GL,
+// GLFW or ImGui), it keeps only the collision and physics data of the scene: models are referenced by file name for the
+// clients to load (see ModelReferences), and no window, camera or local player is created.
+//
+// The simulation thread logs the scene into the History each tick, which is what snapshots are cut from. The physics
+// world is stepped by the engine's frame loop, which this entry point does not run, so rigid bodies only move by the
+// updates clients send.
+
+using namespace TechDemo;
+
+namespace
+{
+	struct Options
+	{
+		unsigned short port = 27015;
+		unsigned workers = 2;		// Packet handler threads
+		IO::SocketBackend backend = IO::SocketBackend::Select;
+	};
+
+	std::atomic_bool running = true;
+
+	Options parse(int argc, char** argv)
+	{
+		Options options;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg(argv[i]);
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "--port" && hasValue)
+				options.port = static_cast<unsigned short>(std::stoi(argv[++i]));
+			else if (arg == "--workers" && hasValue)
+				options.workers = static_cast<unsigned>(std::max(std::stoi(argv[++i]), 0));
+			else if (arg == "--backend" && hasValue)
+			{
+				std::string backend(argv[++i]);
+
+				if (backend == "rio")
+					options.backend = IO::SocketBackend::RegisteredIO;
+				else if (backend == "select")
+					options.backend = IO::SocketBackend::Select;
+				else
+					std::cerr << "Ignoring unknown backend \"" << backend << "\"" << std::endl;
+			}
+			else
+				std::cerr << "Ignoring unknown argument \"" << arg << "\"" << std::endl;
+		}
+
+		return options;
+	}
+
+	BOOL WINAPI stop(DWORD)
+	{
+		running = false;
+		return TRUE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options = parse(argc, argv);
+
+	IO::PacketHandlerPool::setWorkers(options.workers);
+	IO::NetworkManager::init();
+
+	World::Simulation::setStep([](unsigned long long timestamp)
+	{
+		World::History::log(Engine::getScene().getUUID(), timestamp);
+	});
+
+	SetConsoleCtrlHandler(stop, TRUE);
+
+	std::shared_ptr<IO::ServerConnection> server = std::make_shared<IO::ServerConnection>();
+	server->setBackend(options.backend);
+	Engine::server = server;
+
+	if (!server->listen(options.port))
+	{
+		IO::NetworkManager::shutdown();
+		return -1;
+	}
+
+	std::cout << "Listening on port " << options.port << std::endl;
+
+	// The clocks drive every connection tick, the interest manager and the handlers deferred to the tick
+	while (running)
+	{
+		Util::Clock::update();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	server->disconnect();
+	IO::NetworkManager::shutdown();
+
+	return 0;
+}
\ No newline at end of file
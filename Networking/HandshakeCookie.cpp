@@ -0,0 +1,141 @@
+#pragma comment (lib, "Bcrypt.lib")
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <bcrypt.h>
+
+#include "BitStream.h"
+#include "HandshakeCookie.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		void* HandshakeCookie::algorithm = nullptr;
+		unsigned char HandshakeCookie::secret[32] = {0};
+		std::once_flag HandshakeCookie::initialized;
+
+		std::string HandshakeCookie::challenge(sockaddr_storage const& address)
+		{
+			unsigned char cookie[COOKIE_SIZE];
+			if (!sign(address, getWindow(), cookie))
+				return std::string();
+
+			BitStream stream;
+			stream.write(static_cast<uint32_t>(COOKIE_MARKER));
+
+			return std::string(stream.data().data(), stream.data().size()).append(reinterpret_cast<const char*>(cookie), COOKIE_SIZE);
+		}
+
+		bool HandshakeCookie::verify(sockaddr_storage const& address, const char* datagram, unsigned length)
+		{
+			if (!isCookie(datagram, length))
+				return false;
+
+			const char* echoed = datagram + sizeof(uint32_t);
+			unsigned long long window = getWindow();
+
+			// A cookie issued just before the window changed is still accepted
+			for (unsigned long long w : { window, window - 1 })
+			{
+				unsigned char cookie[COOKIE_SIZE];
+				if (sign(address, w, cookie) && !std::memcmp(cookie, echoed, COOKIE_SIZE))
+					return true;
+			}
+
+			return false;
+		}
+
+		bool HandshakeCookie::isCookie(const char* datagram, unsigned length)
+		{
+			if (!datagram || length < COOKIE_DATAGRAM_SIZE)
+				return false;
+
+			BitStream stream(const_cast<char*>(datagram), sizeof(uint32_t));
+
+			uint32_t marker = 0U;
+			stream.read(marker);
+
+			return marker == COOKIE_MARKER;
+		}
+
+		bool HandshakeCookie::sign(sockaddr_storage const& address, unsigned long long window, unsigned char* cookie)
+		{
+			std::call_once(initialized, []()
+			{
+				BCRYPT_ALG_HANDLE handle = nullptr;
+
+				if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&handle, BCRYPT_SHA256_ALGORITHM, nullptr, BCRYPT_ALG_HANDLE_HMAC_FLAG)))
+				{
+					std::cerr << "An error occurred while opening the handshake cookie HMAC provider." << std::endl;
+					return;
+				}
+
+				if (!BCRYPT_SUCCESS(BCryptGenRandom(nullptr, secret, sizeof(secret), BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+				{
+					std::cerr << "An error occurred while generating the handshake cookie secret." << std::endl;
+					BCryptCloseAlgorithmProvider(handle, 0);
+					return;
+				}
+
+				algorithm = handle;
+			});
+
+			if (!algorithm)
+				return false;
+
+			// Address, port and time window
+			unsigned char message[16 + sizeof(unsigned short) + sizeof(window)] = {0};
+			unsigned length = 0U;
+
+			if (address.ss_family == AF_INET6)
+			{
+				sockaddr_in6 const& in6 = reinterpret_cast<sockaddr_in6 const&>(address);
+				std::memcpy(message, &in6.sin6_addr, sizeof(in6.sin6_addr));
+				std::memcpy(message + sizeof(in6.sin6_addr), &in6.sin6_port, sizeof(in6.sin6_port));
+				length = sizeof(in6.sin6_addr) + sizeof(in6.sin6_port);
+			}
+			else if (address.ss_family == AF_INET)
+			{
+				sockaddr_in const& in = reinterpret_cast<sockaddr_in const&>(address);
+				std::memcpy(message, &in.sin_addr, sizeof(in.sin_addr));
+				std::memcpy(message + sizeof(in.sin_addr), &in.sin_port, sizeof(in.sin_port));
+				length = sizeof(in.sin_addr) + sizeof(in.sin_port);
+			}
+			else
+				return false;
+
+			std::memcpy(message + length, &window, sizeof(window));
+			length += sizeof(window);
+
+			unsigned char hash[32];
+			BCRYPT_HASH_HANDLE handle = nullptr;
+
+			bool success = BCRYPT_SUCCESS(BCryptCreateHash(static_cast<BCRYPT_ALG_HANDLE>(algorithm), &handle, nullptr, 0, secret, sizeof(secret), 0))
+				&& BCRYPT_SUCCESS(BCryptHashData(handle, message, length, 0))
+				&& BCRYPT_SUCCESS(BCryptFinishHash(handle, hash, sizeof(hash), 0));
+
+			if (handle)
+				BCryptDestroyHash(handle);
+
+			if (success)
+				std::memcpy(cookie, hash, COOKIE_SIZE);
+
+			return success;
+		}
+
+		unsigned long long HandshakeCookie::getWindow()
+		{
+			return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()) / COOKIE_WINDOW;
+		}
+	}
+}
\ No newline at end of file
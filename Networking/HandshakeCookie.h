@@ -0,0 +1,43 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#define COOKIE_MARKER 0xFFFFFFFFU						// Sequence number slot of cookie datagrams, which carry no sequence number
+#define COOKIE_SIZE 16									// Bytes of the (truncated) HMAC-SHA256
+#define COOKIE_DATAGRAM_SIZE (4 + COOKIE_SIZE)			// Marker and cookie
+#define COOKIE_WINDOW 10000ULL							// Milliseconds per time window (cookies stay valid for one to two)
+
+struct sockaddr_storage;	// Forward declaration
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Stateless handshake cookies. The server answers the first datagram from an unknown address with a cookie: an HMAC
+		// over the address, port and current time window, keyed with a secret generated at startup. Only a handshake
+		// echoing a valid cookie back creates a connection, so spoofed or stray traffic costs a hash and a short reply.
+		class HandshakeCookie
+		{
+			public:
+				HandshakeCookie() = delete;
+
+				// Cookie datagram challenging the given address
+				static std::string challenge(sockaddr_storage const& address);
+
+				// Whether the datagram echoes a cookie issued to the address in the current or previous time window
+				static bool verify(sockaddr_storage const& address, const char* datagram, unsigned length);
+
+				static bool isCookie(const char* datagram, unsigned length);
+
+			private:
+				static bool sign(sockaddr_storage const& address, unsigned long long window, unsigned char* cookie);
+
+				static unsigned long long getWindow();
+
+				static void* algorithm;
+				static unsigned char secret[32];
+				static std::once_flag initialized;
+		};
+	}
+}
\ No newline at end of file
@@ -1,219 +1,104 @@
 #include "Component.h"
+#include "ComponentPool.h"
 #include "Connection.h"
 #include "Engine.h"
 #include "GameObject.h"
 #include "History.h"
+#include "InterestManager.h"
 #include "PlayerConnection.h"
 #include "RTTI.h"
 #include "Scene.h"
+#include "ServerConnection.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <unordered_set>
 
 namespace TechDemo
 {
 	namespace World
 	{
 		std::atomic_bool History::logEverything = false;
-		std::unordered_map<Util::UUID,														// For a given scene (by scene's UUID)
-			std::pair<std::recursive_mutex, std::map<unsigned long long,					// For a given frame (by closest server timestamp [sorted in ascending order])
-			std::pair<std::shared_ptr<std::recursive_mutex>, std::unordered_map<Util::UUID,	// For a given component (by component's UUID)
-			std::tuple<std::shared_ptr<std::recursive_mutex>, uint32_t, std::unordered_map<std::string,		// For a given parameter (by name) [uint32_t represents component type hash]
-			std::pair<std::shared_ptr<std::recursive_mutex>, std::tuple<unsigned long long, IO::BitStream>>	// Record of delta since last change and new value
-		>>>>>>> History::data;
+		std::unordered_map<Util::UUID, std::unique_ptr<History::Timeline>> History::data;
 		std::recursive_mutex History::dataLock;
 
-		
 		std::list<std::shared_ptr<ComponentBase>> History::getState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp)
 		{
-			std::list<std::shared_ptr<ComponentBase>> result;
-
-			dataLock.lock();
-
-			auto sceneIter = data.find(sceneId);
-			if (sceneIter != data.end())
-			{
-				sceneIter->second.first.lock();
-
-				auto& frames = sceneIter->second.second;
-				auto frameIter = frames.lower_bound(timestamp);
-				bool isBetween = frameIter != frames.end() && frameIter->first > timestamp;
-				frameIter = isBetween && frameIter != frames.begin() ? std::prev(frameIter) : frameIter;
-
-				if (frameIter != frames.end())
-				{
-					frameIter->second.first->lock();
-
-					auto& components = frameIter->second.second;
-					for (auto& componentPair : components)
-					{
-						auto& uniqueId = componentPair.first;
-						auto& typeHash = std::get<1>(componentPair.second);
-
-						auto type = Util::RTTI::getType(typeHash);
-
-						if (type != nullptr)
-						{
-							auto component = ComponentBase::create(typeHash);
-
-							if (component != nullptr)
-							{
-								component->uuid = uniqueId;
-								component->init();
-
-								for (const auto& variable : type->getVariableNames())
-									getState(conn, frames, timestamp, component, variable);
-
-								result.emplace_back(component);
-							}
-						}
-					}
-
-					frameIter->second.first->unlock();
-				}
-
-				sceneIter->second.first.unlock();
-			}
-
-			dataLock.unlock();
-
-			return result;
+			return createState(conn, sceneId, timestamp, 0U);
 		}
 
-		IO::BitStream History::getState(const Util::UUID& sceneId, unsigned long long timestamp, const Util::UUID& componentId, const std::string& variable)
+		IO::BitStream History::getState(const Util::UUID& sceneId, unsigned long long timestamp, const Util::UUID& componentId, uint16_t variable)
 		{
-			std::lock_guard dLock(dataLock);
-
-			auto sceneIter = data.find(sceneId);
-			if (sceneIter != data.end())
-			{
-				std::lock_guard sceneLock(sceneIter->second.first);
-
-				auto& frames = sceneIter->second.second;
-				auto frameIter = frames.lower_bound(timestamp);
-
-				if (frameIter != frames.end())
-				{
-					frameIter = frameIter->first > timestamp&& frameIter != frames.begin() ? std::prev(frameIter) : frameIter;
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return IO::BitStream();
 
-					if (frameIter->first > timestamp)
-						return IO::BitStream();
+			std::lock_guard lock(timeline->lock);
 
-					for (std::reverse_iterator rFrameIter(std::next(frameIter)); rFrameIter != frames.rend(); ++rFrameIter)
-					{
-						auto compsLock = rFrameIter->second.first;
-						auto& components = rFrameIter->second.second;
-
-						std::lock_guard csLock(*compsLock);
-
-						auto compIter = components.find(componentId);
-						if (compIter != components.end())
-						{
-							auto& compLock = std::get<0>(compIter->second);
-							auto compType = Util::RTTI::getType(std::get<1>(compIter->second));
-							auto& variables = std::get<2>(compIter->second);
-
-							std::lock_guard cLock(*compLock);
+			auto slot = timeline->slots.find(componentId);
+			if (slot == timeline->slots.end())
+				return IO::BitStream();
 
-							auto var = variables.find(variable);
+			const Util::RTTI::Type* type = Util::RTTI::getType(timeline->types[slot->second]);
+			if (!type || variable >= type->getVariableCount())
+				return IO::BitStream();
 
-							if (var != variables.end())
-							{
-								std::lock_guard varLock(*std::get<0>(var->second));
-
-								auto bs = std::get<1>(std::get<1>(var->second));
-								auto varData = compType->getVariable(variable);
-
-								auto interpolator = std::get<5>(varData);
-
-								if (interpolator && rFrameIter->first != timestamp)
-								{
-									for (auto nextFrameIter = std::next(frameIter); nextFrameIter != frames.end(); ++nextFrameIter)
-									{
-										auto& nextComponents = nextFrameIter->second.second;
-										auto nextCompsLock = nextFrameIter->second.first;
+			size_t end = timeline->upperBound(timestamp), index = 0;
+			int row = timeline->findPrevious(end, slot->second, variable, index);
 
-										std::lock_guard lock(*nextCompsLock);
+			if (row < 0)
+				return IO::BitStream();
 
-										auto nextComponent = nextComponents.find(componentId);
-										if (nextComponent != nextComponents.end())
-										{
-											auto& nextVarLock = std::get<0>(nextComponent->second);
-											auto& nextVariables = std::get<2>(nextComponent->second);
+			Frame const& frame = timeline->at(index);
+			IO::BitStream bs = frame.getValue(row);
 
-											std::lock_guard innerLock(*nextVarLock);
+			auto interpolator = std::get<5>(type->getVariable(variable));
 
-											auto nextVarIter = nextVariables.find(variable);
-											if (nextVarIter != nextVariables.end())
-											{
-												nextVarIter->second.first->lock();
+			if (interpolator && frame.timestamp != timestamp)
+			{
+				size_t nextIndex = 0;
+				int nextRow = timeline->findNext(end, slot->second, variable, nextIndex);
 
-												// Interpolate between frame values
-												float distance = static_cast<float>(timestamp - rFrameIter->first) / static_cast<float>(nextFrameIter->first - rFrameIter->first);
+				if (nextRow >= 0)
+				{
+					Frame const& next = timeline->at(nextIndex);
 
-												interpolator(bs.data().data(), std::get<1>(std::get<1>(nextVarIter->second)).data().data(), distance, const_cast<char*>(bs.data().data()));
+					// Interpolate between frame values
+					float distance = static_cast<float>(timestamp - frame.timestamp) / static_cast<float>(next.timestamp - frame.timestamp);
 
-												nextVarIter->second.first->unlock();
-												break;
-											}
-										}
-									}
-								}
-
-								return bs;
-							}
-						}
-					}
+					interpolator(bs.data().data(), next.payload.data() + next.offsets[nextRow], distance, const_cast<char*>(bs.data().data()));
 				}
 			}
 
-			return IO::BitStream();
+			return bs;
 		}
 
 		void History::applyState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp)
 		{
-			dataLock.lock();
-
-			auto sceneIter = data.find(sceneId);
-			if (sceneIter != data.end())
-			{
-				sceneIter->second.first.lock();
-
-				auto& frames = sceneIter->second.second;
-				auto frameIter = frames.lower_bound(timestamp);
-				bool isBetween = frameIter != frames.end() && frameIter->first > timestamp;
-				frameIter = isBetween && frameIter != frames.begin() ? std::prev(frameIter) : frameIter;
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return;
 
-				if (frameIter != frames.end())
-				{
-					frameIter->second.first->lock();
+			std::lock_guard lock(timeline->lock);
 
-					auto& components = frameIter->second.second;
-					for (auto& componentPair : components)
-					{
-						auto& uniqueId = componentPair.first;
-						auto& typeHash = std::get<1>(componentPair.second);
+			size_t end = timeline->upperBound(timestamp);
+			if (!end)
+				return;
 
-						auto type = Util::RTTI::getType(typeHash);
+			Frame const& frame = timeline->at(end - 1);
 
-						if (type != nullptr)
-						{
-							auto component = World::ComponentBase::getComponent(uniqueId);	// TODO: Handle deletion of component (dynamic construction / deletion)
-
-							if (component != nullptr)
-							{
-								for (const auto& variable : type->getVariableNames())
-									getState(conn, frames, timestamp, component, variable);
-							}
-						}
-					}
+			for (uint32_t slot : frame.slots)
+			{
+				const Util::RTTI::Type* type = Util::RTTI::getType(timeline->types[slot]);
+				auto component = World::ComponentBase::getComponent(timeline->components[slot]);	// TODO: Handle deletion of component (dynamic construction / deletion)
 
-					frameIter->second.first->unlock();
+				if (type && component != nullptr)
+				{
+					for (uint16_t variable = 0; variable < type->getVariableCount(); ++variable)
+						getState(conn, *timeline, timestamp, component, slot, variable);
 				}
-
-				sceneIter->second.first.unlock();
 			}
-
-			dataLock.unlock();
 		}
 
 		void History::log(const Util::UUID& sceneId, unsigned long long timestamp)
@@ -225,171 +110,97 @@ namespace TechDemo
 				static const uint32_t baseHash = Util::CRC32::checksum(Util::getQualifiedName<ComponentBase>());
 				bool logAll = logEverything;
 
-				decltype(data)::value_type::second_type::second_type::value_type::second_type::second_type components;
+				Timeline* timeline = getTimeline(sceneId, true);
+				std::unordered_set<Util::UUID> logged;
 
-				scene->getObjectsLock().lock();
-				for (const auto& object : scene->getObjects())
 				{
-					for (const auto& component : object.second->getComponents())
-					{
-						uint32_t typeHash = component->getTypeHash();
-						const Util::RTTI::Type* type = Util::RTTI::getType(typeHash);
+					std::lock_guard objectsLock(scene->getObjectsLock());
+					std::lock_guard lock(timeline->lock);
+
+					Frame* frame = timeline->insert(timestamp);
+					if (!frame)
+						return;
 
-						if (type)
+					// Logging an existing frame again replaces it
+					frame->clear();
+
+					size_t index = timeline->lowerBound(timestamp);
+					IO::BitStream bs;
+
+					for (const auto& object : scene->getObjects())
+					{
+						for (const auto& component : object.second->getComponents())
 						{
-							Util::extract_template_type<decltype(components)::value_type::second_type::_Mybase::_Mybase>::type variables;
+							uint32_t typeHash = component->getTypeHash();
+							const Util::RTTI::Type* type = Util::RTTI::getType(typeHash);
 
-							int32_t baseOffset = type->getBaseOffset(baseHash).second;
+							if (!type)
+								continue;
 
-							for (const auto& variable : type->getVariables(reinterpret_cast<char*>(&*component) - baseOffset, true))
+							uint32_t slot = timeline->getSlot(component->getUUID(), typeHash);
+							char* data = reinterpret_cast<char*>(&*component) - type->getBaseOffset(baseHash).second;
+							bool appended = false;
+
+							for (uint16_t id = 0; id < type->getVariableCount(); ++id)
 							{
-								const auto& varName = variable.first;
-								char* memory = std::get<0>(variable.second);
-								const Util::RTTI::Type* varType = std::get<1>(variable.second);
-								bool isPointer = std::get<2>(variable.second);
+								auto variable = type->getVariable(data, id);
+								char* memory = std::get<1>(variable);
+								const Util::RTTI::Type* varType = std::get<2>(variable);
+								bool isPointer = std::get<3>(variable);
+
+								if (!std::get<0>(variable) || isPointer || !varType)
+									continue;
 
-								if (!isPointer)
+								bs.clear();
+								bs.write(memory, varType->size);
+
+								unsigned long long deltaTime = 0ULL;
+								size_t prevIndex = 0, nextIndex = 0;
+								int prevRow = timeline->findPrevious(index, slot, id, prevIndex);
+
+								// Compare bitstream data with old value, if one exists.
+								if (prevRow >= 0)
 								{
-									IO::BitStream bs;
-									bs.write(memory, varType->size);
-
-									unsigned long long deltaTime = 0ULL;
-
-									dataLock.lock();
-
-									auto scene = data.find(sceneId);
-									if (scene != data.end())
-									{
-										auto& sceneMutex = scene->second.first;
-										sceneMutex.lock();
-
-										auto& frames = scene->second.second;
-										auto next = frames.lower_bound(timestamp);
-										auto prev = next != frames.end() ? next != frames.begin() ? ++std::reverse_iterator(next) : frames.rend() : !frames.empty() ? frames.rbegin() : frames.rend();
-
-										bool skip = false;
-
-										for (; next != frames.end(); ++next)
-										{
-											//auto& mutex = next->second.first;
-											//std::lock_guard lock(mutex);
-
-											auto compIter = next->second.second.find(component->getUUID());
-											if (compIter != next->second.second.end())
-											{
-												auto& tuple = compIter->second;
-												//std::lock_guard innerLock(std::get<0>(tuple));
-
-												auto& variables = std::get<2>(tuple);
-												auto varIter = variables.find(variable.first);
-												if (varIter != variables.end())
-												{
-													if (prev != frames.rend())
-													{
-														varIter->second.first->lock();
-
-														prev = std::reverse_iterator(frames.find(next->first - std::get<0>(std::get<1>(varIter->second))));
-
-														varIter->second.first->unlock();
-													}
-
-													break;
-												}
-											}
-										}
-
-										auto varComparator = std::get<3>(variable.second);
-
-										// Compare bitstream data with old value, if one exists.
-										for (; prev != frames.rend(); ++prev)
-										{
-											//auto& mutex = prev->second.first;
-											//std::lock_guard lock(mutex);
-											
-											auto compIter = prev->second.second.find(component->getUUID());
-											if (compIter != prev->second.second.end())
-											{
-												auto& tuple = compIter->second;
-												//std::lock_guard innerLock(std::get<0>(tuple));
-
-												auto& variables = std::get<2>(tuple);
-												auto varIter = variables.find(variable.first);
-												if (varIter != variables.end())
-												{
-													varIter->second.first->lock();
-
-													auto& oldBitStream = std::get<1>(std::get<1>(varIter->second));
-													skip = !logAll && varComparator(bs, oldBitStream);
-													deltaTime = timestamp - prev->first;
-
-													varIter->second.first->unlock();
-													break;
-												}
-											}
-										}
-
-										if (skip)
-										{
-											sceneMutex.unlock();
-											dataLock.unlock();
-											continue;
-										}
-
-										// Update delta timestamp of next log, if one exists
-										if (next != frames.end())
-										{
-											//auto& mutex = next->second.first;
-											//std::lock_guard lock(mutex);
-
-											auto compIter = next->second.second.find(component->getUUID());
-											if (compIter != next->second.second.end())
-											{
-												auto& tuple = compIter->second;
-												//std::lock_guard innerLock(std::get<0>(tuple));
-
-												auto& variables = std::get<2>(tuple);
-												auto varIter = variables.find(variable.first);
-												if (varIter != variables.end())
-												{
-													if (prev != frames.rend())
-													{
-														varIter->second.first->lock();
-
-														std::get<0>(varIter->second.second) -= deltaTime;
-
-														varIter->second.first->unlock();
-													}
-												}
-											}
-										}
-										
-										sceneMutex.unlock();
-									}
-
-									dataLock.unlock();
-
-									auto& varEntry = variables[varName];
-									varEntry.first = std::shared_ptr<std::recursive_mutex>(new std::recursive_mutex);
-									varEntry.second = std::make_tuple(deltaTime, std::move(bs));
+									Frame const& prev = timeline->at(prevIndex);
+									auto varComparator = std::get<4>(variable);
+
+									if (!logAll && (varComparator == IO::BitStream::equals ? prev.equals(prevRow, bs) : varComparator(bs, prev.getValue(prevRow))))
+										continue;
+
+									deltaTime = timestamp - prev.timestamp;
 								}
-							}
 
-							if (!variables.empty())
-							{
-								auto& comp = components[component->getUUID()];
-								std::get<0>(comp) = std::shared_ptr<std::recursive_mutex>(new std::recursive_mutex);
-								std::get<1>(comp) = typeHash;
-								std::get<2>(comp) = std::move(variables);
+								// Update delta timestamp of next log, if one exists
+								int nextRow = timeline->findNext(index + 1, slot, id, nextIndex);
+								if (nextRow >= 0)
+									timeline->at(nextIndex).deltas[nextRow] -= deltaTime;
+								else
+									timeline->setLatest(slot, id, timestamp);
+
+								if (!appended)
+								{
+									frame->append(slot);
+									appended = true;
+								}
+
+								frame->append(id, deltaTime, bs);
 							}
+
+							if (appended)
+								logged.emplace(component->getUUID());
 						}
 					}
+
+					frame->sort();
+
+					if (frame->empty())
+						timeline->erase(index);
+
+					timeline->reclaim();
 				}
-				scene->getObjectsLock().unlock();
 
-				if (!components.empty())
+				if (!logged.empty())
 				{
-					dataLock.lock();
-
 					auto& updates = pendingUpdates();
 
 					// Log pending update for remote clients
@@ -400,9 +211,19 @@ namespace TechDemo
 						std::lock_guard updateLock(updatesLock);
 						for (auto const& conn : IO::Connection::getConnections())
 						{
-							for (auto const& comp : components)
+							// Clients with an observer are only sent updates for the components around them
+							bool filtered = IO::InterestManager::forEachRelevant(conn.second.get(), [&](Util::UUID const& componentId, float distance)
 							{
-								updates[comp.first].emplace(timestamp, conn.second);
+								if (logged.count(componentId))
+									updates[componentId].emplace(timestamp, conn.second);
+							});
+
+							if (filtered)
+								continue;
+
+							for (auto const& componentId : logged)
+							{
+								updates[componentId].emplace(timestamp, conn.second);
 							}
 						}
 					}
@@ -412,211 +233,281 @@ namespace TechDemo
 					{
 						auto& updatesLock = getUpdatesLock();
 						std::lock_guard updateLock(updatesLock);
-						for (auto const& comp : components)
-							updates[comp.first].emplace(timestamp, nullptr);
+						for (auto const& componentId : logged)
+							updates[componentId].emplace(timestamp, nullptr);
 					}
-
-					auto& s = data[sceneId];
-					s.first.lock();
-					dataLock.unlock();
-
-					auto& frame = s.second[timestamp];
-					frame.first = std::shared_ptr<std::recursive_mutex>(new std::recursive_mutex);
-					frame.second = std::move(components);
-
-					s.first.unlock();
 				}
 			}
 		}
 
 		void History::remove(const Util::UUID& sceneId, unsigned long long timestamp)
 		{
-			dataLock.lock();
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return;
 
-			auto scene = data.find(sceneId);
-			if (scene != data.end())
-			{
-				scene->second.first.lock();
-				dataLock.unlock();
+			std::lock_guard lock(timeline->lock);
 
-				auto frame = scene->second.second.find(timestamp);
+			size_t index = timeline->lowerBound(timestamp);
+			if (index < timeline->count && timeline->at(index).timestamp == timestamp)
+				timeline->erase(index);
+		}
 
-				if (frame != scene->second.second.end())
+		void History::removeBefore(const Util::UUID& sceneId, unsigned long long timestamp)
+		{
+			// Keep every frame newer than a client's acknowledged baseline, as its next snapshot delta is built from them
+			if (Engine::server)
+			{
+				for (auto const& client : Engine::server->getClients())
 				{
-					auto lock = frame->second.first;
-					lock->lock();
+					if (unsigned long long baseline = client->getAckedSnapshot())
+						timestamp = std::min(timestamp, baseline);
+				}
+			}
 
-					scene->second.second.erase(frame);
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return;
 
-					lock->unlock();
-				}
-				
-				scene->second.first.unlock();
-			} else dataLock.unlock();
+			std::lock_guard lock(timeline->lock);
+
+			size_t removed = timeline->lowerBound(timestamp);
+			timeline->head = (timeline->head + removed) % HISTORY_CAPACITY;
+			timeline->count -= removed;
 		}
 
-		void History::removeBefore(const Util::UUID& sceneId, unsigned long long timestamp)
+		void History::removeAfter(const Util::UUID& sceneId, unsigned long long timestamp)
+		{
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return;
+
+			std::lock_guard lock(timeline->lock);
+			timeline->count = timeline->upperBound(timestamp);
+		}
+
+		std::unordered_map<Util::UUID, std::unordered_map<uint16_t, IO::BitStream>> History::getChanges(const Util::UUID& sceneId, unsigned long long timestamp)
+		{
+			return getFrameChanges(sceneId, timestamp, 0U);
+		}
+
+		std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>> History::getChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive)
+		{
+			return getRangeChanges(sceneId, fromExclusive, toInclusive, 0U);
+		}
+
+		void History::applyChanges(Util::UUID const& componentId, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>> const& variables)
 		{
-			dataLock.lock();
+			Timeline* timeline = getTimeline(Engine::getScene().getUUID(), true);
+
+			std::lock_guard lock(timeline->lock);
+
+			// The type is taken from the live component, or from an earlier log once it has been destroyed
+			uint32_t typeHash = 0U;
+			auto slotIter = timeline->slots.find(componentId);
+
+			if (std::shared_ptr<ComponentBase> component = ComponentBase::getComponent(componentId))
+				typeHash = component->getTypeHash();
+			else if (slotIter != timeline->slots.end())
+				typeHash = timeline->types[slotIter->second];
+
+			const Util::RTTI::Type* type = Util::RTTI::getType(typeHash);
+			if (!type)
+				return;
 
-			auto scene = data.find(sceneId);
-			if (scene != data.end())
+			timeline->reclaim();
+
+			uint32_t slot = timeline->getSlot(componentId, typeHash);
+
+			for (auto const& variable : variables)
 			{
-				scene->second.first.lock();
-				dataLock.unlock();
+				if (variable.first >= type->getVariableCount())
+					continue;
 
-				auto& frames = scene->second.second;
-				auto frame = frames.lower_bound(timestamp);
+				unsigned long long timestamp = variable.second.first;
 
-				if (frame != frames.begin())
-				{
-					auto prevFrame = frame != frames.end() ? ++std::reverse_iterator(frame) : frames.rbegin();
+				Frame* frame = timeline->insert(timestamp);
+				if (!frame)
+					continue;
 
-					while (prevFrame.base() != frames.end())
-					{
-						auto f = std::reverse_iterator(frames.erase(prevFrame.base()));
-						prevFrame = f.base() != frames.end() ? ++f : f;
-					}
-				}
+				size_t index = timeline->lowerBound(timestamp), prevIndex = 0, nextIndex = 0;
+				unsigned long long deltaTime = 0ULL;
+
+				int prevRow = timeline->findPrevious(index, slot, variable.first, prevIndex);
+				if (prevRow >= 0)
+					deltaTime = timestamp - timeline->at(prevIndex).timestamp;
+
+				// The next log of the variable is now relative to this one
+				int nextRow = timeline->findNext(index + 1, slot, variable.first, nextIndex);
+				if (nextRow >= 0)
+					timeline->at(nextIndex).deltas[nextRow] = timeline->at(nextIndex).timestamp - timestamp;
+				else
+					timeline->setLatest(slot, variable.first, timestamp);
 
-				scene->second.first.unlock();
+				frame->set(frame->insert(slot), variable.first, deltaTime, variable.second.second);
 			}
-			else dataLock.unlock();
 		}
 
-		void History::removeAfter(const Util::UUID& sceneId, unsigned long long timestamp)
+		void History::removeChanges(Util::UUID const& componentId, uint16_t variable, unsigned long long fromExclusive, unsigned long long toInclusive)
 		{
-			dataLock.lock();
+			if (toInclusive <= fromExclusive)
+				return;
+
+			Timeline* timeline = getTimeline(Engine::getScene().getUUID(), false);
+			if (!timeline)
+				return;
 
-			auto scene = data.find(sceneId);
-			if (scene != data.end())
+			std::lock_guard lock(timeline->lock);
+
+			auto slot = timeline->slots.find(componentId);
+			if (slot == timeline->slots.end())
+				return;
+
+			size_t begin = timeline->upperBound(fromExclusive);
+
+			for (size_t index = timeline->upperBound(toInclusive); index > begin; --index)
 			{
-				scene->second.first.lock();
-				dataLock.unlock();
+				Frame& frame = timeline->at(index - 1);
 
-				auto& frames = scene->second.second;
+				int component = frame.find(slot->second);
+				if (component >= 0)
+					frame.erase(component, variable);
+			}
 
-				for (auto frame = frames.upper_bound(timestamp); frame != frames.end();)
-					frame = frames.erase(frame);
+			// The next log of the variable is now relative to the one before the range
+			size_t prevIndex = 0, nextIndex = 0;
+			int nextRow = timeline->findNext(begin, slot->second, variable, nextIndex);
 
-				scene->second.first.unlock();
+			if (nextRow >= 0)
+			{
+				int prevRow = timeline->findPrevious(begin, slot->second, variable, prevIndex);
+				timeline->at(nextIndex).deltas[nextRow] = prevRow >= 0 ? timeline->at(nextIndex).timestamp - timeline->at(prevIndex).timestamp : 0ULL;
 			}
-			else dataLock.unlock();
 		}
 
-		std::unordered_map<Util::UUID, std::unordered_map<std::string, IO::BitStream>> History::getChanges(const Util::UUID& sceneId, unsigned long long timestamp)
+		std::list<std::shared_ptr<ComponentBase>> History::createState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp, uint32_t typeHash)
 		{
-			std::unordered_map<Util::UUID, std::unordered_map<std::string, IO::BitStream>> result;
+			std::list<std::shared_ptr<ComponentBase>> result;
 
-			dataLock.lock();
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return result;
 
-			auto sceneIter = data.find(sceneId);
-			if (sceneIter != data.end())
-			{
-				auto& frameMutex = sceneIter->second.first;
-				auto& frames = sceneIter->second.second;
-				frameMutex.lock();
-				dataLock.unlock();
+			std::lock_guard lock(timeline->lock);
 
-				auto frameIter = frames.find(timestamp);
-				if (frameIter != frames.end())
-				{
-					auto componentMutex = frameIter->second.first;
-					auto& components = frameIter->second.second;
-					componentMutex->lock();
-					frameMutex.unlock();
+			size_t end = timeline->upperBound(timestamp);
+			if (!end)
+				return result;
 
-					for (auto& component : components)
-					{
-						auto& varMutex = std::get<0>(component.second);
-						auto& variables = std::get<2>(component.second);
+			Frame const& frame = timeline->at(end - 1);
 
-						std::unordered_map<std::string, IO::BitStream> varData;
+			for (uint32_t slot : frame.slots)
+			{
+				uint32_t slotType = timeline->types[slot];
+				const Util::RTTI::Type* type = Util::RTTI::getType(slotType);
 
-						varMutex->lock();
-						for (auto& variable : variables)
-						{
-							auto& streamMutex = std::get<0>(variable.second);
+				if ((typeHash && slotType != typeHash) || !type)
+					continue;
 
-							streamMutex->lock();
-							auto stream = std::get<1>(std::get<1>(variable.second));
-							streamMutex->unlock();
+				auto component = ComponentPool::create(slotType);
 
-							varData.emplace(variable.first, std::move(stream));
-						}
-						varMutex->unlock();
+				if (component != nullptr)
+				{
+					component->uuid = timeline->components[slot];
+					component->init();
 
-						result.emplace(component.first, std::move(varData));
-					}
+					for (uint16_t variable = 0; variable < type->getVariableCount(); ++variable)
+						getState(conn, *timeline, timestamp, component, slot, variable);
 
-					componentMutex->unlock();
-				} else frameMutex.unlock();
+					result.emplace_back(component);
+				}
 			}
-			else dataLock.unlock();
 
 			return result;
 		}
 
-		std::unordered_map<Util::UUID, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>>> History::getChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive)
+		std::unordered_map<Util::UUID, std::unordered_map<uint16_t, IO::BitStream>> History::getFrameChanges(const Util::UUID& sceneId, unsigned long long timestamp, uint32_t typeHash)
 		{
-			std::unordered_map<Util::UUID, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>>> result;
+			std::unordered_map<Util::UUID, std::unordered_map<uint16_t, IO::BitStream>> result;
 
-			if (toInclusive > fromExclusive)
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return result;
+
+			std::lock_guard lock(timeline->lock);
+
+			size_t index = timeline->lowerBound(timestamp);
+			if (index == timeline->count || timeline->at(index).timestamp != timestamp)
+				return result;
+
+			Frame const& frame = timeline->at(index);
+
+			for (size_t c = 0; c < frame.slots.size(); ++c)
 			{
-				dataLock.lock();
+				uint32_t slot = frame.slots[c];
 
-				auto sceneIter = data.find(sceneId);
-				if (sceneIter != data.end())
-				{
-					auto& frameMutex = sceneIter->second.first;
-					auto& frames = sceneIter->second.second;
-					frameMutex.lock();
-					dataLock.unlock();
+				if (typeHash && timeline->types[slot] != typeHash)
+					continue;
 
-					auto iter = std::reverse_iterator(frames.lower_bound(toInclusive));
-					iter = iter == frames.rend() ? std::reverse_iterator(frames.begin()) : iter->first == toInclusive ? iter : iter != frames.rend() ? std::next(iter) : iter;
-					auto from = std::reverse_iterator(frames.lower_bound(fromExclusive));
-					from = from == frames.rend() || from->first == fromExclusive ? from : from != frames.rbegin() ? std::next(from) : frames.rend();
+				auto& varData = result[timeline->components[slot]];
 
-					if (iter != frames.rend())
-					{
-						for (; iter != from; ++iter)
-						{
-							auto componentMutex = iter->second.first;
-							auto& components = iter->second.second;
-							componentMutex->lock();
+				for (uint32_t row = frame.firsts[c]; row < frame.firsts[c + 1]; ++row)
+					varData.emplace(frame.variables[row], frame.getValue(row));
+			}
 
-							for (auto& component : components)
-							{
-								auto& varMutex = std::get<0>(component.second);
-								auto& variables = std::get<2>(component.second);
+			return result;
+		}
 
-								varMutex->lock();
-								for (auto& variable : variables)
-								{
-									auto& streamMutex = std::get<0>(variable.second);
+		std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>> History::getRangeChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive, uint32_t typeHash)
+		{
+			std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>> result;
 
-									streamMutex->lock();
-									auto stream = std::get<1>(std::get<1>(variable.second));
-									streamMutex->unlock();
+			if (toInclusive <= fromExclusive)
+				return result;
 
-									result[component.first].try_emplace(variable.first, std::make_pair(iter->first, std::move(stream)));
-								}
-								varMutex->unlock();
-							}
+			Timeline* timeline = getTimeline(sceneId, false);
+			if (!timeline)
+				return result;
 
-							componentMutex->unlock();
-						}
-					}
+			std::lock_guard lock(timeline->lock);
+
+			// Newest first, so each variable keeps its newest value
+			for (size_t index = timeline->upperBound(toInclusive), begin = timeline->upperBound(fromExclusive); index > begin; --index)
+			{
+				Frame const& frame = timeline->at(index - 1);
+
+				for (size_t c = 0; c < frame.slots.size(); ++c)
+				{
+					uint32_t slot = frame.slots[c];
+
+					if (typeHash && timeline->types[slot] != typeHash)
+						continue;
+
+					auto& varData = result[timeline->components[slot]];
 
-					frameMutex.unlock();
+					for (uint32_t row = frame.firsts[c]; row < frame.firsts[c + 1]; ++row)
+					{
+						if (!varData.count(frame.variables[row]))
+							varData.emplace(frame.variables[row], std::make_pair(frame.timestamp, frame.getValue(row)));
+					}
 				}
-				else dataLock.unlock();
 			}
 
 			return result;
 		}
 
+		History::Timeline* History::getTimeline(const Util::UUID& sceneId, bool create)
+		{
+			std::lock_guard lock(dataLock);
+
+			auto iter = data.find(sceneId);
+			if (iter != data.end())
+				return iter->second.get();
+
+			// Timelines are never removed, so the pointer stays valid without the data lock
+			return create ? data.emplace(sceneId, std::make_unique<Timeline>()).first->second.get() : nullptr;
+		}
+
 		std::unordered_map<Util::UUID, std::multimap<unsigned long long, std::shared_ptr<IO::Connection>>>& History::pendingUpdates()
 		{
 			static std::unordered_map<Util::UUID,												// For a given component (by component's UUID)
@@ -633,185 +524,432 @@ namespace TechDemo
 			return lock;
 		}
 
-		void History::getState(const std::shared_ptr<IO::Connection>& conn, decltype(History::data)::iterator::value_type::second_type::second_type& frames, unsigned long long timestamp, std::shared_ptr<ComponentBase>& component, const std::string& variable)
+		void History::getState(const std::shared_ptr<IO::Connection>& conn, Timeline& timeline, unsigned long long timestamp, std::shared_ptr<ComponentBase>& component, uint32_t slot, uint16_t variable)
 		{
-			auto frameIter = frames.lower_bound(timestamp);
+			const Util::RTTI::Type* type = Util::RTTI::getType(component->getTypeHash());
+			if (!type)
+				return;
+
+			size_t end = timeline.upperBound(timestamp), index = 0;
+			int row = timeline.findPrevious(end, slot, variable, index);
 
-			if (frameIter != frames.end())
+			if (row < 0)
+				return;
+
+			Frame const& frame = timeline.at(index);
+			IO::BitStream bs = frame.getValue(row);
+
+			auto varData = type->getVariable(reinterpret_cast<char*>(&*component), variable);
+			if (!std::get<0>(varData) || !std::get<2>(varData))
+				return;
+
+			auto premodifycallback = std::get<8>(varData);
+			if (premodifycallback)
+				premodifycallback(std::get<1>(varData));
+
+			bs.peek(std::get<1>(varData), std::get<2>(varData)->getSize());
+
+			auto postmodifycallback = std::get<9>(varData);
+			if (postmodifycallback)
+				postmodifycallback(std::get<1>(varData));
+
+			auto interpolator = std::get<5>(varData);
+
+			if (interpolator && frame.timestamp != timestamp)
 			{
-				const Util::UUID& componentId = component->getUUID();
-				const Util::RTTI::Type* type = Util::RTTI::getType(component->getTypeHash());
+				size_t nextIndex = 0;
+				int nextRow = timeline.findNext(end, slot, variable, nextIndex);
 
-				if (type)
+				if (nextRow >= 0)
 				{
-					frameIter = frameIter->first > timestamp && frameIter != frames.begin() ? std::prev(frameIter) : frameIter;
+					Frame const& next = timeline.at(nextIndex);
 
-					if (frameIter->first > timestamp)
-						return;
+					// Interpolate between frame values
+					float distance = static_cast<float>(timestamp - frame.timestamp) / static_cast<float>(next.timestamp - frame.timestamp);
 
-					for (std::reverse_iterator rFrameIter(/*frameIter->first > timestamp ? frameIter : */std::next(frameIter)); rFrameIter != frames.rend(); ++rFrameIter)
-					{
-						auto compsLock = rFrameIter->second.first;
-						auto& components = rFrameIter->second.second;
+					if (premodifycallback)
+						premodifycallback(std::get<1>(varData));
 
-						std::lock_guard csLock(*compsLock);
+					interpolator(std::get<1>(varData), next.payload.data() + next.offsets[nextRow], distance, std::get<1>(varData));
 
-						auto compIter = components.find(componentId);
+					if (postmodifycallback)
+						postmodifycallback(std::get<1>(varData));
+				}
+			}
+		}
 
-						if (compIter != components.end())
-						{
-							auto& compLock = std::get<0>(compIter->second);
-							auto& variables = std::get<2>(compIter->second);
+		void History::Frame::clear()
+		{
+			slots.clear();
+			firsts.assign(1, 0U);
+			variables.clear();
+			deltas.clear();
+			offsets.clear();
+			sizes.clear();
+			payload.clear();
+		}
 
-							std::lock_guard cLock(*compLock);
+		bool History::Frame::empty() const
+		{
+			return slots.empty();
+		}
 
-							auto var = variables.find(variable);
+		int History::Frame::find(uint32_t slot) const
+		{
+			auto iter = std::lower_bound(slots.begin(), slots.end(), slot);
+			return iter != slots.end() && *iter == slot ? static_cast<int>(iter - slots.begin()) : -1;
+		}
 
-							if (var != variables.end())
-							{
-								std::get<0>(var->second)->lock();
+		int History::Frame::find(uint32_t slot, uint16_t variable) const
+		{
+			int component = find(slot);
+			if (component < 0)
+				return -1;
 
-								auto& bs = std::get<1>(std::get<1>(var->second));
-								
-								auto varData = type->getVariable(reinterpret_cast<char*>(&*component), variable);
+			for (uint32_t row = firsts[component]; row < firsts[component + 1]; ++row)
+			{
+				if (variables[row] == variable)
+					return static_cast<int>(row);
+			}
 
-								auto premodifycallback = std::get<8>(varData);
-								if (premodifycallback)
-									premodifycallback(std::get<1>(varData));
-								
-								bs.peek(std::get<1>(varData), std::get<2>(varData)->getSize());
+			return -1;
+		}
 
-								auto postmodifycallback = std::get<9>(varData);
-								if (postmodifycallback)
-									postmodifycallback(std::get<1>(varData));
+		IO::BitStream History::Frame::getValue(size_t row) const
+		{
+			IO::BitStream bs;
+			char* value = const_cast<char*>(payload.data()) + offsets[row];
+			bs.write(value, sizes[row]);
 
-								auto interpolator = std::get<5>(varData);
+			return bs;
+		}
 
-								if (interpolator && rFrameIter->first != timestamp)
-								{
-									for (auto nextFrameIter = std::next(frameIter); nextFrameIter != frames.end(); ++nextFrameIter)
-									{
-										auto& nextComponents = nextFrameIter->second.second;
-										auto nextCompsLock = nextFrameIter->second.first;
-
-										std::lock_guard lock(*nextCompsLock);
-
-										auto nextComponent = nextComponents.find(componentId);
-										if (nextComponent != nextComponents.end())
-										{
-											auto& nextVarLock = std::get<0>(nextComponent->second);
-											auto& nextVariables = std::get<2>(nextComponent->second);
-
-											std::lock_guard innerLock(*nextVarLock);
-
-											auto nextVarIter = nextVariables.find(variable);
-											if (nextVarIter != nextVariables.end())
-											{
-												std::get<0>(nextVarIter->second)->lock();
-
-												// Interpolate between frame values
-												float distance = static_cast<float>(timestamp - rFrameIter->first) / static_cast<float>(nextFrameIter->first - rFrameIter->first);
-												
-												if (premodifycallback)
-													premodifycallback(std::get<1>(varData));
-
-												interpolator(std::get<1>(varData), std::get<1>(std::get<1>(nextVarIter->second)).data().data(), distance, std::get<1>(varData));
-
-												if (postmodifycallback)
-													postmodifycallback(std::get<1>(varData));
-
-												std::get<0>(nextVarIter->second)->unlock();
-												break;
-											}
-										}
-									}
-								}
+		bool History::Frame::equals(size_t row, IO::BitStream const& value) const
+		{
+			size_t bytes = (sizes[row] + Util::byteSize() - 1) / Util::byteSize();
+			return value.size() == sizes[row] && value.data().size() >= bytes && !std::memcmp(value.data().data(), payload.data() + offsets[row], bytes);
+		}
 
-								std::get<0>(var->second)->unlock();
-								return;
-							}
-						}
-					}
-				}
-			}
+		void History::Frame::append(uint32_t slot)
+		{
+			slots.push_back(slot);
+			firsts.push_back(firsts.back());
 		}
 
-		void History::applyChanges(Util::UUID const& componentId, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>> const& variables)
+		void History::Frame::append(uint16_t variable, unsigned long long delta, IO::BitStream const& value)
 		{
-			// TODO: Send the ordered data instead of needing to do this.
-			std::unordered_multimap<unsigned long long, std::pair<std::string, IO::BitStream>> orderedVars;
+			size_t bytes = std::min((value.size() + Util::byteSize() - 1) / Util::byteSize(), value.data().size());
 
-			for (auto& var : variables)
-				orderedVars.emplace(var.second.first, std::make_pair(var.first, var.second.second));
+			variables.push_back(variable);
+			deltas.push_back(delta);
+			offsets.push_back(static_cast<uint32_t>(payload.size()));
+			sizes.push_back(static_cast<uint32_t>(value.size()));
+			payload.insert(payload.end(), value.data().begin(), value.data().begin() + bytes);
 
-			dataLock.lock();
-			auto sceneIter = data.find(Engine::getScene().getUUID());
-			sceneIter->second.first.lock();
-			dataLock.unlock();
+			++firsts.back();
+		}
 
-			for (auto iter = orderedVars.begin(), next = orderedVars.upper_bound(iter->first); iter != orderedVars.end();)
+		size_t History::Frame::insert(uint32_t slot)
+		{
+			auto iter = std::lower_bound(slots.begin(), slots.end(), slot);
+			size_t component = iter - slots.begin();
+
+			if (iter == slots.end() || *iter != slot)
 			{
-				auto timeIter = sceneIter->second.second.find(iter->first);
+				slots.insert(iter, slot);
+				firsts.insert(firsts.begin() + component, firsts[component]);
+			}
 
-				if (timeIter == sceneIter->second.second.end())
+			return component;
+		}
+
+		void History::Frame::set(size_t component, uint16_t variable, unsigned long long delta, IO::BitStream const& value)
+		{
+			size_t bytes = std::min((value.size() + Util::byteSize() - 1) / Util::byteSize(), value.data().size());
+
+			for (uint32_t row = firsts[component]; row < firsts[component + 1]; ++row)
+			{
+				if (variables[row] == variable)
 				{
-					//decltype(sceneIter->second.second)::value_type::second_type value;
-					//timeIter = sceneIter->second.second.emplace(iter->first, value).first;
+					// Overwritten in place when it fits, otherwise the old value is left unused until the frame is reused
+					if (bytes > (sizes[row] + Util::byteSize() - 1) / Util::byteSize())
+					{
+						offsets[row] = static_cast<uint32_t>(payload.size());
+						payload.resize(payload.size() + bytes);
+					}
+
+					std::copy(value.data().begin(), value.data().begin() + bytes, payload.begin() + offsets[row]);
+					sizes[row] = static_cast<uint32_t>(value.size());
+					deltas[row] = delta;
+					return;
 				}
+			}
+
+			uint32_t row = firsts[component + 1];
 
-				// TODO: Get last time and component hash
-				auto lastTimeIter = timeIter - 1;
+			variables.insert(variables.begin() + row, variable);
+			deltas.insert(deltas.begin() + row, delta);
+			offsets.insert(offsets.begin() + row, static_cast<uint32_t>(payload.size()));
+			sizes.insert(sizes.begin() + row, static_cast<uint32_t>(value.size()));
+			payload.insert(payload.end(), value.data().begin(), value.data().begin() + bytes);
 
-				while (true)
+			for (size_t c = component + 1; c < firsts.size(); ++c)
+				++firsts[c];
+		}
+
+		void History::Frame::erase(size_t component, uint16_t variable)
+		{
+			for (uint32_t row = firsts[component]; row < firsts[component + 1]; ++row)
+			{
+				if (variables[row] == variable)
 				{
+					// The value is left unused in the payload until the frame is reused
+					variables.erase(variables.begin() + row);
+					deltas.erase(deltas.begin() + row);
+					offsets.erase(offsets.begin() + row);
+					sizes.erase(sizes.begin() + row);
+
+					for (size_t c = component + 1; c < firsts.size(); ++c)
+						--firsts[c];
 
+					if (firsts[component] == firsts[component + 1])
+					{
+						slots.erase(slots.begin() + component);
+						firsts.erase(firsts.begin() + component);
+					}
 
-					if (lastTimeIter == sceneIter->second.second.begin())
-						break;
+					return;
 				}
+			}
+		}
+
+		void History::Frame::sort()
+		{
+			if (std::is_sorted(slots.begin(), slots.end()))
+				return;
+
+			std::vector<size_t> order(slots.size());
+			for (size_t c = 0; c < order.size(); ++c)
+				order[c] = c;
 
-				timeIter->second.first->lock();
+			std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return slots[a] < slots[b]; });
 
-				auto componentIter = timeIter->second.second.find(componentId);
+			// Payload offsets stay valid, so only the rows move
+			Frame sorted;
+			sorted.payload.swap(payload);
 
-				if (componentIter == timeIter->second.second.end())
+			for (size_t c : order)
+			{
+				sorted.slots.push_back(slots[c]);
+				sorted.firsts.push_back(sorted.firsts.back() + (firsts[c + 1] - firsts[c]));
+
+				for (uint32_t row = firsts[c]; row < firsts[c + 1]; ++row)
 				{
-					uint32_t componentHash = 0U;	// TODO
-					std::tuple<std::recursive_mutex, uint32_t, decltype(timeIter->second.second)::value_type::second_type::_Mybase::_Mybase::_This_type> value;
-					std::get<1>(value) = componentHash;
-					//componentIter = timeIter->second.second.emplace(componentId, std::move(value)).first;
+					sorted.variables.push_back(variables[row]);
+					sorted.deltas.push_back(deltas[row]);
+					sorted.offsets.push_back(offsets[row]);
+					sorted.sizes.push_back(sizes[row]);
 				}
+			}
 
-				timeIter->second.first->unlock();
-				std::get<0>(componentIter->second)->lock();
+			sorted.timestamp = timestamp;
+			*this = std::move(sorted);
+		}
 
-				for (; iter != next; ++iter)
-				{
-					auto& vars = std::get<2>(componentIter->second);
-					auto varIter = vars.find(iter->second.first);
+		History::Frame& History::Timeline::at(size_t index)
+		{
+			return frames[(head + index) % HISTORY_CAPACITY];
+		}
 
-					if (varIter == vars.end())
-					{
-						unsigned long long deltaTime = 0ULL;	// TODO
-						//vars.emplace(iter->second.first, std::tuple<std::shared_ptr<std::recursive_mutex>, std::tuple<unsigned long long, IO::BitStream>>(std::shared_ptr<std::recursive_mutex>(new std::recursive_mutex), std::tuple<unsigned long long, IO::BitStream>(deltaTime, iter->second.second)));
-					}
-					else
-					{
-						std::get<0>(varIter->second)->lock();
+		History::Frame const& History::Timeline::at(size_t index) const
+		{
+			return frames[(head + index) % HISTORY_CAPACITY];
+		}
 
-						std::get<1>(std::get<1>(varIter->second)) = std::move(iter->second.second);
+		size_t History::Timeline::lowerBound(unsigned long long timestamp) const
+		{
+			size_t low = 0, high = count;
 
-						std::get<0>(varIter->second)->unlock();
-					}
+			while (low < high)
+			{
+				size_t mid = (low + high) / 2;
+
+				if (at(mid).timestamp < timestamp)
+					low = mid + 1;
+				else
+					high = mid;
+			}
+
+			return low;
+		}
+
+		size_t History::Timeline::upperBound(unsigned long long timestamp) const
+		{
+			size_t low = 0, high = count;
+
+			while (low < high)
+			{
+				size_t mid = (low + high) / 2;
+
+				if (at(mid).timestamp <= timestamp)
+					low = mid + 1;
+				else
+					high = mid;
+			}
+
+			return low;
+		}
+
+		History::Frame* History::Timeline::insert(unsigned long long timestamp)
+		{
+			size_t index = lowerBound(timestamp);
+
+			if (index < count && at(index).timestamp == timestamp)
+				return &at(index);
+
+			// Once full, the oldest frame is overwritten
+			if (count == HISTORY_CAPACITY)
+			{
+				if (!index)
+					return nullptr;
+
+				head = (head + 1) % HISTORY_CAPACITY;
+				--count;
+				--index;
+			}
+
+			Frame& frame = at(count);
+			frame.clear();
+			frame.timestamp = timestamp;
+			++inserted;
+
+			// Frames are logged in order almost always, so this rarely moves anything
+			for (size_t i = count; i > index; --i)
+				std::swap(at(i), at(i - 1));
+
+			++count;
+
+			return &at(index);
+		}
+
+		void History::Timeline::erase(size_t index)
+		{
+			// The erased frame's storage is kept at the end of the ring for reuse
+			for (size_t i = index; i + 1 < count; ++i)
+				std::swap(at(i), at(i + 1));
+
+			--count;
+		}
+
+		uint32_t History::Timeline::getSlot(Util::UUID const& componentId, uint32_t typeHash)
+		{
+			auto iter = slots.find(componentId);
+			if (iter != slots.end())
+				return iter->second;
+
+			uint32_t slot = 0U;
+
+			if (!freeSlots.empty())
+			{
+				slot = freeSlots.back();
+				freeSlots.pop_back();
+
+				components[slot] = componentId;
+				types[slot] = typeHash;
+			}
+			else
+			{
+				slot = static_cast<uint32_t>(components.size());
+				components.push_back(componentId);
+				types.push_back(typeHash);
+				latest.emplace_back();
+			}
+
+			slots.emplace(componentId, slot);
+
+			return slot;
+		}
+
+		void History::Timeline::reclaim()
+		{
+			if (inserted < HISTORY_CAPACITY)
+				return;
+
+			inserted = 0;
+
+			std::vector<bool> referenced(components.size(), false);
+
+			for (size_t index = 0; index < count; ++index)
+			{
+				for (uint32_t slot : at(index).slots)
+					referenced[slot] = true;
+			}
+
+			for (uint32_t slot = 0; slot < components.size(); ++slot)
+			{
+				if (referenced[slot] || !types[slot] || ComponentBase::getComponent(components[slot]) != nullptr)
+					continue;
+
+				slots.erase(components[slot]);
+				types[slot] = 0U;
+				latest[slot].clear();
+				freeSlots.push_back(slot);
+			}
+		}
+
+		void History::Timeline::setLatest(uint32_t slot, uint16_t variable, unsigned long long timestamp)
+		{
+			std::vector<unsigned long long>& variables = latest[slot];
+
+			if (variable >= variables.size())
+				variables.resize(variable + 1, 0ULL);
+
+			variables[variable] = timestamp;
+		}
+
+		int History::Timeline::findPrevious(size_t end, uint32_t slot, uint16_t variable, size_t& index) const
+		{
+			end = std::min(end, count);
+
+			// A stale entry (its frame removed or replaced) falls back to the scan
+			if (variable < latest[slot].size() && latest[slot][variable])
+			{
+				unsigned long long timestamp = latest[slot][variable];
+				index = lowerBound(timestamp);
+
+				if (index < end && at(index).timestamp == timestamp)
+				{
+					int row = at(index).find(slot, variable);
+					if (row >= 0)
+						return row;
+				}
+			}
+
+			for (index = end; index > 0; --index)
+			{
+				int row = at(index - 1).find(slot, variable);
+
+				if (row >= 0)
+				{
+					--index;
+					return row;
 				}
+			}
+
+			return -1;
+		}
 
-				std::get<0>(componentIter->second)->unlock();
+		int History::Timeline::findNext(size_t begin, uint32_t slot, uint16_t variable, size_t& index) const
+		{
+			for (index = begin; index < count; ++index)
+			{
+				int row = at(index).find(slot, variable);
 
-				if (next != orderedVars.end())
-					next = orderedVars.upper_bound(iter->first);
+				if (row >= 0)
+					return row;
 			}
 
-			sceneIter->second.first.unlock();
+			return -1;
 		}
 	}
 }
\ No newline at end of file
@@ -3,13 +3,17 @@
 #include <atomic>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <tuple>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "RTTI.h"
 #include "UUID.h"
 
+#define HISTORY_CAPACITY 256	// Frames kept per scene before the oldest is overwritten
+
 namespace TechDemo
 {
 	namespace IO
@@ -21,6 +25,11 @@ namespace TechDemo
 	{
 		class ComponentBase;	//!< Forward declaration
 
+		// Logged state of each scene, kept as a fixed-capacity ring buffer of frames in timestamp order. Each frame stores its
+		// rows as parallel arrays: the components logged (as dense per-scene slots) with the variable rows each owns, and for
+		// each variable its id among the type's leaf variables, the time since it was previously logged and where its value
+		// sits in the frame's payload arena. Frames are reused in place once the buffer wraps. Changes are keyed by the same
+		// variable ids (see RTTI::Type::getVariableId).
 		class History
 		{
 			public:
@@ -28,242 +37,178 @@ namespace TechDemo
 
 				static std::list<std::shared_ptr<ComponentBase>> getState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp);
 
-				static IO::BitStream getState(const Util::UUID& sceneId, unsigned long long timestamp, const Util::UUID& componentId, const std::string& variable);
+				static IO::BitStream getState(const Util::UUID& sceneId, unsigned long long timestamp, const Util::UUID& componentId, uint16_t variable);
 
 				template <typename T>
 				static std::list<std::shared_ptr<T>> getState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp)
 				{
 					static_assert(std::is_base_of_v<ComponentBase, T>, "Invalid component type provided to History::getState.");
 
-					static const uint32_t targetHash = Util::CRC32::checksum(Util::getQualifiedName<T>());
+					if constexpr (std::is_same_v<T, ComponentBase>)
+						return getState(conn, sceneId, timestamp);
+					else
+					{
+						static const uint32_t targetHash = Util::CRC32::checksum(Util::getQualifiedName<T>());
+
+						std::list<std::shared_ptr<T>> result;
+
+						for (auto const& component : createState(conn, sceneId, timestamp, targetHash))
+							result.emplace_back(std::static_pointer_cast<T>(component));
+
+						return result;
+					}
+				}
+
+				static void applyState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp);
+
+				static void log(const Util::UUID& sceneId, unsigned long long timestamp);
 
-					std::list<std::shared_ptr<T>> result;
+				static void remove(const Util::UUID& sceneId, unsigned long long timestamp);
+
+				static void removeBefore(const Util::UUID& sceneId, unsigned long long timestamp);
 
-					dataLock.lock();
+				static void removeAfter(const Util::UUID& sceneId, unsigned long long timestamp);
 
-					auto sceneIter = data.find(sceneId);
-					if (sceneIter != data.end())
+				template <typename T>
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, IO::BitStream>> getChanges(const Util::UUID& sceneId, unsigned long long timestamp)
+				{
+					if constexpr (std::is_same_v<T, ComponentBase>)
+						return getChanges(sceneId, timestamp);
+					else
 					{
-						sceneIter->second.first.lock();
+						static const uint32_t typeHash = Util::CRC32::checksum(Util::getQualifiedName<T>());
+						return getFrameChanges(sceneId, timestamp, typeHash);
+					}
+				}
 
-						auto& frames = sceneIter->second.second;
-						auto frameIter = frames.lower_bound(timestamp);
-						bool isBetween = frameIter != frames.end() && frameIter->first != timestamp;
-						frameIter = isBetween ? frameIter != frames.begin() ? std::prev(frameIter) : frames.end() : frameIter;
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, IO::BitStream>> getChanges(const Util::UUID& sceneId, unsigned long long timestamp);
 
-						if (frameIter != frames.end())
-						{
-							frameIter->second.first->lock();
+				template <typename T>
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>> getChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive)
+				{
+					if constexpr (std::is_same_v<T, ComponentBase>)
+						return getChanges(sceneId, fromExclusive, toInclusive);
+					else
+					{
+						static const uint32_t typeHash = Util::CRC32::checksum(Util::getQualifiedName<T>());
+						return getRangeChanges(sceneId, fromExclusive, toInclusive, typeHash);
+					}
+				}
 
-							auto& components = frameIter->second.second;
-							for (auto& componentPair : components)
-							{
-								auto& uniqueId = componentPair.first;
-								auto& typeHash = std::get<1>(componentPair.second);
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>> getChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive);
 
-								if (typeHash == targetHash)
-								{
-									auto type = Util::RTTI::getType(typeHash);
+				// Records values received from a remote end into the frames at their timestamps, creating the frames as needed
+				static void applyChanges(Util::UUID const& componentId, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>> const& variables);
 
-									if (type != nullptr)
-									{
-										auto component = ComponentBase::create(typeHash);
+				// Removes the values of the component's variable logged within the range, as when a guess is superseded
+				static void removeChanges(Util::UUID const& componentId, uint16_t variable, unsigned long long fromExclusive, unsigned long long toInclusive);
 
-										if (component != nullptr)
-										{
-											component->uuid = uniqueId;
-											component->init();
+			private:
+				struct Frame
+				{
+					unsigned long long timestamp = 0ULL;
 
-											for (const auto& variable : type->getVariableNames())
-												getState(conn, frames, timestamp, component, variable);
+					// One row per component logged, sorted by slot
+					std::vector<uint32_t> slots;
+					std::vector<uint32_t> firsts = std::vector<uint32_t>(1, 0U);	// First variable row of each component, then the row count
 
-											result.emplace_back(component);
-										}
-									}
-								}
-							}
+					// One row per variable logged, grouped by component
+					std::vector<uint16_t> variables;		// Id among the component type's leaf variables
+					std::vector<unsigned long long> deltas;	// Time since the variable was previously logged
+					std::vector<uint32_t> offsets;			// Byte offset of the value in the payload
+					std::vector<uint32_t> sizes;			// Bits of the value
 
-							frameIter->second.first->unlock();
-						}
+					std::vector<char> payload;
 
-						sceneIter->second.first.unlock();
-					}
+					// Keeps the storage for the next frame written here
+					void clear();
 
-					dataLock.unlock();
+					bool empty() const;
 
-					return result;
-				}
+					// Row of the component, or -1
+					int find(uint32_t slot) const;
 
-				template <>
-				static std::list<std::shared_ptr<ComponentBase>> getState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp)
-				{
-					return getState(conn, sceneId, timestamp);
-				}
+					// Row of the component's variable, or -1
+					int find(uint32_t slot, uint16_t variable) const;
 
-				static void applyState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp);
+					IO::BitStream getValue(size_t row) const;
 
-				static void log(const Util::UUID& sceneId, unsigned long long timestamp);
+					bool equals(size_t row, IO::BitStream const& value) const;
 
-				static void remove(const Util::UUID& sceneId, unsigned long long timestamp);
+					// Appending is only valid for slots above the last, until sort is called
+					void append(uint32_t slot);
 
-				static void removeBefore(const Util::UUID& sceneId, unsigned long long timestamp);
+					void append(uint16_t variable, unsigned long long delta, IO::BitStream const& value);
 
-				static void removeAfter(const Util::UUID& sceneId, unsigned long long timestamp);
+					// Returns the component's row, inserting it in slot order if needed
+					size_t insert(uint32_t slot);
 
-				template <typename T>
-				static std::unordered_map<Util::UUID, std::unordered_map<std::string, IO::BitStream>> getChanges(const Util::UUID& sceneId, unsigned long long timestamp)
+					// Sets the variable of the component row, inserting it if needed
+					void set(size_t component, uint16_t variable, unsigned long long delta, IO::BitStream const& value);
+
+					// Removes the variable of the component row, and the component once it has none left
+					void erase(size_t component, uint16_t variable);
+
+					void sort();
+				};
+
+				struct Timeline
 				{
-					std::unordered_map<Util::UUID, std::unordered_map<std::string, IO::BitStream>> result;
+					std::vector<Frame> frames = std::vector<Frame>(HISTORY_CAPACITY);	// Ring buffer
+					size_t head = 0;		// Oldest frame
+					size_t count = 0;
+					std::unordered_map<Util::UUID, uint32_t> slots;
+					std::vector<Util::UUID> components;	// Component of each slot
+					std::vector<uint32_t> types;		// Type hash of each slot (0 once reclaimed)
+					std::vector<std::vector<unsigned long long>> latest;	// Newest frame logging each of a slot's variables, by timestamp (0 if unknown)
+					std::vector<uint32_t> freeSlots;	// Reclaimed slots, reused before new ones
+					size_t inserted = 0;				// Frames inserted since the last reclaim
+					std::recursive_mutex lock;
 
-					dataLock.lock();
+					// Index 0 is the oldest frame
+					Frame& at(size_t index);
 
-					auto sceneIter = data.find(sceneId);
-					if (sceneIter != data.end())
-					{
-						auto& frameMutex = sceneIter->second.first;
-						auto& frames = sceneIter->second.second;
-						frameMutex.lock();
-						dataLock.unlock();
-
-						auto frameIter = frames.find(timestamp);
-						if (frameIter != frames.end())
-						{
-							auto componentMutex = frameIter->second.first;
-							auto& components = frameIter->second.second;
-							componentMutex->lock();
-							frameMutex.unlock();
-
-							static uint32_t typeHash = Util::CRC32::checksum(Util::getQualifiedName<T>());
-
-							for (auto& component : components)
-							{
-								auto& varMutex = std::get<0>(component.second);
-								auto& varType = std::get<1>(component.second);
-								auto& variables = std::get<2>(component.second);
-
-								if (varType == typeHash)
-								{
-									std::unordered_map<std::string, IO::BitStream> varData;
-
-									varMutex.lock();
-									for (auto& variable : variables)
-									{
-										auto& streamMutex = variable.second.first;
-
-										streamMutex.lock();
-										auto stream = std::get<1>(variable.second.second);
-										streamMutex.unlock();
-
-										varData.emplace(variable.first, std::move(stream));
-									}
-									varMutex.unlock();
-
-									result.emplace(component.first, std::move(varData));
-								}
-							}
-
-							componentMutex->unlock();
-						}
-						else frameMutex.unlock();
-					}
-					else dataLock.unlock();
+					Frame const& at(size_t index) const;
 
-					return result;
-				}
+					// Frames before the index are older than the timestamp
+					size_t lowerBound(unsigned long long timestamp) const;
 
-				template <>
-				static std::unordered_map<Util::UUID, std::unordered_map<std::string, IO::BitStream>> getChanges<World::ComponentBase>(const Util::UUID& sceneId, unsigned long long timestamp)
-				{
-					return getChanges(sceneId, timestamp);
-				}
+					// Frames before the index are no newer than the timestamp
+					size_t upperBound(unsigned long long timestamp) const;
 
-				static std::unordered_map<Util::UUID, std::unordered_map<std::string, IO::BitStream>> getChanges(const Util::UUID& sceneId, unsigned long long timestamp);
+					// Returns the frame at the timestamp, inserted in order if needed. Returns nullptr for timestamps older than
+					// every frame of a full buffer.
+					Frame* insert(unsigned long long timestamp);
 
-				template <typename T>
-				static std::unordered_map<Util::UUID, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>>> getChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive)
-				{
-					std::unordered_map<Util::UUID, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>>> result;
+					void erase(size_t index);
 
-					if (toInclusive > fromExclusive)
-					{
-						dataLock.lock();
-
-						auto sceneIter = data.find(sceneId);
-						if (sceneIter != data.end())
-						{
-							auto& frameMutex = sceneIter->second.first;
-							auto& frames = sceneIter->second.second;
-							frameMutex.lock();
-							dataLock.unlock();
-
-							auto iter = std::reverse_iterator(frames.lower_bound(toInclusive));
-							iter = iter == frames.rend() ? std::reverse_iterator(frames.begin()) : iter->first == toInclusive ? iter : iter != frames.rend() ? std::next(iter) : iter;
-							auto from = std::reverse_iterator(frames.lower_bound(fromExclusive));
-							from = from == frames.rend() || from->first == fromExclusive ? from : from != frames.rbegin() ? std::next(from) : frames.rend();
-
-							if (iter != frames.rend())
-							{
-								static const uint32_t typeHash = Util::CRC32::checksum(Util::getQualifiedName<T>());
-
-								for (; iter != from; ++iter)
-								{
-									auto componentMutex = iter->second.first;
-									auto& components = iter->second.second;
-									componentMutex->lock();
-
-									for (auto& component : components)
-									{
-										auto& varType = std::get<1>(component.second);
-
-										if (varType == typeHash)
-										{
-											auto& varMutex = std::get<0>(component.second);
-											auto& variables = std::get<2>(component.second);
-
-											varMutex.lock();
-											for (auto& variable : variables)
-											{
-												auto& streamMutex = variable.second.first;
-
-												streamMutex.lock();
-												auto stream = std::get<1>(variable.second.second);
-												streamMutex.unlock();
-
-												result[component.first].try_emplace(variable.first, std::make_pair(iter->first, std::move(stream)));
-											}
-											varMutex.unlock();
-										}
-									}
-
-									componentMutex->unlock();
-								}
-							}
-
-							frameMutex.unlock();
-						}
-						else dataLock.unlock();
-					}
+					uint32_t getSlot(Util::UUID const& componentId, uint32_t typeHash);
 
-					return result;
-				}
+					// Frees the slots of destroyed components that no frame refers to anymore. Only does so once per turn of the
+					// ring, by which time a destroyed component's rows have been overwritten.
+					void reclaim();
 
-				template <>
-				static std::unordered_map<Util::UUID, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>>> getChanges<World::ComponentBase>(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive)
-				{
-					return getChanges(sceneId, fromExclusive, toInclusive);
-				}
+					// Remembers the frame as the newest logging the variable
+					void setLatest(uint32_t slot, uint16_t variable, unsigned long long timestamp);
 
-				static std::unordered_map<Util::UUID, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>>> getChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive);
+					// Searches the frames before end, newest first, for the variable. Returns the row, or -1. Answered from the
+					// variable's newest log when that precedes end, so only searches into the past scan the frames.
+					int findPrevious(size_t end, uint32_t slot, uint16_t variable, size_t& index) const;
 
-				static void applyChanges(Util::UUID const& componentId, std::unordered_map<std::string, std::pair<unsigned long long, IO::BitStream>> const& variables);
+					// Searches the frames from begin, oldest first, for the variable. Returns the row, or -1.
+					int findNext(size_t begin, uint32_t slot, uint16_t variable, size_t& index) const;
+				};
 
-			private:
-				using changeEntryType = std::tuple<unsigned long long, IO::BitStream>;																			// Record of delta since last change and new value
-				using componentVarEntryType = std::unordered_map<std::string, std::pair<std::shared_ptr<std::recursive_mutex>, changeEntryType>>;				// For a given variable (by name) [uint32_t represents component type hash]
-				using componentEntryType = std::unordered_map<Util::UUID, std::tuple<std::shared_ptr<std::recursive_mutex>, uint32_t, componentVarEntryType>>;	// For a given component (by component's UUID)
-				using frameEntryType = std::map<unsigned long long, std::pair<std::shared_ptr<std::recursive_mutex>, componentEntryType>>;						// For a given frame (by closest server timestamp [sorted in ascending order])
+				static Timeline* getTimeline(const Util::UUID& sceneId, bool create);
+
+				// A type hash of 0 includes every component
+				static std::list<std::shared_ptr<ComponentBase>> createState(const std::shared_ptr<IO::Connection>& conn, const Util::UUID& sceneId, unsigned long long timestamp, uint32_t typeHash);
+
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, IO::BitStream>> getFrameChanges(const Util::UUID& sceneId, unsigned long long timestamp, uint32_t typeHash);
+
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>> getRangeChanges(const Util::UUID& sceneId, unsigned long long fromExclusive, unsigned long long toInclusive, uint32_t typeHash);
 
-				static std::unordered_map<Util::UUID, std::pair<std::recursive_mutex, frameEntryType>> data;													// For a given scene (by scene's UUID)
+				static std::unordered_map<Util::UUID, std::unique_ptr<Timeline>> data;	// For a given scene (by scene's UUID)
 				static std::recursive_mutex dataLock;
 
 				static std::unordered_map<Util::UUID, unsigned long long> lastChange;
@@ -273,7 +218,7 @@ namespace TechDemo
 				static std::unordered_map<Util::UUID, std::multimap<unsigned long long, std::shared_ptr<IO::Connection>>>& pendingUpdates();
 				static std::mutex& getUpdatesLock();
 
-				static void getState(const std::shared_ptr<IO::Connection>& conn, decltype(data)::iterator::value_type::second_type::second_type& frames, unsigned long long timestamp, std::shared_ptr<ComponentBase>& component, const std::string& variable);
+				static void getState(const std::shared_ptr<IO::Connection>& conn, Timeline& timeline, unsigned long long timestamp, std::shared_ptr<ComponentBase>& component, uint32_t slot, uint16_t variable);
 		};
 	}
 }
\ No newline at end of file
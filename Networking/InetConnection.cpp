@@ -2,6 +2,7 @@
 #pragma comment (lib, "Mswsock.lib")
 #pragma comment (lib, "AdvApi32.lib")
 
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <set>
@@ -15,15 +16,21 @@
 #include <ws2tcpip.h>
 #include <iphlpapi.h>
 
-#include "Clock.h"
 #include "Engine.h"
+#include "HandshakeCookie.h"
 #include "InetConnection.h"
+#include "MetricsExporter.h"
 #include "Packet.h"
+#include "PacketDispatcher.h"
 #include "PacketHandshake.h"
+#include "PacketMTUProbe.h"
 #include "PacketNACK.h"
 #include "PlayerConnection.h"
+#include "TimingWheel.h"
 
-#define BUFFER_SIZE 1300
+#define MTU_PROBE_TIMEOUT 5		// Connection ticks to wait for a probe acknowledgement
+#define MTU_PROBE_ATTEMPTS 2	// Unacknowledged probes of a size before the size is ruled out
+#define MTU_PROBE_PRECISION 8	// Search window (in bytes) at which probing stops
 
 namespace TechDemo
 {
@@ -31,10 +38,12 @@ namespace TechDemo
 	{
 		InetConnection::InetConnection() : Connection()
 		{
+			handlers = std::make_shared<PacketHandlerPool::Queue>(*dynamic_cast<Connection const*>(this), Direction::Clientbound, metrics);
 		}
 
 		InetConnection::InetConnection(std::string const& ipAddress, unsigned short port, unsigned socket) : Connection(), socket(socket), ipAddress(ipAddress), port(port), local(false)
 		{
+			handlers = std::make_shared<PacketHandlerPool::Queue>(*dynamic_cast<Connection const*>(this), Direction::Serverbound, metrics);
 			connected = true;
 		}
 
@@ -45,6 +54,8 @@ namespace TechDemo
 
 			if (listeningThread.joinable())
 				listeningThread.join();
+
+			handlers->close();
 		}
 
 		bool InetConnection::connect(std::string const& address)
@@ -63,69 +74,90 @@ namespace TechDemo
 			return false;
 		}
 
-		bool InetConnection::connect(std::string const& ipAddress, unsigned short port)
+		bool InetConnection::open(std::string const& ipAddress, unsigned short port)
 		{
-			if (!connected && local)
+			sockaddr_storage addr = { 0 };
+
+			sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
+
+			int result = inet_pton(AF_INET, ipAddress.c_str(), &inAddr.sin_addr);
+			if (result == 0)
 			{
-				sockaddr_storage addr = { 0 };
+				std::cerr << "An error occurred while parsing a provided IP address: Invalid IP address." << std::endl;
+				return false;
+			}
+			else if (result == -1)
+			{
+				std::cerr << "An error occurred while parsing a provided IP address: " << getLastError().second;
+				return false;
+			}
 
-				sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
+			inAddr.sin_family = AF_INET;
+			inAddr.sin_port = htons(port);
 
-				int result = inet_pton(AF_INET, ipAddress.c_str(), &inAddr.sin_addr);
-				if (result == 0)
-				{
-					std::cerr << "An error occurred while parsing a provided IP address: Invalid IP address." << std::endl;
-					return false;
-				}
-				else if (result == -1)
-				{
-					std::cerr << "An error occurred while parsing a provided IP address: " << getLastError().second;
-					return false;
-				}
+			if ((socket = backend == SocketBackend::RegisteredIO ? RegisteredIO::createSocket() : ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == SOCKET_ERROR)
+			{
+				std::cerr << "An error occurred while creating a new socket: " << getLastError().second;
+				return false;
+			}
 
-				inAddr.sin_family = AF_INET;
-				inAddr.sin_port = htons(port);
+			// Oversized datagrams must be dropped (rather than fragmented by IP) for path MTU probes to be meaningful
+			DWORD dontFragment = TRUE;
+			if (setsockopt(socket, IPPROTO_IP, IP_DONTFRAGMENT, reinterpret_cast<const char*>(&dontFragment), sizeof(dontFragment)) == SOCKET_ERROR)
+				std::cerr << "An error occurred while disabling fragmentation: " << getLastError().second;
 
-				if ((socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == SOCKET_ERROR)
-				{
-					std::cerr << "An error occurred while creating a new socket: " << getLastError().second;
-					return false;
-				}
+			/*char opt = 1;
+			if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == SOCKET_ERROR)
+			{
+				std::cerr << "An error occurred while setting a socket setting: " << getLastError();
+				return false;
+			}*/
 
-				/*char opt = 1;
-				if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == SOCKET_ERROR)
-				{
-					std::cerr << "An error occurred while setting a socket setting: " << getLastError();
-					return false;
-				}*/
+			if ((::connect(socket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) == SOCKET_ERROR)
+			{
+				std::cerr << "An error occurred while attempting to connect to the address \"" << ipAddress << ":" << std::to_string(port) << "\": " << getLastError().second;
+				closesocket(socket);
+				socket = 0;
+				return false;
+			}
 
-				if ((::connect(socket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) == SOCKET_ERROR)
-				{
-					std::cerr << "An error occurred while attempting to connect to the address \"" << ipAddress << ":" << std::to_string(port) << "\": " << getLastError().second;
-					closesocket(socket);
-					socket = 0;
-					return false;
-				}
+			/*int bufferSize = 65535;
+			if (setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize)) == -1)
+				std::cerr << getLastError().second;
+			
+			if (setsockopt(socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize)) == -1)
+				std::cerr << getLastError().second;*/
 
-				/*int bufferSize = 65535;
-				if (setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize)) == -1)
-					std::cerr << getLastError().second;
-				
-				if (setsockopt(socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize)) == -1)
-					std::cerr << getLastError().second;*/
+			char address[INET6_ADDRSTRLEN] = {0};
+			inet_ntop(AF_INET, getInetAddr(reinterpret_cast<sockaddr*>(&addr)), address, INET6_ADDRSTRLEN);
+
+			this->ipAddress = address;
+			this->port = port;
+
+			int addrLen = sizeof(addr);
+			getsockname(socket, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+			localPort = ntohs(reinterpret_cast<const sockaddr*>(&addr)->sa_family == AF_INET ? inAddr.sin_port : reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_port);
 
-				char address[INET6_ADDRSTRLEN] = {0};
-				inet_ntop(AF_INET, getInetAddr(reinterpret_cast<sockaddr*>(&addr)), address, INET6_ADDRSTRLEN);
+			registeredIO.reset();
+			if (backend == SocketBackend::RegisteredIO)
+			{
+				std::shared_ptr<RegisteredIO> rio = std::make_shared<RegisteredIO>();
+
+				// The socket remains usable through the regular calls, so fall back to them if registration fails
+				if (rio->open(socket))
+					registeredIO = rio;
+			}
 
-				this->ipAddress = address;
-				this->port = port;
+			connecting = true;
 
-				int addrLen = sizeof(addr);
-				getsockname(socket, reinterpret_cast<sockaddr*>(&addr), &addrLen);
-				localPort = ntohs(reinterpret_cast<const sockaddr*>(&addr)->sa_family == AF_INET ? inAddr.sin_port : reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_port);
-				connecting = true;
+			return true;
+		}
 
-				dataClock = Util::Clock::addClock(1, [this]()
+		bool InetConnection::connect(std::string const& ipAddress, unsigned short port)
+		{
+			if (!connected && local && open(ipAddress, port))
+			{
+				dataClock = Util::TimingWheel::addSpread(std::chrono::milliseconds(CONNECTION_STATS_PERIOD), [this]()
 				{
 					if (isConnected())
 					{
@@ -136,6 +168,9 @@ namespace TechDemo
 						Engine::clientPacketsLostHistory.push_back(static_cast<float>(packetsLost));
 						Engine::clientPacketsDuplicatedHistory.push_back(static_cast<float>(packetsDuplicated));
 
+						metrics.sample();
+						MetricsExporter::publish();
+
 						if (Engine::clientSentHistory.size() > 50)
 							Engine::clientSentHistory.erase(Engine::clientSentHistory.begin());
 
@@ -161,9 +196,9 @@ namespace TechDemo
 					packetsResent = 0;
 					packetsLost = 0;
 					packetsDuplicated = 0;
-				}, Util::Clock::getMainThreadId());
+				});
 
-				send(new PacketHandshake);
+				sendHandshake();
 
 				std::thread thread(&InetConnection::connectLoop, this);
 
@@ -184,7 +219,7 @@ namespace TechDemo
 				{
 					shutdown(socket, SD_SEND);
 
-					Util::Clock::removeClock(dataClock);
+					Util::TimingWheel::remove(dataClock);
 					dataClock = 0;
 				}
 				socket = 0;
@@ -204,6 +239,13 @@ namespace TechDemo
 
 		bool InetConnection::send(std::shared_ptr<PacketBase> const& packet) const
 		{
+			return send(packet, getPayloadSize());
+		}
+
+		bool InetConnection::send(std::shared_ptr<PacketBase> const& packet, unsigned short fragmentSize) const
+		{
+			auto requested = std::chrono::steady_clock::now();
+
 			if (packet && (connected || connecting) && socket)
 			{
 				std::lock_guard lock(sendLock);
@@ -211,7 +253,7 @@ namespace TechDemo
 				{
 					IO::BitStream str, buff;
 
-					str.write(packet->getId());
+					PacketDispatcher::writeId(str, packet->getId());
 					packet->serialize(str);
 
 					auto& data = str.data();
@@ -219,13 +261,17 @@ namespace TechDemo
 					buff.write(sequenceNumber);
 					buff.write(static_cast<uint16_t>(str.size()), 16);
 
-					for (size_t remaining = data.size(), size = std::min(remaining, static_cast<size_t>(BUFFER_SIZE) - buff.data().size()), offset = 0; remaining > 0; remaining -= size, offset += size, size = std::min(remaining, static_cast<size_t>(BUFFER_SIZE) - buff.data().size()))
+					for (size_t remaining = data.size(), size = std::min(remaining, static_cast<size_t>(fragmentSize) - buff.data().size()), offset = 0; remaining > 0; remaining -= size, offset += size, size = std::min(remaining, static_cast<size_t>(fragmentSize) - buff.data().size()))
 					{
 						std::string b = str.data(offset, size);
 						buff.write(b.data(), static_cast<unsigned>(std::min(b.size() * Util::byteSize(), str.size() - (offset * Util::byteSize()))));
 
 						std::string buffer(buff.data().data(), buff.data().size());
 
+						// The handshake is padded to the size of the server's cookie reply, which is never larger than what it answers
+						if (connecting && sequenceNumber == handshakeSequenceNumber && buffer.size() < COOKIE_DATAGRAM_SIZE)
+							buffer.resize(COOKIE_DATAGRAM_SIZE, '\0');
+
 						if (packet->shouldRetransmit())
 						{
 							sentPacketLock.lock();
@@ -245,7 +291,7 @@ namespace TechDemo
 						}
 						
 						// TODO: Replace with priority order controlled buffer
-						if (::send(socket, buffer.data(), buffer.size(), 0) == SOCKET_ERROR)
+						if (transmit(buffer.data(), static_cast<unsigned>(buffer.size())) == SOCKET_ERROR)
 						{
 							std::cerr << "An error occurred while sending a packet: " << getLastError().second;
 							return false;
@@ -253,12 +299,57 @@ namespace TechDemo
 
 						bytesSent += buffer.size();
 						++packetsSent;
+						metrics.recordDatagramSent(buffer.size());
 						buff.clear();
 
+						protect(sequenceNumber, buffer.data(), static_cast<unsigned>(buffer.size()));
+
 						if (remaining - size > 0)
 							buff.write(sequenceNumber = nextSequenceNumber++);
 					}
 
+					metrics.recordSent(packet->shouldRetransmit() ? Channel::Reliable : Channel::Unreliable, data.size());
+					metrics.getQueueDelay().record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - requested).count());
+
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool InetConnection::sendUnsequenced(std::shared_ptr<PacketBase> const& packet) const
+		{
+			if (packet && connected && socket)
+			{
+				IO::BitStream str, buff;
+
+				PacketDispatcher::writeId(str, packet->getId());
+				packet->serialize(str);
+
+				// Sequence number (4) and packet length (2)
+				if (str.data().size() + 6 > getPayloadSize())
+					return send(packet);
+
+				std::lock_guard lock(sendLock);
+				if (connected)
+				{
+					// Numbered against the window without taking a sequence number from it, so nothing waits on or NACKs it
+					buff.write(static_cast<uint32_t>(nextSequenceNumber + UNSEQUENCED_OFFSET));
+					buff.write(static_cast<uint16_t>(str.size()), 16);
+					buff.write(str.data().data(), static_cast<unsigned>(str.size()));
+
+					if (transmit(buff.data().data(), static_cast<unsigned>(buff.data().size())) == SOCKET_ERROR)
+					{
+						std::cerr << "An error occurred while sending a packet: " << getLastError().second;
+						return false;
+					}
+
+					bytesSent += buff.data().size();
+					++packetsSent;
+					metrics.recordDatagramSent(buff.data().size());
+					metrics.recordSent(Channel::Unreliable, str.data().size());
+
 					return true;
 				}
 			}
@@ -274,7 +365,7 @@ namespace TechDemo
 
 				if (connected || connecting)
 				{
-					if (::send(socket, data, length, 0) == SOCKET_ERROR)
+					if (transmit(data, length) == SOCKET_ERROR)
 					{
 						std::cerr << "An error occurred while sending a packet: " << getLastError().second;
 						return false;
@@ -282,6 +373,7 @@ namespace TechDemo
 
 					bytesSent += length;
 					++packetsResent;
+					metrics.recordResent(length);
 
 					return true;
 				}
@@ -290,6 +382,38 @@ namespace TechDemo
 			return false;
 		}
 
+		int InetConnection::transmit(const char* data, unsigned length) const
+		{
+			if (std::shared_ptr<LinkEmulator> emulator = linkEmulator)
+				return emulator->transmit(Direction::Serverbound, socket, data, length);
+
+			if (std::shared_ptr<RegisteredIO> rio = registeredIO)
+				return rio->send(data, length);
+
+			return ::send(socket, data, static_cast<int>(length), 0);
+		}
+
+		int InetConnection::transmit(const char* header, unsigned headerLength, const char* data, unsigned length) const
+		{
+			// The link emulator and Registered I/O copy datagrams into buffers of their own regardless
+			if (linkEmulator || registeredIO)
+			{
+				char datagram[MAX_FRAGMENT_SIZE];
+				std::memcpy(datagram, header, headerLength);
+				std::memcpy(datagram + headerLength, data, length);
+
+				return transmit(datagram, headerLength + length);
+			}
+
+			WSABUF buffers[2] = { { headerLength, const_cast<char*>(header) }, { length, const_cast<char*>(data) } };
+			DWORD sent = 0;
+
+			if (WSASend(socket, buffers, 2, &sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+				return SOCKET_ERROR;
+
+			return static_cast<int>(sent);
+		}
+
 		std::string const& InetConnection::getRemoteAddress() const
 		{
 			return ipAddress;
@@ -315,8 +439,205 @@ namespace TechDemo
 			return timeOffset;
 		}
 
+		unsigned short InetConnection::getFragmentSize() const
+		{
+			return fragmentSize;
+		}
+
+		ConnectionMetrics const& InetConnection::getMetrics() const
+		{
+			return metrics;
+		}
+
+		void InetConnection::setParity(bool enabled)
+		{
+			parityEncoder.setEnabled(enabled);
+		}
+
+		bool InetConnection::getParity() const
+		{
+			return parityEncoder.isEnabled();
+		}
+
+		unsigned short InetConnection::getPayloadSize() const
+		{
+			return parityEncoder.isEnabled() ? fragmentSize - FEC_OVERHEAD : fragmentSize;
+		}
+
+		void InetConnection::protect(uint32_t sequenceNumber, const char* header, unsigned headerLength, const char* data, unsigned length) const
+		{
+			// MTU probes are larger than the parity datagram may be
+			if (headerLength + length > getPayloadSize())
+			{
+				parityEncoder.skip();
+				return;
+			}
+
+			std::string parity = parityEncoder.add(sequenceNumber, header, headerLength, data, length);
+
+			if (!parity.empty())
+			{
+				if (transmit(parity.data(), static_cast<unsigned>(parity.size())) == SOCKET_ERROR)
+					std::cerr << "An error occurred while sending a parity datagram: " << getLastError().second;
+				else
+					metrics.recordDatagramSent(parity.size());
+			}
+		}
+
+		void InetConnection::adaptParity()
+		{
+			std::lock_guard lock(sendLock);
+
+			ConnectionMetrics::Totals totals = metrics.getTotals();
+			parityEncoder.adapt(totals.packetsSent, totals.packetsResent);
+		}
+
+		void InetConnection::sendHandshake()
+		{
+			std::lock_guard lock(sendLock);
+
+			handshakeSequenceNumber = nextSequenceNumber;
+			handshakeCookie.clear();
+			handshakeTicks = 0;
+
+			send(new PacketHandshake);
+		}
+
+		void InetConnection::retryHandshake()
+		{
+			std::lock_guard lock(sendLock);
+
+			if (initialized || ++handshakeTicks < HANDSHAKE_RETRY_TICKS)
+				return;
+
+			handshakeTicks = 0;
+			resendHandshake();
+		}
+
+		bool InetConnection::resendHandshake() const
+		{
+			std::string datagram;
+
+			sentPacketLock.lock();
+			auto iter = sentPackets.find(handshakeSequenceNumber);
+			if (iter != sentPackets.end())
+				datagram = handshakeCookie + iter->second;
+			sentPacketLock.unlock();
+
+			return !datagram.empty() && send(datagram.data(), static_cast<unsigned short>(datagram.size()));
+		}
+
+		void InetConnection::dispatch(PacketDispatcher::Lease&& packet)
+		{
+			handlers->push(std::move(packet));
+		}
+
+		void InetConnection::receiveUnsequenced(BitStream& data)
+		{
+			uint16_t size = 0;
+
+			if (data.remaining() < 16)
+				return;
+
+			data.read(size, 16);
+
+			if (!size || size > data.remaining())
+				return;
+
+			PacketDispatcher::Lease packet = PacketDispatcher::acquire(data);
+
+			if (packet)
+			{
+				packet->deserialize(data);
+				metrics.recordReceived(Channel::Unreliable, size / Util::byteSize());
+				dispatch(std::move(packet));
+			}
+		}
+
+		bool InetConnection::isUnsequenced(uint32_t sequenceNumber, uint32_t expectedSequenceNumber)
+		{
+			// Between the window, an eighth of the sequence space either side of the expected number, and the parity datagrams
+			uint32_t distance = sequenceNumber - expectedSequenceNumber;
+			return distance >= UNSEQUENCED_OFFSET / 2 && distance < UNSEQUENCED_OFFSET + UNSEQUENCED_OFFSET / 2;
+		}
+
+		void InetConnection::probeMTU()
+		{
+			std::lock_guard lock(mtuLock);
+
+			if (mtuProbe)
+			{
+				if (++mtuProbeTicks < MTU_PROBE_TIMEOUT)
+					return;
+
+				// A single lost probe may be ordinary packet loss, so only rule the size out after repeated failures
+				if (++mtuProbeAttempts >= MTU_PROBE_ATTEMPTS)
+				{
+					mtuHigh = mtuProbe - 1;
+					mtuProbeAttempts = 0;
+
+					if (fragmentSize > mtuHigh)
+						fragmentSize = std::max(mtuLow, mtuHigh);
+				}
+
+				mtuProbe = 0;
+			}
+
+			if (mtuHigh - mtuLow <= MTU_PROBE_PRECISION)
+			{
+				fragmentSize = mtuLow;
+				return;
+			}
+
+			mtuProbe = static_cast<unsigned short>(mtuLow + (mtuHigh - mtuLow + 1) / 2);
+			mtuProbeTicks = 0;
+
+			if (!send(std::shared_ptr<PacketBase>(new PacketMTUProbe(mtuProbe)), mtuProbe))
+			{
+				// Rejected locally (e.g. larger than the interface MTU with fragmentation disabled)
+				mtuHigh = mtuProbe - 1;
+				mtuProbe = 0;
+				mtuProbeAttempts = 0;
+			}
+		}
+
+		void InetConnection::confirmMTU(unsigned short size)
+		{
+			std::lock_guard lock(mtuLock);
+
+			if (size == mtuProbe)
+			{
+				mtuProbe = 0;
+				mtuProbeAttempts = 0;
+			}
+
+			mtuLow = std::max(mtuLow, std::min(size, mtuHigh));
+
+			if (mtuLow > fragmentSize)
+				fragmentSize = mtuLow;
+		}
+
 		void InetConnection::connectLoop()
 		{
+			if (std::shared_ptr<RegisteredIO> rio = registeredIO)
+			{
+				while (connected || connecting)
+				{
+					receiveDelivered();
+
+					if (rio->poll([this](sockaddr_storage&, char* buffer, int bytes)
+					{
+						if (std::shared_ptr<DatagramCapture> capture = this->capture)
+							capture->record(nullptr, buffer, bytes);
+
+						receive(buffer, bytes);
+					}, 5) == SOCKET_ERROR)
+						disconnect();
+				}
+
+				return;
+			}
+
 			fd_set fds, reads;
 			FD_ZERO(&fds);
 			FD_SET(socket, &fds);
@@ -327,17 +648,17 @@ namespace TechDemo
 
 			while (connected || connecting)
 			{
+				receiveDelivered();
+
 				reads = fds;
 
 				if (::select(socket + 1, &reads, nullptr, nullptr, &timeout) <= 0)
 					continue;
 
-				static bool verbose = false;
-
 				int bytes = 0;
-				char buffer[BUFFER_SIZE];
+				char buffer[MAX_FRAGMENT_SIZE];
 
-				if ((bytes = ::recv(socket, buffer, BUFFER_SIZE, 0)) == SOCKET_ERROR)
+				if ((bytes = ::recv(socket, buffer, MAX_FRAGMENT_SIZE, 0)) == SOCKET_ERROR)
 				{
 					std::pair<int, std::string> error = getLastError();
 
@@ -350,285 +671,344 @@ namespace TechDemo
 					continue;
 				}
 
-				/*if (packetDropChance)
-				{
-					verbose = true;
-					__debugbreak();
-				}*/
+				if (std::shared_ptr<DatagramCapture> capture = this->capture)
+					capture->record(nullptr, buffer, bytes);
 
-				if (verbose)
-					std::cout << "Received bytes: " << bytes << std::endl;
+				receive(buffer, bytes);
+			}
+		}
 
-				bytesRcvd += bytes;
+		void InetConnection::receive(char* buffer, int bytes)
+		{
+			static bool verbose = false;
 
-				IO::BitStream data(buffer, bytes);
+			/*if (packetDropChance)
+			{
+				verbose = true;
+				__debugbreak();
+			}*/
 
-				uint32_t sequenceNumber = 0;
-				data.read(sequenceNumber);
+			if (verbose)
+				std::cout << "Received bytes: " << bytes << std::endl;
 
-				if (verbose)
-					std::cout << "Sequence number " << sequenceNumber << std::endl;
+			bytesRcvd += bytes;
+			metrics.recordDatagramReceived(bytes);
 
-				if (!initialized)
-				{
-					if (data.remaining() >= 48)
-					{
-						static const uint32_t handshakeId = Util::CRC32::checksum(typeid(PacketHandshake).name());
+			IO::BitStream data(buffer, bytes);
 
-						lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
+			uint32_t sequenceNumber = 0;
+			data.read(sequenceNumber);
 
-						unsigned long readBit = data.readBit();
+			if (verbose)
+				std::cout << "Sequence number " << sequenceNumber << std::endl;
 
-						data.skip(16);
+			// The server admits no connection until the handshake has been echoed with its cookie
+			if (!initialized && bytes == COOKIE_DATAGRAM_SIZE && HandshakeCookie::isCookie(buffer, bytes))
+			{
+				std::lock_guard lock(sendLock);
 
-						uint32_t typeId = 0;
-						data.read(typeId);
+				handshakeCookie.assign(buffer, bytes);
+				handshakeTicks = 0;
+				resendHandshake();
 
-						data.readBit(readBit);
+				return;
+			}
 
-						if (typeId != handshakeId)
-						{
-							receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
-							continue;
-						}
-						else
-						{
-							expectedSequenceNumber = sequenceNumber;
-							initialized = true;
+			if (initialized && ParityDecoder::isParity(sequenceNumber, expectedSequenceNumber))
+			{
+				if (!connecting && Util::Random::rand(0.0f, 1.0f) < packetDropChance)
+					return;
 
-							if (lastSequenceNumber != sequenceNumber)
-							{
-								auto next = receivedPackets.upper_bound(sequenceNumber);
+				std::string recovered = parityDecoder.recover(buffer, bytes, expectedSequenceNumber);
 
-								uint32_t difference = next->first - sequenceNumber;
+				if (!recovered.empty())
+				{
+					if (verbose)
+						std::cout << "Recovered a lost datagram from parity" << std::endl;
 
-								if (difference > 1)
-								{
-									packetsLost += difference - 1;
+					receive(recovered.data(), static_cast<int>(recovered.size()));
+				}
 
-									missingPacketsLock.lock();
-									for (uint32_t i = sequenceNumber + 1; i < next->first; missingPackets.emplace(i++));
-									missingPacketsLock.unlock();
+				return;
+			}
 
-									send(new PacketNACK(sequenceNumber + 1, difference - 1));
-								}
-							}
-						}
-					}
-					else
-					{
-						receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
-						lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
-						continue;
-					}
-				}
+			if (initialized && isUnsequenced(sequenceNumber, expectedSequenceNumber))
+			{
+				receiveUnsequenced(data);
+				return;
+			}
 
-				if (!connecting && Util::Random::rand(0.0f, 1.0f) < packetDropChance)
+			if (!initialized)
+			{
+				// Packet length (16), then the packet's dense id (16)
+				if (data.remaining() >= 32)
 				{
-					++packetsLost;
-					missingPacketsLock.lock();
-					missingPackets.emplace(sequenceNumber);
-					missingPacketsLock.unlock();
-					lastSequenceNumber = std::max(lastSequenceNumber, sequenceNumber);
-					send(new PacketNACK(sequenceNumber, 1));
-					continue;
-				}
+					static const uint32_t handshakeId = Util::CRC32::checksum(typeid(PacketHandshake).name());
 
-				missingPacketsLock.lock();
-				missingPackets.erase(sequenceNumber);
-				missingPacketsLock.unlock();
+					lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
 
-				if (expectedSequenceNumber == sequenceNumber)
-				{
-					++expectedSequenceNumber;
+					size_t readBit = data.readBit();
 
-					if (verbose)
-						std::cout << "Expected the sequence number" << std::endl;
+					data.skip(16);
 
-					//std::cout << "In: " << sequenceNumber << ", Want: " << expectedSequenceNumber << std::endl;
+					uint32_t typeId = PacketDispatcher::peekId(data);
 
-					if (!receivedPackets.empty())
-					{
-						uint16_t size = 0;
+					data.readBit(readBit);
 
-						bool useBoth = dataStream.remaining();
-						BitStream* stream = useBoth ? &dataStream : &data;
-						size_t readBit = stream->readBit();
+					if (typeId != handshakeId)
+					{
+						receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
+						return;
+					}
+					else
+					{
+						expectedSequenceNumber = sequenceNumber;
+						initialized = true;
 
-						while (!size && stream->remaining() >= 16)
+						if (lastSequenceNumber != sequenceNumber)
 						{
-							stream->read(size, 16);
+							auto next = receivedPackets.upper_bound(sequenceNumber);
 
-							if (verbose)
-								std::cout << "Read size " << size << std::endl;
+							uint32_t difference = next->first - sequenceNumber;
 
-							uint16_t skipped = std::min(size, static_cast<uint16_t>(stream->remaining()));
-							stream->skip(skipped);
-							size -= skipped;
+							if (difference > 1)
+							{
+								packetsLost += difference - 1;
+								metrics.recordLost(difference - 1);
 
-							if (verbose)
-								std::cout << "Size " << size << " with " << stream->remaining() << " remaining" << std::endl;
+								missingPacketsLock.lock();
+								for (uint32_t i = sequenceNumber + 1; i < next->first; missingPackets.emplace(i++));
+								missingPacketsLock.unlock();
 
-							if (size && useBoth)
-							{
-								stream->readBit(readBit);
-								stream = &data;
-								readBit = stream->readBit();
-								stream->skip(size);
-								size -= std::min(size, static_cast<uint16_t>(stream->remaining()));
-								useBoth = false;
+								send(new PacketNACK(sequenceNumber + 1, difference - 1));
 							}
 						}
+					}
+				}
+				else
+				{
+					receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
+					lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
+					return;
+				}
+			}
 
-						if (verbose)
-							std::cout << "Final size " << size << std::endl;
-
-						if (stream->remaining())
-							stream->trim(stream->remaining());
+			if (!connecting && Util::Random::rand(0.0f, 1.0f) < packetDropChance)
+			{
+				++packetsLost;
+				metrics.recordLost(1);
+				missingPacketsLock.lock();
+				missingPackets.emplace(sequenceNumber);
+				missingPacketsLock.unlock();
+				lastSequenceNumber = std::max(lastSequenceNumber, sequenceNumber);
+				send(new PacketNACK(sequenceNumber, 1));
+				return;
+			}
 
-						stream->readBit(readBit);
+			parityDecoder.add(sequenceNumber, buffer, bytes);
 
-						// Fit packet into stored packet data, and load following packets into buffer based on the packet length, incrementing expected number
-						for (auto iter = receivedPackets.find(expectedSequenceNumber); iter != receivedPackets.end(); receivedPackets.erase(iter), iter = receivedPackets.find(++expectedSequenceNumber))
-						{
-							BitStream& packetData = iter->second;
+			missingPacketsLock.lock();
+			missingPackets.erase(sequenceNumber);
+			missingPacketsLock.unlock();
 
-							if (size == 0)
-							{
-								packetData.peek(size, 16);
-								size += 16;
-							}
+			if (expectedSequenceNumber == sequenceNumber)
+			{
+				++expectedSequenceNumber;
 
-							uint16_t len = std::min(size, static_cast<uint16_t>(packetData.remaining()));
+				if (verbose)
+					std::cout << "Expected the sequence number" << std::endl;
 
-							if (packetData.remaining() > len)
-								packetData.trim(packetData.remaining() - len);
+				//std::cout << "In: " << sequenceNumber << ", Want: " << expectedSequenceNumber << std::endl;
 
-							data << packetData;
+				if (!receivedPackets.empty())
+				{
+					uint16_t size = 0;
 
-							size -= len;
+					bool useBoth = dataStream.remaining();
+					BitStream* stream = useBoth ? &dataStream : &data;
+					size_t readBit = stream->readBit();
 
-							//std::cout << "Out (Late): " << iter->first << ", Want: " << (expectedSequenceNumber + 1) << std::endl;
-						}
-					}
-					else
+					while (!size && stream->remaining() >= 16)
 					{
-						uint16_t size = 0;
-						data.peek(size, 16);
+						stream->read(size, 16);
 
 						if (verbose)
-							std::cout << "Packet size " << size << ", trimming " << ((data.remaining() - 16) - size) << " bits" << std::endl;
+							std::cout << "Read size " << size << std::endl;
+
+						uint16_t skipped = std::min(size, static_cast<uint16_t>(stream->remaining()));
+						stream->skip(skipped);
+						size -= skipped;
 
-						if (data.remaining() - 16 > size)
-							data.trim((data.remaining() - 16) - size);
+						if (verbose)
+							std::cout << "Size " << size << " with " << stream->remaining() << " remaining" << std::endl;
+
+						if (size && useBoth)
+						{
+							stream->readBit(readBit);
+							stream = &data;
+							readBit = stream->readBit();
+							stream->skip(size);
+							size -= std::min(size, static_cast<uint16_t>(stream->remaining()));
+							useBoth = false;
+						}
 					}
-				}
-				else if (expectedSequenceNumber < sequenceNumber)
-				{
+
 					if (verbose)
-						std::cout << "Packet received early" << std::endl;
+						std::cout << "Final size " << size << std::endl;
+
+					if (stream->remaining())
+						stream->trim(stream->remaining());
+
+					stream->readBit(readBit);
 
-					if (lastSequenceNumber < sequenceNumber)
+					// Fit packet into stored packet data, and load following packets into buffer based on the packet length, incrementing expected number
+					for (auto iter = receivedPackets.find(expectedSequenceNumber); iter != receivedPackets.end(); receivedPackets.erase(iter), iter = receivedPackets.find(++expectedSequenceNumber))
 					{
-						uint32_t newPackets = sequenceNumber - lastSequenceNumber;
+						BitStream& packetData = iter->second;
 
-						if (newPackets > 1)
+						if (size == 0)
 						{
-							packetsLost += newPackets - 1;
+							packetData.peek(size, 16);
+							size += 16;
+						}
 
-							missingPacketsLock.lock();
-							for (uint32_t i = lastSequenceNumber + 1; i < sequenceNumber; missingPackets.emplace(i++));
-							missingPacketsLock.unlock();
+						uint16_t len = std::min(size, static_cast<uint16_t>(packetData.remaining()));
 
-							send(new PacketNACK(lastSequenceNumber + 1, newPackets - 1));
-						}
-					}
+						if (packetData.remaining() > len)
+							packetData.trim(packetData.remaining() - len);
 
-					//std::cerr << "In (Early): " << sequenceNumber << ", Want: " << expectedSequenceNumber << std::endl;
+						data << packetData;
 
-					// Record packet data, and delay further processing
-					receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
-					lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
-					continue;
+						size -= len;
+
+						//std::cout << "Out (Late): " << iter->first << ", Want: " << (expectedSequenceNumber + 1) << std::endl;
+					}
+
+					if (receivedPackets.empty())
+						metrics.getReassemblyDelay().record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - reassemblyStart).count());
 				}
 				else
 				{
+					uint16_t size = 0;
+					data.peek(size, 16);
+
 					if (verbose)
-						std::cout << "Packet duplicated" << std::endl;
-					
-					++packetsDuplicated;
-					//std::cerr << "In (Duplicate): " << sequenceNumber << ", Want: " << expectedSequenceNumber << std::endl;
-					continue; // Drop duplicate packet
+						std::cout << "Packet size " << size << ", trimming " << ((data.remaining() - 16) - size) << " bits" << std::endl;
+
+					if (data.remaining() - 16 > size)
+						data.trim((data.remaining() - 16) - size);
 				}
+			}
+			else if (expectedSequenceNumber < sequenceNumber)
+			{
+				if (verbose)
+					std::cout << "Packet received early" << std::endl;
 
-				lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
+				if (lastSequenceNumber < sequenceNumber)
+				{
+					uint32_t newPackets = sequenceNumber - lastSequenceNumber;
 
-				if (verbose)
-					std::cout << "Adding data to stream (" << data.remaining() << " bits)" << std::endl;
+					if (newPackets > 1)
+					{
+						packetsLost += newPackets - 1;
+						metrics.recordLost(newPackets - 1);
 
-				dataStream << data;
+						missingPacketsLock.lock();
+						for (uint32_t i = lastSequenceNumber + 1; i < sequenceNumber; missingPackets.emplace(i++));
+						missingPacketsLock.unlock();
 
-				handle:
+						send(new PacketNACK(lastSequenceNumber + 1, newPackets - 1));
+					}
+				}
 
-				if (verbose)
-					std::cout << "Stream length is now " << dataStream.remaining() << " bits" << std::endl;
+				//std::cerr << "In (Early): " << sequenceNumber << ", Want: " << expectedSequenceNumber << std::endl;
 
-				if (dataStream.remaining() >= 16)
-				{
-					uint16_t size = 0;
-					dataStream.peek(size, 16);
+				if (receivedPackets.empty())
+					reassemblyStart = std::chrono::steady_clock::now();
 
-					if (size)
-					{
-						unsigned length = dataStream.remaining() - 16 /* peeked size */;
+				// Record packet data, and delay further processing
+				receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
+				lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
+				return;
+			}
+			else
+			{
+				if (verbose)
+					std::cout << "Packet duplicated" << std::endl;
+				
+				++packetsDuplicated;
+				metrics.recordDuplicated();
+				//std::cerr << "In (Duplicate): " << sequenceNumber << ", Want: " << expectedSequenceNumber << std::endl;
+				return; // Drop duplicate packet
+			}
 
-						if (size <= length)
-						{
-							dataStream.skip(16);
+			lastSequenceNumber = std::max(sequenceNumber, lastSequenceNumber);
 
-							size_t targetReadBit = dataStream.readBit() + size;
+			if (verbose)
+				std::cout << "Adding data to stream (" << data.remaining() << " bits)" << std::endl;
 
-							uint32_t id = 0;
-							dataStream.read(id);
+			dataStream << data;
 
-							std::shared_ptr<PacketBase> packet = PacketBase::getPacket(id);
+			handle:
 
-							if (packet)
-							{
-								packet->deserialize(dataStream);
-								packet->handle(*dynamic_cast<Connection const*>(this), Direction::Clientbound);
-							}
+			if (verbose)
+				std::cout << "Stream length is now " << dataStream.remaining() << " bits" << std::endl;
+
+			if (dataStream.remaining() >= 16)
+			{
+				uint16_t size = 0;
+				dataStream.peek(size, 16);
 
-							// Discard remaining packet data, and remaining bits in last byte to prepare for next packet
-							//dataStream.skip((size - (dataStream.readBit() - readBit)) + ((Util::byteSize() - 1) - ((dataStream.readBit() - 1) % Util::byteSize())));
+				if (size)
+				{
+					unsigned length = dataStream.remaining() - 16 /* peeked size */;
 
-							if (dataStream.readBit() != targetReadBit)
-							{
-								std::cout << "Size: " << size << ", Length: " << length << ", Target: " << targetReadBit << ", Result: " << dataStream.readBit() << " on " << packet->getQualifiedName() << " with " << dataStream.remaining() << " bits remaining" << std::endl;
+					if (size <= length)
+					{
+						dataStream.skip(16);
 
-								dataStream.skip(targetReadBit - dataStream.readBit());
+						size_t targetReadBit = dataStream.readBit() + size;
 
-								__debugbreak();
-							}
-							
-							if (dataStream.remaining() == 0)
-								dataStream.clear();
+						PacketDispatcher::Lease packet = PacketDispatcher::acquire(dataStream);
 
-							goto handle;
+						if (packet)
+						{
+							packet->deserialize(dataStream);
+							metrics.recordReceived(packet->shouldRetransmit() ? Channel::Reliable : Channel::Unreliable, size / Util::byteSize());
 						}
-						else
+
+						// Discard remaining packet data, and remaining bits in last byte to prepare for next packet
+						//dataStream.skip((size - (dataStream.readBit() - readBit)) + ((Util::byteSize() - 1) - ((dataStream.readBit() - 1) % Util::byteSize())));
+
+						if (dataStream.readBit() != targetReadBit)
 						{
-							std::cout << "Size: " << size << ", Length: " << length << std::endl;
+							std::cout << "Size: " << size << ", Length: " << length << ", Target: " << targetReadBit << ", Result: " << dataStream.readBit() << " on " << packet->getQualifiedName() << " with " << dataStream.remaining() << " bits remaining" << std::endl;
+
+							dataStream.skip(targetReadBit - dataStream.readBit());
 
 							__debugbreak();
 						}
+
+						if (packet)
+							dispatch(std::move(packet));
+						
+						if (dataStream.remaining() == 0)
+							dataStream.clear();
+
+						goto handle;
 					}
 					else
 					{
-						dataStream.skip(16);
-						goto handle;
+						std::cout << "Size: " << size << ", Length: " << length << std::endl;
+
+						__debugbreak();
 					}
 				}
+				else
+				{
+					dataStream.skip(16);
+					goto handle;
+				}
 			}
 		}
 
@@ -687,6 +1067,99 @@ namespace TechDemo
 			return packetDropChance;
 		}
 
+		void InetConnection::setLinkEmulator(std::shared_ptr<LinkEmulator> const& emulator)
+		{
+			std::lock_guard lock(sendLock);
+			linkEmulator = emulator;
+		}
+
+		std::shared_ptr<LinkEmulator> InetConnection::getLinkEmulator() const
+		{
+			std::lock_guard lock(sendLock);
+			return linkEmulator;
+		}
+
+		void InetConnection::setBackend(SocketBackend backend)
+		{
+			this->backend = backend;
+		}
+
+		SocketBackend InetConnection::getBackend() const
+		{
+			return backend;
+		}
+
+		void InetConnection::setCapture(std::shared_ptr<DatagramCapture> const& capture)
+		{
+			this->capture = capture;
+		}
+
+		std::shared_ptr<DatagramCapture> InetConnection::getCapture() const
+		{
+			return capture;
+		}
+
+		StringTable& InetConnection::getSentStrings() const
+		{
+			return sentStrings;
+		}
+
+		StringTable& InetConnection::getReceivedStrings() const
+		{
+			return receivedStrings;
+		}
+
+		TypeTable& InetConnection::getSentTypes() const
+		{
+			return sentTypes;
+		}
+
+		TypeTable& InetConnection::getReceivedTypes() const
+		{
+			return receivedTypes;
+		}
+
+		void InetConnection::replay(sockaddr_storage* address, char* buffer, int bytes)
+		{
+			receive(buffer, bytes);
+		}
+
+		void InetConnection::deliver(sockaddr_storage const* address, const char* buffer, unsigned length)
+		{
+			if (!buffer || !length || length > MAX_FRAGMENT_SIZE)
+				return;
+
+			std::lock_guard lock(deliveredLock);
+			delivered.emplace_back(address ? std::string(reinterpret_cast<const char*>(address), sizeof(sockaddr_storage)) : std::string(), std::string(buffer, length));
+		}
+
+		void InetConnection::receiveDelivered()
+		{
+			std::deque<std::pair<std::string, std::string>> datagrams;
+
+			{
+				std::lock_guard lock(deliveredLock);
+
+				if (delivered.empty())
+					return;
+
+				std::swap(datagrams, delivered);
+			}
+
+			for (auto& datagram : datagrams)
+			{
+				sockaddr_storage addr = { 0 };
+				char buffer[MAX_FRAGMENT_SIZE];
+
+				if (!datagram.first.empty())
+					std::memcpy(&addr, datagram.first.data(), sizeof(sockaddr_storage));
+
+				std::memcpy(buffer, datagram.second.data(), datagram.second.size());
+
+				replay(datagram.first.empty() ? nullptr : &addr, buffer, static_cast<int>(datagram.second.size()));
+			}
+		}
+
 		std::shared_ptr<InetConnection> InetConnection::getConnection(sockaddr_storage* address)
 		{
 			if (address)
@@ -2,14 +2,34 @@
 
 #include <atomic>
 #include <bitset>
+#include <chrono>
+#include <deque>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "BitStream.h"
 #include "Connection.h"
+#include "ConnectionMetrics.h"
+#include "DatagramCapture.h"
+#include "LinkEmulator.h"
+#include "PacketHandlerPool.h"
+#include "Parity.h"
 #include "Random.h"
+#include "RegisteredIO.h"
+#include "StringTable.h"
+#include "TypeTable.h"
+
+#define DEFAULT_FRAGMENT_SIZE 1300	// Datagram size used until the path MTU has been discovered
+#define MIN_FRAGMENT_SIZE 548		// Smallest datagram every IPv4 path must carry (576 byte datagram, less the IP and UDP headers)
+#define MAX_FRAGMENT_SIZE 8000		// Largest datagram probed for, bounded by the 16 bit packet length (in bits) header
+#define CONNECTION_TICK_PERIOD 25	// Milliseconds between a connection's pings, snapshots and NACKs (40 per second)
+#define CONNECTION_STATS_PERIOD 1000	// Milliseconds between a connection's bandwidth samples
+#define HANDSHAKE_RETRY_TICKS 20	// Connection ticks before an unanswered handshake is sent again
+#define UNSEQUENCED_OFFSET 0x40000000U	// Unsequenced datagrams are numbered a quarter of the sequence space ahead of the window
 
 struct sockaddr_storage;	// Forward declaration
 
@@ -19,8 +39,11 @@ namespace TechDemo
 	{
 		class InetConnection : public Connection
 		{
+			friend class LinkEmulator;
 			friend class PacketHandshake;
+			friend class PacketMTUAck;
 			friend class PacketNACK;
+			friend class PacketSnapshot;
 			friend class ServerConnection;
 
 			public:
@@ -38,6 +61,11 @@ namespace TechDemo
 
 				virtual bool send(std::shared_ptr<PacketBase> const& packet) const;
 
+				// Sends the packet in a single datagram outside the ordered window, which is dispatched as soon as it arrives
+				// however many datagrams before it are missing. It is never resent, so the packet must tolerate loss and
+				// reordering. Packets too large for one datagram are sent in order instead.
+				bool sendUnsequenced(std::shared_ptr<PacketBase> const& packet) const;
+
 				virtual std::string const& getRemoteAddress() const;
 				
 				virtual unsigned short getPort() const;
@@ -46,12 +74,53 @@ namespace TechDemo
 
 				virtual bool isLocal() const;
 
+				unsigned short getFragmentSize() const;
+
+				ConnectionMetrics const& getMetrics() const;
+
+				// Milliseconds the server's clock is ahead of the local one, as estimated by the client
 				virtual long getTimeOffset() const;
 
 				virtual void setDropChance(float dropChance);
 
 				virtual float getDropChance() const;
 
+				void setLinkEmulator(std::shared_ptr<LinkEmulator> const& emulator);
+
+				std::shared_ptr<LinkEmulator> getLinkEmulator() const;
+
+				// Takes effect the next time the connection opens its socket.
+				void setBackend(SocketBackend backend);
+
+				SocketBackend getBackend() const;
+
+				// Sends a parity datagram after every few datagrams, so single losses are rebuilt without a retransmission
+				void setParity(bool enabled);
+
+				bool getParity() const;
+
+				// Records every datagram received to the capture, until replaced or reset
+				void setCapture(std::shared_ptr<DatagramCapture> const& capture);
+
+				std::shared_ptr<DatagramCapture> getCapture() const;
+
+				// Dictionaries of the strings sent to, and received from, the other end
+				StringTable& getSentStrings() const;
+
+				StringTable& getReceivedStrings() const;
+
+				// Dictionaries of the component types sent to, and received from, the other end
+				TypeTable& getSentTypes() const;
+
+				TypeTable& getReceivedTypes() const;
+
+				// Feeds a captured datagram through the receive path as if it had just come off the socket
+				virtual void replay(sockaddr_storage* address, char* buffer, int bytes);
+
+				// Queues a datagram delivered in-process (see LinkEmulator::attach), to be received by the receiving thread
+				// alongside those read off the socket
+				void deliver(sockaddr_storage const* address, const char* buffer, unsigned length);
+
 				static std::shared_ptr<InetConnection> getConnection(sockaddr_storage* address);
 
 				static std::pair<std::shared_ptr<InetConnection>, bool> getConnection(sockaddr_storage* address, unsigned socket);
@@ -63,8 +132,44 @@ namespace TechDemo
 
 				InetConnection(std::string const& ipAddress, unsigned short port, unsigned socket);
 
+				bool open(std::string const& ipAddress, unsigned short port);
+
+				virtual bool send(std::shared_ptr<PacketBase> const& packet, unsigned short fragmentSize) const;
 				virtual bool send(const char* data, unsigned short length) const;
+				virtual int transmit(const char* data, unsigned length) const;
+				virtual int transmit(const char* header, unsigned headerLength, const char* data, unsigned length) const;
 				virtual void connectLoop();
+				virtual void receive(char* buffer, int bytes);
+
+				// Dispatches the packet of an unsequenced datagram, read past its sequence number
+				void receiveUnsequenced(BitStream& data);
+
+				static bool isUnsequenced(uint32_t sequenceNumber, uint32_t expectedSequenceNumber);
+
+				// Queues a decoded packet for its handler, preserving the order of this connection's packets
+				void dispatch(PacketDispatcher::Lease&& packet);
+
+				// Replays the datagrams queued by deliver, on the receiving thread
+				void receiveDelivered();
+
+				void probeMTU();
+				void confirmMTU(unsigned short size);
+
+				// Largest datagram the fragmenter should send, leaving room for a parity datagram to cover it
+				unsigned short getPayloadSize() const;
+
+				// Adds a sent datagram to the current parity group, and sends the group's parity once it is complete
+				void protect(uint32_t sequenceNumber, const char* header, unsigned headerLength, const char* data = nullptr, unsigned length = 0U) const;
+
+				void adaptParity();
+
+				// Sends the handshake, remembering its datagram so it can be echoed with the server's cookie
+				void sendHandshake();
+
+				// Called every connection tick while connecting, and sends the handshake again once it has gone unanswered
+				void retryHandshake();
+
+				bool resendHandshake() const;
 
 				std::atomic_uint socket = 0;
 				std::string ipAddress;
@@ -76,13 +181,15 @@ namespace TechDemo
 				std::thread listeningThread;
 				std::atomic_long timeOffset = 0L;
 
-				long dataClock = 0;			// Clock for bandwidth and other data analysis
+				uint64_t dataClock = 0ULL;	// Timer for bandwidth and other data analysis
 				mutable std::atomic_ulong bytesSent = 0;
 				mutable std::atomic_ulong bytesRcvd = 0;
 				mutable std::atomic_ulong packetsSent = 0;
 				mutable std::atomic_ulong packetsResent = 0;
 				mutable std::atomic_ulong packetsLost = 0;
 				mutable std::atomic_ulong packetsDuplicated = 0;
+				mutable ConnectionMetrics metrics;									// Per-connection counters and latency histograms
+				std::chrono::steady_clock::time_point reassemblyStart;				// Arrival of the oldest datagram waiting on a gap
 
 				// Reliability Variables
 				mutable std::atomic_uint32_t nextSequenceNumber = Util::Random::xorshift();	// Outbound sequence number
@@ -94,8 +201,41 @@ namespace TechDemo
 				std::set<uint32_t> missingPackets;
 				std::mutex missingPacketsLock;
 				BitStream dataStream;
+				std::shared_ptr<PacketHandlerPool::Queue> handlers;	// Decoded packets waiting for a handler
+
+				// Snapshot Replication
+				unsigned long long lastSnapshot = 0ULL;		// Newest snapshot applied (only touched by handlers)
+				std::vector<bool> snapshotParts;			// Parts of the newest snapshot received so far
 
 				float packetDropChance = 0.0f;
+				std::shared_ptr<LinkEmulator> linkEmulator;
+				SocketBackend backend = SocketBackend::Select;
+				std::shared_ptr<RegisteredIO> registeredIO;	// Set while the socket is serviced by Registered I/O
+				std::shared_ptr<DatagramCapture> capture;
+				std::deque<std::pair<std::string, std::string>> delivered;	// Address (empty if none) and datagram, queued by deliver
+				std::mutex deliveredLock;
+				mutable StringTable sentStrings;
+				mutable StringTable receivedStrings;
+				mutable TypeTable sentTypes;
+				mutable TypeTable receivedTypes;
+
+				// Path MTU Discovery
+				std::atomic_ushort fragmentSize = DEFAULT_FRAGMENT_SIZE;	// Largest datagram sent by the fragmenter
+				unsigned short mtuLow = MIN_FRAGMENT_SIZE;					// Largest confirmed datagram size
+				unsigned short mtuHigh = MAX_FRAGMENT_SIZE;					// Largest datagram size not yet ruled out
+				unsigned short mtuProbe = 0;								// Size of the outstanding probe (0 if none)
+				unsigned char mtuProbeTicks = 0;
+				unsigned char mtuProbeAttempts = 0;
+				std::mutex mtuLock;
+
+				// Handshake
+				uint32_t handshakeSequenceNumber = 0;	// Datagram carrying the handshake
+				std::string handshakeCookie;			// Cookie datagram the server challenged the handshake with (guarded by the send lock)
+				unsigned char handshakeTicks = 0;
+
+				// Forward Error Correction
+				mutable ParityEncoder parityEncoder;	// Only touched while holding the send lock
+				ParityDecoder parityDecoder;			// Only touched by the receiving thread
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Clock.h"
+#include "Engine.h"
+#include "GameObject.h"
+#include "InterestManager.h"
+#include "ModelReferences.h"
+#include "PacketDestroyObject.h"
+#include "PacketSpawnBatch.h"
+#include "PacketSpawnObject.h"
+#include "PlayerConnection.h"
+
+#define SPAWN_BATCH_OVERHEAD 18	// Sequence number (4), packet length (2), packet index (2), progress (8), count (2)
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		std::unordered_map<uint64_t, std::vector<InterestManager::Entry>> InterestManager::cells;
+		std::vector<InterestManager::Entry> InterestManager::unbounded;
+		std::unordered_map<Util::UUID, glm::vec3> InterestManager::positions;
+		std::unordered_map<Connection const*, InterestManager::Observer> InterestManager::observers;
+		std::recursive_mutex InterestManager::lock;
+		long InterestManager::tickClock = 0;
+
+		void InterestManager::init()
+		{
+			if (!tickClock)
+				tickClock = Util::Clock::addClock(40, InterestManager::update, Util::Clock::getMainThreadId());
+		}
+
+		void InterestManager::shutdown()
+		{
+			Util::Clock::removeClock(tickClock);
+			tickClock = 0;
+
+			std::lock_guard guard(lock);
+			cells.clear();
+			unbounded.clear();
+			positions.clear();
+			observers.clear();
+		}
+
+		void InterestManager::setObserver(std::shared_ptr<PlayerConnection> const& conn, Util::UUID const& objectId, float radius)
+		{
+			std::lock_guard guard(lock);
+
+			Observer& observer = observers[conn.get()];
+			observer.connection = conn;
+			observer.objectId = objectId;
+			observer.radius = radius;
+		}
+
+		void InterestManager::removeObserver(std::shared_ptr<PlayerConnection> const& conn)
+		{
+			std::lock_guard guard(lock);
+			observers.erase(conn.get());
+		}
+
+		void InterestManager::markKnown(std::shared_ptr<PlayerConnection> const& conn, Util::UUID const& objectId)
+		{
+			std::lock_guard guard(lock);
+			observers[conn.get()].known.emplace(objectId);
+		}
+
+		bool InterestManager::forEachRelevant(Connection const* conn, std::function<void(Util::UUID const&, float)> const& callback)
+		{
+			std::lock_guard guard(lock);
+
+			auto iter = observers.find(conn);
+			if (iter == observers.end())
+				return false;
+
+			// Only objects the client has been sent can be updated
+			Observer const& observer = iter->second;
+			auto position = positions.find(observer.objectId);
+
+			if (position != positions.end())
+			{
+				query(position->second, observer.radius * INTEREST_HYSTERESIS, [&](Entry const& entry)
+				{
+					if (observer.known.count(entry.objectId))
+					{
+						glm::vec3 offset = entry.position - position->second;
+						float distance = std::sqrt(glm::dot(offset, offset));
+
+						for (auto const& componentId : entry.components)
+							callback(componentId, distance);
+					}
+				});
+			}
+
+			return true;
+		}
+
+		void InterestManager::update()
+		{
+			if (!Engine::server)
+				return;
+
+			std::lock_guard guard(lock);
+
+			// Keep each cell's storage from the previous tick
+			for (auto& cell : cells)
+				cell.second.clear();
+
+			unbounded.clear();
+			positions.clear();
+
+			{
+				std::recursive_mutex& mutex = Engine::getScene().getObjectsLock();
+				std::lock_guard objectsLock(mutex);
+
+				for (auto const& pair : Engine::getScene().getObjects())
+				{
+					World::Transform& transform = pair.second->getTransform();
+					glm::vec3 scale = transform.getScale();
+
+					Entry entry;
+					entry.objectId = pair.second->getUUID();
+					entry.position = transform.getPosition();
+					entry.bounded = std::max(scale.x, std::max(scale.y, scale.z)) <= INTEREST_CELL_SIZE;
+
+					for (auto const& component : pair.second->getComponents())
+						entry.components.push_back(component->getUUID());
+
+					positions[entry.objectId] = entry.position;
+
+					if (entry.bounded)
+						cells[getCell(static_cast<int>(std::floor(entry.position.x / INTEREST_CELL_SIZE)), static_cast<int>(std::floor(entry.position.z / INTEREST_CELL_SIZE)))].push_back(std::move(entry));
+					else
+						unbounded.push_back(std::move(entry));
+				}
+			}
+
+			for (auto iter = observers.begin(); iter != observers.end();)
+			{
+				std::shared_ptr<PlayerConnection> conn = iter->second.connection.lock();
+
+				if (!conn || !conn->isConnected())
+				{
+					iter = observers.erase(iter);
+					continue;
+				}
+
+				Observer& observer = iter->second;
+				auto position = positions.find(observer.objectId);
+
+				if (position == positions.end())
+				{
+					++iter;
+					continue;
+				}
+
+				// Objects enter at the radius, but only leave beyond the hysteresis band, so those on the boundary do not flicker
+				std::unordered_set<Util::UUID> relevant;
+				query(position->second, observer.radius * INTEREST_HYSTERESIS, [&](Entry const& entry)
+				{
+					glm::vec3 offset = entry.position - position->second;
+
+					if (!entry.bounded || observer.known.count(entry.objectId) || glm::dot(offset, offset) <= observer.radius * observer.radius)
+						relevant.emplace(entry.objectId);
+				});
+
+				for (auto known = observer.known.begin(); known != observer.known.end();)
+				{
+					if (!relevant.count(*known))
+					{
+						// Objects removed from the scene are destroyed by whoever removed them
+						if (positions.count(*known))
+							conn->send(new PacketDestroyObject(*known));
+
+						known = observer.known.erase(known);
+					}
+					else
+						++known;
+				}
+
+				// Objects which leave again before they were streamed are simply forgotten
+				for (auto queued = observer.queued.begin(); queued != observer.queued.end();)
+				{
+					if (!relevant.count(*queued))
+					{
+						queued = observer.queued.erase(queued);
+						--observer.total;
+					}
+					else
+						++queued;
+				}
+
+				for (auto const& objectId : relevant)
+				{
+					if (!observer.known.count(objectId) && observer.queued.emplace(objectId).second)
+						++observer.total;
+				}
+
+				stream(*conn, observer, position->second);
+
+				++iter;
+			}
+		}
+
+		void InterestManager::stream(PlayerConnection& conn, Observer& observer, glm::vec3 const& position)
+		{
+			// There is no congestion window, so the spawn window is paced like one: doubled each tick nothing needed resending,
+			// and halved when something did
+			unsigned long long resent = conn.getMetrics().getTotals().packetsResent;
+			bool congested = resent > observer.resent;
+			observer.resent = resent;
+
+			if (observer.queued.empty())
+				return;
+
+			if (observer.streamed)
+				observer.window = congested ? std::max(observer.window / 2, INTEREST_MIN_WINDOW) : std::min(observer.window * 2, INTEREST_MAX_WINDOW);
+
+			// Nearest first, so the client can start with what is around its player
+			std::vector<std::pair<float, Util::UUID>> order;
+			order.reserve(observer.queued.size());
+
+			for (auto const& objectId : observer.queued)
+			{
+				auto entry = positions.find(objectId);
+				glm::vec3 offset = entry != positions.end() ? entry->second - position : glm::vec3(0.0f);
+				order.emplace_back(glm::dot(offset, offset), objectId);
+			}
+
+			std::sort(order.begin(), order.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+			unsigned short payloadSize = conn.getPayloadSize();
+			size_t budget = (payloadSize > SPAWN_BATCH_OVERHEAD ? payloadSize - SPAWN_BATCH_OVERHEAD : 0) * Util::byteSize();
+			size_t window = static_cast<size_t>(observer.window) * Util::byteSize(), spent = 0;
+			std::shared_ptr<PacketSpawnBatch> batch;
+
+			// Held while serializing, as the History does while logging, so every record is taken from the same tick
+			std::recursive_mutex& mutex = Engine::getScene().getObjectsLock();
+			std::lock_guard objectsLock(mutex);
+
+			auto flush = [&]()
+			{
+				batch->setProgress(observer.streamed, observer.total);
+				conn.send(batch);
+				batch.reset();
+			};
+
+			for (auto const& pair : order)
+			{
+				// Checked before serializing, as a serialized spawn may have entered its model path into the string table
+				if (spent >= window)
+					break;
+
+				std::shared_ptr<World::GameObject> object = World::GameObject::getObject(pair.second);
+
+				if (!object)
+				{
+					observer.queued.erase(pair.second);
+					--observer.total;
+					continue;
+				}
+
+				BitStream record;
+
+				object->componentsLock.lock();
+				PacketSpawnObject(pair.second, World::ModelReferences::getFileName(*object), object->getModelOffset(), object->getComponents()).serialize(record, conn.getSentStrings(), conn.getSentTypes());
+				object->componentsLock.unlock();
+
+				if (batch && batch->getSize() + record.size() > budget)
+					flush();
+
+				if (!batch)
+					batch = std::make_shared<PacketSpawnBatch>();
+
+				batch->add(record);
+				spent += record.size();
+
+				observer.queued.erase(pair.second);
+				observer.known.emplace(pair.second);
+				++observer.streamed;
+			}
+
+			if (batch)
+				flush();
+		}
+
+		uint64_t InterestManager::getCell(int x, int z)
+		{
+			return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+		}
+
+		void InterestManager::query(glm::vec3 const& position, float radius, std::function<void(Entry const&)> const& callback)
+		{
+			int minX = static_cast<int>(std::floor((position.x - radius) / INTEREST_CELL_SIZE));
+			int maxX = static_cast<int>(std::floor((position.x + radius) / INTEREST_CELL_SIZE));
+			int minZ = static_cast<int>(std::floor((position.z - radius) / INTEREST_CELL_SIZE));
+			int maxZ = static_cast<int>(std::floor((position.z + radius) / INTEREST_CELL_SIZE));
+
+			for (int x = minX; x <= maxX; ++x)
+			{
+				for (int z = minZ; z <= maxZ; ++z)
+				{
+					auto cell = cells.find(getCell(x, z));
+					if (cell == cells.end())
+						continue;
+
+					for (Entry const& entry : cell->second)
+					{
+						glm::vec3 offset = entry.position - position;
+
+						if (glm::dot(offset, offset) <= radius * radius)
+							callback(entry);
+					}
+				}
+			}
+
+			for (Entry const& entry : unbounded)
+				callback(entry);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "UUID.h"
+
+#define INTEREST_CELL_SIZE 8.0f		// Width of a grid cell in world units
+#define INTEREST_RADIUS 24.0f		// Default relevancy radius around a client's player
+#define INTEREST_HYSTERESIS 1.25f	// Relevant objects are only dropped beyond this multiple of the radius
+#define INTEREST_WINDOW 4096U		// Bytes of spawns first streamed to a client per tick
+#define INTEREST_MIN_WINDOW 1024U	// Smallest the spawn window is halved to
+#define INTEREST_MAX_WINDOW 65536U	// Largest the spawn window is doubled to
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		class Connection;		//!< Forward declaration
+		class PlayerConnection;	//!< Forward declaration
+
+		// Buckets scene objects into a uniform grid over the horizontal plane once per tick, so that each client is only sent
+		// the objects (and component updates) within its relevancy radius. Connections without an observer are sent everything.
+		class InterestManager
+		{
+			public:
+				InterestManager() = delete;
+
+				static void init();
+
+				static void shutdown();
+
+				static void setObserver(std::shared_ptr<PlayerConnection> const& conn, Util::UUID const& objectId, float radius = INTEREST_RADIUS);
+
+				static void removeObserver(std::shared_ptr<PlayerConnection> const& conn);
+
+				// Records an object the client has already been sent outside of the interest manager
+				static void markKnown(std::shared_ptr<PlayerConnection> const& conn, Util::UUID const& objectId);
+
+				// Visits each component relevant to the connection, with its distance from the observer. Returns false if the
+				// connection has no observer.
+				static bool forEachRelevant(Connection const* conn, std::function<void(Util::UUID const&, float)> const& callback);
+
+				// Rebuilds the grid, and streams or destroys objects as they enter or leave each client's radius
+				static void update();
+
+			private:
+				struct Entry
+				{
+					Util::UUID objectId;
+					glm::vec3 position;
+					std::vector<Util::UUID> components;
+					bool bounded = true;
+				};
+
+				struct Observer
+				{
+					std::weak_ptr<PlayerConnection> connection;
+					Util::UUID objectId;
+					float radius = INTEREST_RADIUS;
+					std::unordered_set<Util::UUID> known;	// Objects the client has been sent
+					std::unordered_set<Util::UUID> queued;	// Relevant objects waiting to be streamed to the client
+					uint32_t streamed = 0U;					// Spawns sent
+					uint32_t total = 0U;					// Spawns queued
+					unsigned window = INTEREST_WINDOW;		// Bytes of spawns sent per tick
+					unsigned long long resent = 0ULL;		// Retransmissions when the window was last adapted
+				};
+
+				static uint64_t getCell(int x, int z);
+
+				// Sends the nearest queued objects, packed into as few datagrams as possible, up to the observer's window
+				static void stream(PlayerConnection& conn, Observer& observer, glm::vec3 const& position);
+
+				static void query(glm::vec3 const& position, float radius, std::function<void(Entry const&)> const& callback);
+
+				static std::unordered_map<uint64_t, std::vector<Entry>> cells;
+				static std::vector<Entry> unbounded;	// Objects larger than a cell, relevant to everyone
+				static std::unordered_map<Util::UUID, glm::vec3> positions;
+				static std::unordered_map<Connection const*, Observer> observers;
+				static std::recursive_mutex lock;
+				static long tickClock;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <vector>
+
+#include "Clock.h"
+#include "Component.h"
+#include "Engine.h"
+#include "History.h"
+#include "JitterBuffer.h"
+#include "PlayerConnection.h"
+#include "RTTI.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		std::map<unsigned long long, PacketSnapshot::changeType> JitterBuffer::snapshots;
+		std::unordered_map<Util::UUID, std::unordered_map<uint16_t, JitterBuffer::Variable>> JitterBuffer::played;
+		unsigned long long JitterBuffer::lastPlayed = 0ULL;
+		std::atomic_ullong JitterBuffer::delay = JITTER_MIN_DELAY;
+		std::mutex JitterBuffer::lock;
+		long JitterBuffer::tickClock = 0;
+
+		void JitterBuffer::init()
+		{
+			if (!tickClock)
+				tickClock = Util::Clock::addClock(40, JitterBuffer::update, Util::Clock::getMainThreadId());
+		}
+
+		void JitterBuffer::shutdown()
+		{
+			Util::Clock::removeClock(tickClock);
+			tickClock = 0;
+
+			std::lock_guard guard(lock);
+			snapshots.clear();
+			played.clear();
+			lastPlayed = 0ULL;
+			delay = JITTER_MIN_DELAY;
+		}
+
+		void JitterBuffer::push(unsigned long long timestamp, PacketSnapshot::changeType&& changes)
+		{
+			if (!tickClock)
+			{
+				for (auto const& component : changes)
+					World::History::applyChanges(component.first, component.second);
+
+				return;
+			}
+
+			std::lock_guard guard(lock);
+
+			// Parts arriving after their snapshot was due are applied on the next tick
+			auto& snapshot = snapshots[timestamp];
+
+			for (auto& component : changes)
+			{
+				auto& variables = snapshot[component.first];
+
+				for (auto& variable : component.second)
+					variables.insert_or_assign(variable.first, std::move(variable.second));
+			}
+		}
+
+		unsigned long long JitterBuffer::getDelay()
+		{
+			return delay;
+		}
+
+		void JitterBuffer::update()
+		{
+			adapt();
+
+			// Snapshots are stamped by the server's clock, so playback follows it rather than the local one
+			long long offset = Engine::client ? Engine::client->getTimeOffset() : 0L;
+			long long now = static_cast<long long>(Engine::getTimestamp()) + offset;
+			unsigned long long playback = now > static_cast<long long>(delay) ? static_cast<unsigned long long>(now) - delay : 0ULL;
+
+			std::map<unsigned long long, PacketSnapshot::changeType> due;
+
+			lock.lock();
+			due.insert(std::make_move_iterator(snapshots.begin()), std::make_move_iterator(snapshots.upper_bound(playback)));
+			snapshots.erase(snapshots.begin(), snapshots.upper_bound(playback));
+			bool underrun = snapshots.empty();
+			lock.unlock();
+
+			for (auto const& snapshot : due)
+				apply(snapshot.first, snapshot.second);
+
+			// A snapshot still in the buffer will be interpolated towards once it is due, so only extrapolate without one
+			if (underrun && lastPlayed && playback > lastPlayed)
+				extrapolate(playback);
+		}
+
+		void JitterBuffer::adapt()
+		{
+			std::shared_ptr<PlayerConnection> client = std::dynamic_pointer_cast<PlayerConnection>(Engine::client);
+			if (!client)
+				return;
+
+			std::vector<float> samples;
+			for (float sample : client->getRTTHistory())
+			{
+				if (sample > 0.0f)
+					samples.push_back(sample);
+			}
+
+			if (samples.empty())
+				return;
+
+			std::sort(samples.begin(), samples.end());
+
+			// Round-trip times are in nanoseconds, and half of their spread is attributed to the server to client direction
+			float median = samples[samples.size() / 2];
+			float high = samples[std::min(samples.size() - 1, static_cast<size_t>(samples.size() * JITTER_PERCENTILE))];
+			unsigned long long jitter = static_cast<unsigned long long>((high - median) / 2.0f / 1000000.0f);
+
+			unsigned long long target = std::clamp(JITTER_INTERVAL + jitter, JITTER_MIN_DELAY, JITTER_MAX_DELAY);
+			unsigned long long current = delay;
+
+			if (target > current)
+				delay = current + std::min(target - current, JITTER_SLEW);
+			else
+				delay = current - std::min(current - target, JITTER_SLEW);
+		}
+
+		void JitterBuffer::apply(unsigned long long timestamp, PacketSnapshot::changeType const& changes)
+		{
+			// Guesses past the newest value are superseded by what the server sent next, whether or not the variable changed
+			for (auto& component : played)
+			{
+				for (auto& pair : component.second)
+				{
+					if (pair.second.extrapolated)
+					{
+						World::History::removeChanges(component.first, pair.first, pair.second.latestTime, pair.second.extrapolated);
+						pair.second.extrapolated = 0ULL;
+					}
+				}
+			}
+
+			for (auto const& component : changes)
+			{
+				World::History::applyChanges(component.first, component.second);
+
+				auto& variables = played[component.first];
+
+				for (auto const& change : component.second)
+				{
+					Variable& variable = variables[change.first];
+
+					if (change.second.first > variable.latestTime)
+					{
+						variable.previousTime = variable.latestTime;
+						variable.previous = std::move(variable.latest);
+						variable.latestTime = change.second.first;
+						variable.latest = BitStream(change.second.second);
+					}
+
+					variable.snapshot = std::max(variable.snapshot, timestamp);
+				}
+			}
+
+			lastPlayed = std::max(lastPlayed, timestamp);
+		}
+
+		void JitterBuffer::extrapolate(unsigned long long timestamp)
+		{
+			for (auto iter = played.begin(); iter != played.end();)
+			{
+				std::shared_ptr<World::ComponentBase> component = World::ComponentBase::getComponent(iter->first);
+
+				if (!component)
+				{
+					iter = played.erase(iter);
+					continue;
+				}
+
+				Util::RTTI::Type const* type = Util::RTTI::getType(component->getTypeHash());
+
+				std::unordered_map<uint16_t, std::pair<unsigned long long, BitStream>> changes;
+
+				for (auto& pair : iter->second)
+				{
+					Variable& variable = pair.second;
+
+					// Variables missing from the newest snapshot have stopped changing
+					if (variable.snapshot != lastPlayed || !variable.previousTime || variable.latestTime <= variable.previousTime || variable.previous.size() != variable.latest.size())
+						continue;
+
+					unsigned long long target = std::min(timestamp, variable.latestTime + JITTER_MAX_EXTRAPOLATION);
+					if (target <= std::max(variable.latestTime, variable.extrapolated))
+						continue;
+
+					auto interpolator = type ? std::get<5>(type->getVariable(pair.first)) : nullptr;
+					if (!interpolator)
+						continue;
+
+					// Interpolating beyond the latest value continues the motion between the last two
+					float distance = static_cast<float>(target - variable.previousTime) / static_cast<float>(variable.latestTime - variable.previousTime);
+
+					BitStream value(variable.latest);
+					interpolator(variable.previous.data().data(), variable.latest.data().data(), distance, const_cast<char*>(value.data().data()));
+
+					changes.emplace(pair.first, std::make_pair(target, std::move(value)));
+					variable.extrapolated = target;
+				}
+
+				if (!changes.empty())
+					World::History::applyChanges(iter->first, changes);
+
+				++iter;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "PacketSnapshot.h"
+#include "UUID.h"
+
+#define JITTER_INTERVAL 25ULL			// Milliseconds between snapshots sent by the server (one per connection tick)
+#define JITTER_MIN_DELAY 40ULL			// Playback delay bounds in milliseconds
+#define JITTER_MAX_DELAY 500ULL
+#define JITTER_PERCENTILE 0.95f			// Round-trip time percentile the delay has to cover
+#define JITTER_SLEW 2ULL				// Milliseconds the delay may move per tick, so playback never visibly jumps
+#define JITTER_MAX_EXTRAPOLATION 100ULL	// Milliseconds motion is continued past the newest snapshot when the buffer runs dry
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Holds the snapshots received from the server and applies them at a fixed delay behind the server's clock, so that
+		// uneven arrival times do not show up as uneven motion. The delay follows the spread of recent round-trip times.
+		// When playback catches up with the newest snapshot, anything still moving is extrapolated for a short while, and the
+		// guesses are removed from the History again once the next snapshot is applied.
+		class JitterBuffer
+		{
+			public:
+				JitterBuffer() = delete;
+
+				static void init();
+
+				static void shutdown();
+
+				// Buffers (part of) a snapshot. Applies it immediately while the buffer is not running.
+				static void push(unsigned long long timestamp, PacketSnapshot::changeType&& changes);
+
+				// Milliseconds playback trails the server
+				static unsigned long long getDelay();
+
+				static void update();
+
+			private:
+				struct Variable
+				{
+					unsigned long long previousTime = 0ULL;
+					BitStream previous;
+					unsigned long long latestTime = 0ULL;
+					BitStream latest;
+					unsigned long long snapshot = 0ULL;			// Newest snapshot which changed the variable
+					unsigned long long extrapolated = 0ULL;		// Time the variable has been extrapolated to
+				};
+
+				static void adapt();
+
+				static void apply(unsigned long long timestamp, PacketSnapshot::changeType const& changes);
+
+				static void extrapolate(unsigned long long timestamp);
+
+				static std::map<unsigned long long, PacketSnapshot::changeType> snapshots;	// Received, but not yet due
+				static std::unordered_map<Util::UUID, std::unordered_map<uint16_t, Variable>> played;
+				static unsigned long long lastPlayed;	// Newest snapshot applied
+				static std::atomic_ullong delay;
+				static std::mutex lock;
+				static long tickClock;
+		};
+	}
+}
\ No newline at end of file
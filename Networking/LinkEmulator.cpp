@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "InetConnection.h"
+#include "LinkEmulator.h"
+#include "ServerConnection.h"
+
+#define PARETO_SHAPE 2.5f
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		bool LinkEmulator::Datagram::operator>(Datagram const& rhs) const
+		{
+			return due != rhs.due ? due > rhs.due : order > rhs.order;
+		}
+
+		LinkEmulator::LinkEmulator(uint64_t seed)
+		{
+			// Each direction draws from its own generator, so traffic in one direction never perturbs the other
+			links[0].random.seed(seed);
+			links[1].random.seed(seed ^ 0x9E3779B97F4A7C15ULL);
+
+			std::thread thread(&LinkEmulator::deliverLoop, this);
+			std::swap(deliveryThread, thread);
+		}
+
+		LinkEmulator::~LinkEmulator()
+		{
+			{
+				// Cleared under the lock, so the delivery thread cannot miss the notification between its check and its wait
+				std::lock_guard guard(lock);
+				running = false;
+			}
+
+			signal.notify_all();
+
+			if (deliveryThread.joinable())
+				deliveryThread.join();
+		}
+
+		void LinkEmulator::setProfile(Direction direction, Profile const& profile)
+		{
+			std::lock_guard guard(lock);
+			links[getLink(direction)].profile = profile;
+		}
+
+		LinkEmulator::Profile LinkEmulator::getProfile(Direction direction) const
+		{
+			std::lock_guard guard(lock);
+			return links[getLink(direction)].profile;
+		}
+
+		void LinkEmulator::setReceiver(Direction direction, std::function<void(const char*, unsigned, sockaddr_storage const*)> const& receiver)
+		{
+			std::lock_guard guard(lock);
+			links[getLink(direction)].receiver = receiver;
+		}
+
+		void LinkEmulator::attach(std::shared_ptr<ServerConnection> const& server, std::shared_ptr<InetConnection> const& client)
+		{
+			// Held weakly, as the connections hold the emulator
+			std::weak_ptr<ServerConnection> serverRef = server;
+			std::weak_ptr<InetConnection> clientRef = client;
+
+			setReceiver(Direction::Serverbound, [serverRef, clientRef](const char* data, unsigned length, sockaddr_storage const*)
+			{
+				std::shared_ptr<ServerConnection> server = serverRef.lock();
+				std::shared_ptr<InetConnection> client = clientRef.lock();
+
+				if (!server || !client || length > MAX_FRAGMENT_SIZE)
+					return;
+
+				sockaddr_storage addr = { 0 };
+
+				sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
+				inAddr.sin_family = AF_INET;
+				inAddr.sin_port = htons(client->getLocalPort());
+				inet_pton(AF_INET, "127.0.0.1", &inAddr.sin_addr);
+
+				// Received by the server's listening thread, which alone touches its connections' receive state
+				server->deliver(&addr, data, length);
+			});
+
+			setReceiver(Direction::Clientbound, [clientRef](const char* data, unsigned length, sockaddr_storage const*)
+			{
+				std::shared_ptr<InetConnection> client = clientRef.lock();
+
+				if (!client || length > MAX_FRAGMENT_SIZE)
+					return;
+
+				client->deliver(nullptr, data, length);
+			});
+		}
+
+		int LinkEmulator::transmit(Direction direction, unsigned socket, const char* data, unsigned length, sockaddr_storage const* address)
+		{
+			if (!data || !length)
+				return 0;
+
+			std::lock_guard guard(lock);
+
+			size_t index = getLink(direction);
+			Link& link = links[index];
+			Profile const& profile = link.profile;
+			std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+			// Gilbert-Elliott burst loss
+			link.bad = link.bad ? chance(link.random) >= profile.badToGood : chance(link.random) < profile.goodToBad;
+
+			if (chance(link.random) < (link.bad ? profile.lossBad : profile.lossGood))
+			{
+				++dropped;
+				return static_cast<int>(length);	// Lost on the wire, so the sender still sees a successful send
+			}
+
+			clock::time_point now = clock::now();
+			link.available = std::max(link.available, now);
+
+			if (profile.bandwidth)
+				link.available += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(static_cast<double>(length) / profile.bandwidth));
+
+			unsigned copies = chance(link.random) < profile.duplicateChance ? 2U : 1U;
+
+			if (copies > 1U)
+				++duplicated;
+
+			for (unsigned copy = 0U; copy < copies; ++copy)
+			{
+				float delay = sample(link);
+
+				if (chance(link.random) < profile.reorderChance)
+				{
+					delay += profile.reorderDelay;
+					++reordered;
+				}
+
+				Datagram datagram;
+				datagram.due = link.available + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float, std::milli>(delay));
+				datagram.order = nextOrder++;
+				datagram.link = index;
+				datagram.socket = socket;
+				datagram.data.assign(data, length);
+
+				if (address)
+					datagram.address.assign(reinterpret_cast<const char*>(address), sizeof(sockaddr_storage));
+
+				pending.emplace(std::move(datagram));
+			}
+
+			signal.notify_one();
+
+			return static_cast<int>(length);
+		}
+
+		unsigned long LinkEmulator::getDropped() const
+		{
+			return dropped;
+		}
+
+		unsigned long LinkEmulator::getDuplicated() const
+		{
+			return duplicated;
+		}
+
+		unsigned long LinkEmulator::getReordered() const
+		{
+			return reordered;
+		}
+
+		size_t LinkEmulator::getLink(Direction direction)
+		{
+			return direction == Direction::Serverbound ? 0U : 1U;
+		}
+
+		float LinkEmulator::sample(Link& link)
+		{
+			Profile const& profile = link.profile;
+
+			if (profile.jitter <= 0.0f)
+				return std::max(profile.latency, 0.0f);
+
+			float latency = profile.latency;
+
+			switch (profile.distribution)
+			{
+				case Distribution::Uniform:
+					latency = std::uniform_real_distribution<float>(profile.latency - profile.jitter, profile.latency + profile.jitter)(link.random);
+					break;
+
+				case Distribution::Normal:
+					latency = std::normal_distribution<float>(profile.latency, profile.jitter)(link.random);
+					break;
+
+				case Distribution::Pareto:
+				{
+					float u = std::uniform_real_distribution<float>(0.0f, 1.0f)(link.random);
+					latency = profile.latency + profile.jitter * (std::pow(1.0f - u, -1.0f / PARETO_SHAPE) - 1.0f);
+					break;
+				}
+			}
+
+			return std::max(latency, 0.0f);
+		}
+
+		void LinkEmulator::deliverLoop()
+		{
+			std::unique_lock guard(lock);
+
+			while (running)
+			{
+				if (pending.empty())
+				{
+					signal.wait(guard);
+					continue;
+				}
+
+				if (clock::now() < pending.top().due)
+				{
+					signal.wait_until(guard, pending.top().due);
+					continue;
+				}
+
+				Datagram datagram = pending.top();
+				pending.pop();
+
+				auto receiver = links[datagram.link].receiver;
+				guard.unlock();
+
+				sockaddr_storage const* address = datagram.address.empty() ? nullptr : reinterpret_cast<sockaddr_storage const*>(datagram.address.data());
+
+				if (receiver)
+					receiver(datagram.data.data(), static_cast<unsigned>(datagram.data.size()), address);
+				else if ((address ? ::sendto(datagram.socket, datagram.data.data(), static_cast<int>(datagram.data.size()), 0, reinterpret_cast<const sockaddr*>(address), sizeof(sockaddr_storage)) : ::send(datagram.socket, datagram.data.data(), static_cast<int>(datagram.data.size()), 0)) == SOCKET_ERROR)
+					std::cerr << "An error occurred while delivering an emulated packet: [" << WSAGetLastError() << "]" << std::endl;
+
+				guard.lock();
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Packet.h"
+
+struct sockaddr_storage;	// Forward declaration
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		class InetConnection;	//!< Forward declaration
+		class ServerConnection;	//!< Forward declaration
+
+		class LinkEmulator
+		{
+			public:
+				enum class Distribution
+				{
+					Uniform,	// Latency +/- jitter
+					Normal,		// Latency with a standard deviation of jitter
+					Pareto		// Latency with a heavy tail, scaled by jitter
+				};
+
+				struct Profile
+				{
+					float latency = 0.0f;							// Mean one-way latency in milliseconds
+					float jitter = 0.0f;							// Latency spread in milliseconds
+					Distribution distribution = Distribution::Normal;
+					float lossGood = 0.0f;							// Loss chance while the link is in the good state
+					float lossBad = 0.0f;							// Loss chance while the link is in the bad (burst) state
+					float goodToBad = 0.0f;							// Chance per datagram of entering the bad state
+					float badToGood = 1.0f;							// Chance per datagram of leaving the bad state
+					float reorderChance = 0.0f;						// Chance of holding a datagram back behind later ones
+					float reorderDelay = 0.0f;						// Additional delay in milliseconds for held back datagrams
+					float duplicateChance = 0.0f;
+					unsigned bandwidth = 0U;						// Bytes per second (0 for unlimited)
+				};
+
+				LinkEmulator(uint64_t seed = 0ULL);
+
+				~LinkEmulator();
+
+				void setProfile(Direction direction, Profile const& profile);
+
+				Profile getProfile(Direction direction) const;
+
+				// Delivers datagrams to the callback instead of a socket, allowing both ends to run in-process.
+				void setReceiver(Direction direction, std::function<void(const char*, unsigned, sockaddr_storage const*)> const& receiver);
+
+				// Sets the receivers of both directions to run a server and one client against each other in-process: the
+				// client's datagrams reach the server as if sent from its local port, and the server's reach the client. Both
+				// connections must also transmit through this emulator (see InetConnection::setLinkEmulator). Datagrams are
+				// handed to each connection's receiving thread rather than received on the delivery thread.
+				void attach(std::shared_ptr<ServerConnection> const& server, std::shared_ptr<InetConnection> const& client);
+
+				int transmit(Direction direction, unsigned socket, const char* data, unsigned length, sockaddr_storage const* address = nullptr);
+
+				unsigned long getDropped() const;
+
+				unsigned long getDuplicated() const;
+
+				unsigned long getReordered() const;
+
+			private:
+				using clock = std::chrono::steady_clock;
+
+				struct Datagram
+				{
+					clock::time_point due;
+					unsigned long long order = 0ULL;
+					size_t link = 0U;
+					unsigned socket = 0U;
+					std::string data;
+					std::string address;	// Raw sockaddr_storage, empty for connected sockets
+
+					bool operator>(Datagram const& rhs) const;
+				};
+
+				struct Link
+				{
+					Profile profile;
+					std::mt19937_64 random;
+					bool bad = false;
+					clock::time_point available;	// Time at which the emulated line is free to serialize the next datagram
+					std::function<void(const char*, unsigned, sockaddr_storage const*)> receiver;
+				};
+
+				static size_t getLink(Direction direction);
+
+				float sample(Link& link);
+
+				void deliverLoop();
+
+				Link links[2];
+				std::priority_queue<Datagram, std::vector<Datagram>, std::greater<Datagram>> pending;
+				unsigned long long nextOrder = 0ULL;
+				mutable std::mutex lock;
+				std::condition_variable signal;
+				std::atomic_bool running = true;
+				std::thread deliveryThread;
+
+				std::atomic_ulong dropped = 0;
+				std::atomic_ulong duplicated = 0;
+				std::atomic_ulong reordered = 0;
+		};
+	}
+}
\ No newline at end of file
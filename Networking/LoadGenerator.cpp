@@ -0,0 +1,354 @@
+#pragma comment (lib, "Ws2_32.lib")
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+
+#include "Clock.h"
+#include "Engine.h"
+#include "PlayerConnection.h"
+#include "ServerConnection.h"
+#include "SwarmClient.h"
+
+#define TICK_RATE CONNECTION_TICK_PERIOD	// Milliseconds between client ticks, matching PlayerConnection::connect
+#define POLL_TIMEOUT 5		// Milliseconds
+
+using namespace TechDemo;
+
+namespace
+{
+	struct Options
+	{
+		std::string address = "127.0.0.1";
+		unsigned short port = 27015;
+		unsigned clients = 1000;		// Final number of clients
+		unsigned step = 100;			// Clients added per step
+		unsigned interval = 10;			// Seconds per step
+		unsigned threads = 4;			// Receive threads
+		bool updates = true;			// Send a PacketUpdateComponent every tick
+		bool host = false;				// Host the server in-process (required for server-side RTT)
+		IO::SocketBackend backend = IO::SocketBackend::Select;	// Socket backend of the hosted server (select or rio)
+	};
+
+	struct Shard
+	{
+		std::mutex lock;
+		std::vector<std::shared_ptr<IO::SwarmClient>> clients;
+	};
+
+	Options parse(int argc, char** argv)
+	{
+		Options options;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg(argv[i]);
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "--address" && hasValue)
+				options.address = argv[++i];
+			else if (arg == "--port" && hasValue)
+				options.port = static_cast<unsigned short>(std::stoi(argv[++i]));
+			else if (arg == "--clients" && hasValue)
+				options.clients = std::clamp(std::stoi(argv[++i]), 1, 10000);
+			else if (arg == "--step" && hasValue)
+				options.step = std::max(std::stoi(argv[++i]), 1);
+			else if (arg == "--interval" && hasValue)
+				options.interval = std::max(std::stoi(argv[++i]), 1);
+			else if (arg == "--threads" && hasValue)
+				options.threads = std::max(std::stoi(argv[++i]), 1);
+			else if (arg == "--no-updates")
+				options.updates = false;
+			else if (arg == "--host")
+				options.host = true;
+			else if (arg == "--backend" && hasValue)
+			{
+				std::string backend(argv[++i]);
+
+				if (backend == "rio")
+					options.backend = IO::SocketBackend::RegisteredIO;
+				else if (backend == "select")
+					options.backend = IO::SocketBackend::Select;
+				else
+					std::cerr << "Ignoring unknown backend \"" << backend << "\"" << std::endl;
+			}
+			else
+				std::cerr << "Ignoring unknown argument \"" << arg << "\"" << std::endl;
+		}
+
+		return options;
+	}
+
+	// Nanosecond samples, reported in milliseconds
+	float percentile(std::vector<float>& samples, float p)
+	{
+		if (samples.empty())
+			return 0.0f;
+
+		size_t index = std::min(static_cast<size_t>(p * samples.size()), samples.size() - 1);
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+		return samples[index] / 1000000.0f;
+	}
+
+	unsigned long long getCpuTime()
+	{
+		FILETIME creation, exit, kernel, user;
+		GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+
+		return ((static_cast<unsigned long long>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) + ((static_cast<unsigned long long>(user.dwHighDateTime) << 32) | user.dwLowDateTime);	// 100 ns units
+	}
+
+	void receiveLoop(Shard& shard, std::atomic_bool const& running)
+	{
+		std::vector<WSAPOLLFD> fds;
+		std::vector<std::shared_ptr<IO::SwarmClient>> clients;
+
+		while (running)
+		{
+			shard.lock.lock();
+			if (clients.size() != shard.clients.size())
+			{
+				clients = shard.clients;
+				fds.resize(clients.size());
+
+				for (size_t i = 0; i < clients.size(); ++i)
+				{
+					fds[i].fd = clients[i]->getSocket();
+					fds[i].events = POLLRDNORM;
+				}
+			}
+			shard.lock.unlock();
+
+			if (fds.empty())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(POLL_TIMEOUT));
+				continue;
+			}
+
+			if (WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), POLL_TIMEOUT) <= 0)
+				continue;
+
+			for (size_t i = 0; i < fds.size(); ++i)
+			{
+				if (fds[i].revents & POLLRDNORM)
+					while (clients[i]->poll());
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options = parse(argc, argv);
+
+	WSAData winSockData;
+	if (int result = WSAStartup(MAKEWORD(2, 2), &winSockData))
+	{
+		std::cerr << "An error occurred while starting Windows Sockets (" << result << ")" << std::endl;
+		return -1;
+	}
+
+	// No NetworkManager listeners are registered, so joining clients never cause models or scene objects to be loaded
+	if (options.host)
+	{
+		Engine::server = std::make_shared<IO::ServerConnection>();
+		Engine::server->setBackend(options.backend);
+
+		if (!Engine::server->listen(options.port))
+			return -1;
+	}
+
+	std::atomic_bool running = true;
+	int status = 0;
+	std::vector<std::unique_ptr<Shard>> shards;
+	std::vector<std::thread> threads;
+
+	for (unsigned i = 0; i < options.threads; ++i)
+		shards.emplace_back(new Shard);
+
+	for (auto& shard : shards)
+		threads.emplace_back(receiveLoop, std::ref(*shard), std::cref(running));
+
+	std::mutex clientsLock;
+	std::vector<std::shared_ptr<IO::SwarmClient>> clients;
+	std::vector<unsigned long long> rttCounts;	// Round trips of each client already sampled (ticker only)
+	std::mutex samplesLock;
+	std::vector<float> clientRtt;
+
+	// Ticks are spread across the tick window by client index, so a step does not send every ping in the same millisecond
+	std::thread ticker([&]()
+	{
+		auto next = std::chrono::steady_clock::now();
+
+		for (unsigned slot = 0; running; slot = (slot + 1) % TICK_RATE)
+		{
+			std::this_thread::sleep_until(next += std::chrono::milliseconds(1));
+
+			unsigned long long timestamp = Engine::getTimestamp();
+			std::vector<float> samples;
+
+			clientsLock.lock();
+			rttCounts.resize(clients.size(), 0ULL);
+
+			for (size_t i = slot; i < clients.size(); i += TICK_RATE)
+			{
+				clients[i]->tick(timestamp, options.updates);
+
+				// Only a new measurement is sampled, rather than the last one again every tick
+				unsigned long long count = clients[i]->getRTTCount();
+
+				if (count != rttCounts[i])
+				{
+					rttCounts[i] = count;
+					samples.push_back(static_cast<float>(clients[i]->getRTT()));
+				}
+			}
+			clientsLock.unlock();
+
+			samplesLock.lock();
+			clientRtt.insert(clientRtt.end(), samples.begin(), samples.end());
+			samplesLock.unlock();
+		}
+	});
+
+	std::cout << std::setw(8) << "clients" << std::setw(30) << "client RTT p50/p95/p99 (ms)" << std::setw(30) << "server RTT p50/p95/p99 (ms)" << std::setw(12) << "up kB/s" << std::setw(12) << "down kB/s" << std::setw(10) << "loss %" << std::setw(10) << "CPU %" << std::endl;
+
+	while (clients.size() < options.clients)
+	{
+		size_t target = std::min<size_t>(clients.size() + options.step, options.clients);
+
+		while (clients.size() < target)
+		{
+			std::shared_ptr<IO::SwarmClient> client = std::make_shared<IO::SwarmClient>();
+
+			if (!client->connect(options.address, options.port))
+			{
+				running = false;
+				break;
+			}
+
+			Shard& shard = *shards[clients.size() % shards.size()];
+			shard.lock.lock();
+			shard.clients.push_back(client);
+			shard.lock.unlock();
+
+			std::lock_guard lock(clientsLock);
+			clients.push_back(client);
+		}
+
+		if (!running)
+			break;
+
+		unsigned long sentBefore = 0, rcvdBefore = 0, packetsBefore = 0, lostBefore = 0;
+
+		clientsLock.lock();
+		for (auto& client : clients)
+		{
+			sentBefore += client->getBytesSent();
+			rcvdBefore += client->getBytesReceived();
+			packetsBefore += client->getPacketsReceived();
+			lostBefore += client->getPacketsLost();
+		}
+		clientsLock.unlock();
+
+		samplesLock.lock();
+		clientRtt.clear();
+		samplesLock.unlock();
+
+		unsigned long long cpuBefore = getCpuTime();
+		auto start = std::chrono::steady_clock::now();
+
+		for (auto end = start + std::chrono::seconds(options.interval); std::chrono::steady_clock::now() < end;)
+		{
+			if (options.host)
+				Util::Clock::update();
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		float cpu = (getCpuTime() - cpuBefore) / (seconds * 100000.0f);	// Percent of one core
+
+		unsigned long sent = 0, rcvd = 0, packets = 0, lost = 0;
+
+		clientsLock.lock();
+		for (auto& client : clients)
+		{
+			sent += client->getBytesSent();
+			rcvd += client->getBytesReceived();
+			packets += client->getPacketsReceived();
+			lost += client->getPacketsLost();
+		}
+		clientsLock.unlock();
+
+		std::vector<float> serverRtt;
+
+		if (options.host)
+		{
+			for (auto& conn : Engine::server->getClients())
+			{
+				if (int rtt = conn->getRTT())
+					serverRtt.push_back(static_cast<float>(rtt));
+			}
+		}
+
+		samplesLock.lock();
+		std::vector<float> rtt(std::move(clientRtt));
+		clientRtt.clear();
+		samplesLock.unlock();
+
+		// The percentiles of no samples read as a perfect link, so a run without ping replies is stopped instead
+		if (rtt.empty())
+		{
+			std::cerr << "An error occurred while measuring round trips: No ping replies arrived from " << clients.size() << " clients in " << options.interval << " seconds" << std::endl;
+			status = -1;
+			break;
+		}
+
+		std::ostringstream clientColumn, serverColumn;
+		clientColumn << std::fixed << std::setprecision(2) << percentile(rtt, 0.5f) << "/" << percentile(rtt, 0.95f) << "/" << percentile(rtt, 0.99f);
+
+		if (options.host)
+			serverColumn << std::fixed << std::setprecision(2) << percentile(serverRtt, 0.5f) << "/" << percentile(serverRtt, 0.95f) << "/" << percentile(serverRtt, 0.99f);
+		else
+			serverColumn << "-";
+
+		// Packets lost by the clients, relative to the packets the server sent them (those received plus those lost)
+		unsigned long expected = (packets - packetsBefore) + (lost - lostBefore);
+		float loss = expected ? 100.0f * (lost - lostBefore) / expected : 0.0f;
+
+		std::cout << std::fixed << std::setprecision(1) << std::setw(8) << clients.size() << std::setw(30) << clientColumn.str() << std::setw(30) << serverColumn.str() << std::setw(12) << (sent - sentBefore) / (seconds * 1024.0f) << std::setw(12) << (rcvd - rcvdBefore) / (seconds * 1024.0f) << std::setw(10) << loss << std::setw(10) << cpu << std::endl;
+	}
+
+	running = false;
+	ticker.join();
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (auto& client : clients)
+		client->disconnect();
+
+	if (options.host)
+		Engine::server->disconnect();
+
+	WSACleanup();
+
+	return status;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace TechDemo
+{
+	namespace Util
+	{
+		// Bounded lock-free ring buffer for any number of producer threads and exactly one consumer thread. Each slot carries a
+		// sequence number, so producers claim slots with a single compare-and-swap and the consumer sees only finished writes.
+		template <typename T, size_t Capacity>
+		class MPSCQueue
+		{
+			static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "The capacity of a multi-producer single-consumer queue must be a power of two.");
+
+			public:
+				MPSCQueue() : slots(new Slot[Capacity])
+				{
+					for (size_t i = 0; i < Capacity; ++i)
+						slots[i].sequence.store(i, std::memory_order_relaxed);
+				}
+
+				// Any thread. Returns false if the queue is full.
+				bool push(T&& value)
+				{
+					size_t tail = this->tail.load(std::memory_order_relaxed);
+
+					for (;;)
+					{
+						Slot& slot = slots[tail & (Capacity - 1)];
+						size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+						if (sequence == tail)
+						{
+							if (this->tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+							{
+								slot.value = std::move(value);
+								slot.sequence.store(tail + 1, std::memory_order_release);
+
+								return true;
+							}
+						}
+						else if (sequence < tail)
+							return false;	// Not yet popped since the last lap
+						else
+							tail = this->tail.load(std::memory_order_relaxed);
+					}
+				}
+
+				// Consumer only. Returns false if the queue is empty, or the oldest push has not finished writing.
+				bool pop(T& value)
+				{
+					size_t head = this->head.load(std::memory_order_relaxed);
+					Slot& slot = slots[head & (Capacity - 1)];
+
+					if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+						return false;
+
+					value = std::move(slot.value);
+					slot.sequence.store(head + Capacity, std::memory_order_release);
+					this->head.store(head + 1, std::memory_order_release);
+
+					return true;
+				}
+
+				size_t size() const
+				{
+					size_t head = this->head.load(std::memory_order_acquire);
+					return tail.load(std::memory_order_acquire) - head;
+				}
+
+				bool empty() const
+				{
+					return size() == 0;
+				}
+
+			private:
+				struct Slot
+				{
+					std::atomic_size_t sequence = 0U;	// Lap the slot may next be pushed (equal to its position) or popped (one past)
+					T value;
+				};
+
+				std::unique_ptr<Slot[]> slots;
+				alignas(64) std::atomic_size_t head = 0U;	// Next slot to pop
+				alignas(64) std::atomic_size_t tail = 0U;	// Next slot to claim
+		};
+	}
+}
\ No newline at end of file
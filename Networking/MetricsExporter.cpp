@@ -0,0 +1,229 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "Engine.h"
+#include "MetricsExporter.h"
+#include "PlayerConnection.h"
+#include "ServerConnection.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		std::mutex MetricsExporter::lock;
+		std::string MetricsExporter::filePath;
+		MetricsExporter::Format MetricsExporter::fileFormat = MetricsExporter::Format::JSON;
+		std::string MetricsExporter::socketAddress;
+		unsigned short MetricsExporter::socketPort = 0;
+		MetricsExporter::Format MetricsExporter::socketFormat = MetricsExporter::Format::Prometheus;
+		MetricsExporter::Report MetricsExporter::pending;
+		bool MetricsExporter::hasPending = false;
+		bool MetricsExporter::running = false;
+		std::condition_variable MetricsExporter::wake;
+		std::thread MetricsExporter::thread;
+
+		void MetricsExporter::setFile(std::string const& path, Format format)
+		{
+			std::lock_guard guard(lock);
+			filePath = path;
+			fileFormat = format;
+		}
+
+		void MetricsExporter::setSocket(std::string const& address, unsigned short port, Format format)
+		{
+			std::lock_guard guard(lock);
+			socketAddress = address;
+			socketPort = port;
+			socketFormat = format;
+		}
+
+		void MetricsExporter::clear()
+		{
+			std::lock_guard guard(lock);
+			filePath.clear();
+			socketAddress.clear();
+			socketPort = 0;
+		}
+
+		void MetricsExporter::publish()
+		{
+			std::unique_lock guard(lock);
+
+			if (filePath.empty() && (socketAddress.empty() || !socketPort))
+				return;
+
+			Report report;
+			report.filePath = filePath;
+			report.socketAddress = socketAddress;
+			report.socketPort = socketPort;
+
+			Format file = fileFormat, socket = socketFormat;
+			guard.unlock();
+
+			// Collected here, as the connections are only safe to walk from the thread driving them
+			if (!report.filePath.empty())
+				report.file = collect(file);
+
+			if (!report.socketAddress.empty() && report.socketPort)
+				report.socket = collect(socket);
+
+			guard.lock();
+
+			pending = std::move(report);
+			hasPending = true;
+
+			if (!running)
+			{
+				if (thread.joinable())
+					thread.join();
+
+				running = true;
+				std::thread exportThread(&MetricsExporter::run);
+				std::swap(thread, exportThread);
+			}
+
+			wake.notify_one();
+		}
+
+		void MetricsExporter::shutdown()
+		{
+			{
+				std::lock_guard guard(lock);
+				running = false;
+			}
+
+			wake.notify_one();
+
+			if (thread.joinable())
+				thread.join();
+		}
+
+		void MetricsExporter::run()
+		{
+			std::unique_lock guard(lock);
+
+			while (true)
+			{
+				wake.wait(guard, []() { return hasPending || !running; });
+
+				if (!hasPending)
+					break;
+
+				Report report = std::move(pending);
+				hasPending = false;
+
+				guard.unlock();
+				write(report);
+				guard.lock();
+			}
+		}
+
+		void MetricsExporter::write(Report const& report)
+		{
+			if (!report.filePath.empty())
+			{
+				// Written aside and swapped in, so readers never observe a partial file
+				std::string temporary = report.filePath + ".tmp";
+
+				{
+					std::ofstream file(temporary, std::ios::trunc);
+					file << report.file;
+				}
+
+				if (!MoveFileExA(temporary.c_str(), report.filePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+					std::cerr << "An error occurred while writing metrics to \"" << report.filePath << "\" (" << GetLastError() << ")" << std::endl;
+			}
+
+			if (!report.socketAddress.empty() && report.socketPort)
+			{
+				sockaddr_in addr = { 0 };
+				addr.sin_family = AF_INET;
+				addr.sin_port = htons(report.socketPort);
+
+				SOCKET sock = INVALID_SOCKET;
+
+				if (inet_pton(AF_INET, report.socketAddress.c_str(), &addr.sin_addr) == 1 && (sock = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) != INVALID_SOCKET)
+				{
+					// Connected without blocking, so an unreachable endpoint only holds this thread up for the timeout
+					u_long nonBlocking = 1;
+					ioctlsocket(sock, FIONBIO, &nonBlocking);
+
+					bool connected = ::connect(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != SOCKET_ERROR;
+
+					if (!connected && WSAGetLastError() == WSAEWOULDBLOCK)
+					{
+						fd_set writes, errors;
+						FD_ZERO(&writes);
+						FD_SET(sock, &writes);
+						FD_ZERO(&errors);
+						FD_SET(sock, &errors);
+
+						timeval timeout;
+						timeout.tv_sec = 0;
+						timeout.tv_usec = METRICS_CONNECT_TIMEOUT * 1000;
+
+						connected = ::select(0, nullptr, &writes, &errors, &timeout) > 0 && FD_ISSET(sock, &writes);
+					}
+
+					if (connected)
+					{
+						u_long blocking = 0;
+						ioctlsocket(sock, FIONBIO, &blocking);
+
+						DWORD sendTimeout = METRICS_CONNECT_TIMEOUT;
+						setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&sendTimeout), sizeof(sendTimeout));
+
+						::send(sock, report.socket.data(), static_cast<int>(report.socket.size()), 0);
+						::shutdown(sock, SD_SEND);
+					}
+
+					closesocket(sock);
+				}
+			}
+		}
+
+		std::string MetricsExporter::collect(Format format)
+		{
+			std::ostringstream stream;
+			bool first = true;
+
+			auto write = [&](InetConnection const& conn, std::string const& name)
+			{
+				if (format == Format::JSON)
+				{
+					stream << (first ? "" : ",");
+					conn.getMetrics().writeJSON(stream, name);
+				}
+				else conn.getMetrics().writePrometheus(stream, name);
+
+				first = false;
+			};
+
+			if (format == Format::JSON)
+				stream << "{\"connections\":[";
+
+			if (Engine::client)
+				write(*Engine::client, "client");
+
+			if (Engine::server)
+			{
+				for (auto const& client : Engine::server->getClients())
+					write(*client, client->getRemoteAddress() + ":" + std::to_string(client->getPort()));
+			}
+
+			if (format == Format::JSON)
+				stream << "]}";
+
+			return stream.str();
+		}
+	}
+}
\ No newline at end of file
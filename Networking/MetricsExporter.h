@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define METRICS_CONNECT_TIMEOUT 500	// Milliseconds the exporting thread waits on the metrics endpoint
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		class MetricsExporter
+		{
+			public:
+				enum class Format
+				{
+					JSON,
+					Prometheus
+				};
+
+				MetricsExporter() = delete;
+
+				static void setFile(std::string const& path, Format format);
+
+				static void setSocket(std::string const& address, unsigned short port, Format format);
+
+				static void clear();
+
+				// Collects the metrics of every live connection, and hands them to the exporting thread to write to the
+				// configured targets. Never blocks on the file or socket; a report not yet written is replaced by the newer one.
+				static void publish();
+
+				// Stops the exporting thread, once it has written any report still waiting
+				static void shutdown();
+
+				static std::string collect(Format format);
+
+			private:
+				struct Report
+				{
+					std::string filePath;
+					std::string file;
+					std::string socketAddress;
+					unsigned short socketPort = 0;
+					std::string socket;
+				};
+
+				static void run();
+
+				static void write(Report const& report);
+
+				static std::mutex lock;
+				static std::string filePath;
+				static Format fileFormat;
+				static std::string socketAddress;
+				static unsigned short socketPort;
+				static Format socketFormat;
+				static Report pending;
+				static bool hasPending;
+				static bool running;
+				static std::condition_variable wake;
+				static std::thread thread;
+		};
+	}
+}
\ No newline at end of file
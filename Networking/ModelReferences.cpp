@@ -0,0 +1,57 @@
+#include "GameObject.h"
+#include "ModelReferences.h"
+
+#ifndef HEADLESS
+#include "Model.h"
+#endif
+
+namespace TechDemo
+{
+	namespace World
+	{
+#ifdef HEADLESS
+		std::unordered_map<Util::UUID, std::string> ModelReferences::fileNames;
+		std::mutex ModelReferences::lock;
+
+		void ModelReferences::assign(GameObject& object, std::string const& fileName)
+		{
+			std::lock_guard guard(lock);
+
+			if (fileName.empty())
+				fileNames.erase(object.getUUID());
+			else
+				fileNames[object.getUUID()] = fileName;
+		}
+
+		std::string ModelReferences::getFileName(GameObject& object)
+		{
+			std::lock_guard guard(lock);
+
+			auto iter = fileNames.find(object.getUUID());
+			return iter != fileNames.end() ? iter->second : std::string();
+		}
+
+		void ModelReferences::remove(Util::UUID const& objectId)
+		{
+			std::lock_guard guard(lock);
+			fileNames.erase(objectId);
+		}
+#else
+		void ModelReferences::assign(GameObject& object, std::string const& fileName)
+		{
+			if (!fileName.empty())
+				object.setModel(Graphics::Model::getModel(fileName));
+		}
+
+		std::string ModelReferences::getFileName(GameObject& object)
+		{
+			auto model = object.getModel();
+			return model ? model->getFileName() : std::string();
+		}
+
+		void ModelReferences::remove(Util::UUID const& objectId)
+		{
+		}
+#endif
+	}
+}
\ No newline at end of file
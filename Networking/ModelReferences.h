@@ -0,0 +1,36 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "UUID.h"
+
+namespace TechDemo
+{
+	namespace World
+	{
+		class GameObject;	//!< Forward declaration
+
+		// Resolves the models of replicated objects by file name. A regular build loads the model, while a HEADLESS build
+		// (see DedicatedServer.cpp) only records the file name as the model's ID, so it can still be sent to clients.
+		class ModelReferences
+		{
+			public:
+				ModelReferences() = delete;
+
+				static void assign(GameObject& object, std::string const& fileName);
+
+				// Empty for objects without a model
+				static std::string getFileName(GameObject& object);
+
+				static void remove(Util::UUID const& objectId);
+
+#ifdef HEADLESS
+			private:
+				static std::unordered_map<Util::UUID, std::string> fileNames;
+				static std::mutex lock;
+#endif
+		};
+	}
+}
\ No newline at end of file
@@ -2,19 +2,29 @@
 
 #include <WinSock2.h>
 
-#include "Animator.h"
 #include "CircularPath.h"
+#include "ComponentPool.h"
 #include "Connection.h"
 #include "Engine.h"
 #include "GameObject.h"
+#include "InterestManager.h"
+#include "JitterBuffer.h"
 #include "Messenger.h"
-#include "Model.h"
+#include "MetricsExporter.h"
+#include "ModelReferences.h"
 #include "NetworkManager.h"
 #include "PacketDestroyObject.h"
 #include "PacketSpawnObject.h"
 #include "PlayerConnection.h"
-#include "PlayerController.h"
 #include "ServerConnection.h"
+#include "Simulation.h"
+
+#ifndef HEADLESS
+#include "Animator.h"
+#include "PlayerController.h"
+#endif
+
+#define PREWARM_RIGID_BODIES 128	// Rigid bodies pooled up front, enough for the demo scene's stack of cubes
 
 namespace TechDemo
 {
@@ -35,12 +45,22 @@ namespace TechDemo
 			Util::Messenger::addListener(NetworkManager::serverStop);
 			Util::Messenger::addListener(NetworkManager::serverNewClient);
 			Util::Messenger::addListener(NetworkManager::serverClientDisconnect);
+
+			JitterBuffer::init();
+			World::Simulation::init();
+
+			// Joining a server spawns the whole stack in a burst
+			World::ComponentPool::prewarm<Physics::RigidBody>(PREWARM_RIGID_BODIES);
 		}
 
 		void NetworkManager::shutdown()
 		{
 			while (Connection::hasConnections());
 
+			World::Simulation::shutdown();
+			JitterBuffer::shutdown();
+			MetricsExporter::shutdown();
+
 			if (int result = WSACleanup())
 			{
 				std::cerr << "An error occurred while shutting down Windows Sockets (" << result << ")" << std::endl;
@@ -54,8 +74,10 @@ namespace TechDemo
 
 		void NetworkManager::serverStart(const ServerStartListening*)
 		{
+			InterestManager::init();
+
 			World::GameObject* object = new World::GameObject({ 0.0f, -1.0f, 0.0f }, { 30.0f, 0.5f, 30.0f });
-			object->setModel(Graphics::Model::getModel("./models/cube2.obj"));
+			World::ModelReferences::assign(*object, "./models/cube2.obj");
 			object->addComponent<Physics::RigidBody>(object->getTransform());
 			Engine::getScene().addObject(object);
 
@@ -66,7 +88,7 @@ namespace TechDemo
 					for (int z = -2; z <= 2; ++z)
 					{
 						World::GameObject* object = new World::GameObject({ x + y * 0.85f, y, z + y * 0.85f }, 0.5f);
-						object->setModel(Graphics::Model::getModel("./models/cube2.obj"));
+						World::ModelReferences::assign(*object, "./models/cube2.obj");
 						object->addComponent<Physics::RigidBody>(object->getTransform());
 						Engine::getScene().addObject(object);
 					}
@@ -74,24 +96,31 @@ namespace TechDemo
 			}
 
 			World::GameObject* movingObject = new World::GameObject({-6, -0.5f, -6}, 0.005f);
-			movingObject->setModel(Graphics::Model::getModel("./models/ybot.fbx"));
+			World::ModelReferences::assign(*movingObject, "./models/ybot.fbx");
 			//movingObject->addComponent<Physics::RigidBody>(movingObject->getTransform());
 			//movingObject->addComponent<World::CircularPath>(glm::vec3(-4, 1, -4));
-			movingObject->addComponent<World::Animator>();
+#ifndef HEADLESS
+			movingObject->addComponent<World::Animator>();	// Poses the model's skeleton, which a headless server does not load
+#endif
 			Engine::getScene().addObject(movingObject);
 
+#ifndef HEADLESS
+			// A dedicated server has no player of its own
 			World::GameObject* player = new World::GameObject({ -3, 3, 0 }, 0.005f);
 			player->addComponent<Graphics::Camera>();
 			player->addComponent<IO::PlayerController>();
-			player->setModel(Graphics::Model::getModel("./models/ybot.fbx"));
+			World::ModelReferences::assign(*player, "./models/ybot.fbx");
 			player->getModelOffset().addRotation(glm::radians(180.0f), glm::vec3(0, 1, 0));
 			player->getModelOffset().setPosition({ 0, -0.7f, 0 });
 			player->setVisible(false);
 			Engine::getScene().addObject(player);
+#endif
 		}
 
 		void NetworkManager::serverStop(const ServerStop*)
 		{
+			InterestManager::shutdown();
+
 			std::recursive_mutex& mutex = Connection::getConnectionsLock();
 			std::lock_guard lock(mutex);
 			for (auto& pair : Connection::getConnections())
@@ -110,34 +139,25 @@ namespace TechDemo
 				if (!Engine::client || msg->connection->getPort() != Engine::client->getLocalPort())
 				{
 					World::GameObject* player = new World::GameObject({ -3, 3, 0 }, 0.005f);
-					player->addComponent<Graphics::Camera>()->setSynchronized(true);
-					player->addComponent<IO::PlayerController>();
+#ifndef HEADLESS
+					player->addComponent<IO::PlayerController>();	// A headless server leaves it to the client (see PacketSpawnObject::spawn)
+#endif
 					player->getModelOffset().addRotation(glm::radians(180.0f), glm::vec3(0, 1, 0));
 					player->getModelOffset().setPosition({ 0, -0.7f, 0 });
 					Engine::getScene().addObject(player);
 
-					std::recursive_mutex& mutex = Engine::getScene().getObjectsLock();
-					std::lock_guard lock(mutex);
+					// The client's own player is sent as its observer (gaining a camera), and everything else as it comes within range
+					msg->connection->send(new PacketSpawnObject(player->getUUID(), "", player->getModelOffset(), player->getComponents(), true));
 
-					for (auto const& pair : Engine::getScene().getObjects())
-					{
-						auto model = pair.second->getModel();
-						msg->connection->send(new PacketSpawnObject(pair.second->getUUID(), model ? model->getFileName() : "", pair.second->getModelOffset(), pair.second->getComponents()));
-					}
+					World::ModelReferences::assign(*player, "./models/ybot.fbx");
 
-					player->removeComponent<Graphics::Camera>();
-					player->setModel(Graphics::Model::getModel("./models/ybot.fbx"));
-
-					for (auto const& conn : Engine::server->getClients())
-					{
-						if (conn && conn->getPort() != msg->connection->getPort() && (!Engine::client || conn->getPort() != Engine::client->getLocalPort()))
-						{
-							auto model = player->getModel();
-							msg->connection->send(new PacketSpawnObject(player->getUUID(), model ? model->getFileName() : "", player->getModelOffset(), player->getComponents()));
-						}
-					}
+					InterestManager::setObserver(msg->connection, player->getUUID());
+					InterestManager::markKnown(msg->connection, player->getUUID());
 
 					players.emplace(msg->connection, player->getUUID());
+
+					// Spawns carry the full state, so snapshots only need what changed after joining
+					msg->connection->ackedSnapshot = Engine::getTimestamp();
 				}
 
 				msg->connection->lastUpdate = Engine::getTimestamp();
@@ -146,6 +166,8 @@ namespace TechDemo
 
 		void NetworkManager::serverClientDisconnect(const ServerClientDisconnect* msg)
 		{
+			InterestManager::removeObserver(msg->connection);
+
 			auto iter = players.find(msg->connection);
 
 			if (iter != players.end())
@@ -157,6 +179,8 @@ namespace TechDemo
 					object->remove();
 				}
 
+				World::ModelReferences::remove(iter->second);
+
 				players.erase(iter);
 			}
 		}
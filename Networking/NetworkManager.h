@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 
 #include "UUID.h"
@@ -31,6 +32,13 @@ namespace TechDemo
 			PlayerConnection const* connection = nullptr;
 		};
 
+		// Sent on the client as the server streams the objects around its player
+		struct ClientJoinProgress
+		{
+			uint32_t streamed = 0U;	// Spawns received so far
+			uint32_t total = 0U;	// Spawns queued by the server so far
+		};
+
 		class NetworkManager
 		{
 			public:
@@ -0,0 +1,198 @@
+#include <algorithm>
+
+#include "PacketDestroyObject.h"
+#include "PacketDispatcher.h"
+#include "PacketHandshake.h"
+#include "PacketInput.h"
+#include "PacketMTUAck.h"
+#include "PacketMTUProbe.h"
+#include "PacketNACK.h"
+#include "PacketPing.h"
+#include "PacketSnapshot.h"
+#include "PacketSnapshotAck.h"
+#include "PacketSpawnBatch.h"
+#include "PacketSpawnObject.h"
+#include "PacketUpdateBatch.h"
+#include "PacketUpdateComponent.h"
+#include "PacketUpdateComponents.h"
+#include "PacketUpdateRigidBody.h"
+#include "PacketUpdateTransform.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketDispatcher::Lease::Lease(Lease&& other) : packet(other.packet), index(other.index), unpooled(std::move(other.unpooled))
+		{
+			other.packet = nullptr;
+		}
+
+		PacketDispatcher::Lease::~Lease()
+		{
+			release();
+		}
+
+		PacketDispatcher::Lease& PacketDispatcher::Lease::operator=(Lease&& other)
+		{
+			if (this != &other)
+			{
+				release();
+
+				packet = other.packet;
+				index = other.index;
+				unpooled = std::move(other.unpooled);
+				other.packet = nullptr;
+			}
+
+			return *this;
+		}
+
+		PacketBase* PacketDispatcher::Lease::operator->() const
+		{
+			return packet;
+		}
+
+		PacketBase& PacketDispatcher::Lease::operator*() const
+		{
+			return *packet;
+		}
+
+		PacketDispatcher::Lease::operator bool() const
+		{
+			return packet != nullptr;
+		}
+
+		void PacketDispatcher::Lease::release()
+		{
+			if (packet && !unpooled)
+			{
+				Entry& entry = *getTable().entries[index];
+
+				// Reset on return, so that anything the packet referenced is released as soon as it has been handled
+				entry.reset(packet);
+
+				std::lock_guard guard(entry.lock);
+				entry.free.push_back(packet);
+			}
+
+			packet = nullptr;
+			unpooled.reset();
+		}
+
+		void PacketDispatcher::writeId(BitStream& stream, uint32_t id)
+		{
+			Table& table = getTable();
+			auto iter = table.indices.find(id);
+
+			if (iter != table.indices.end())
+			{
+				stream.write(iter->second);
+			}
+			else
+			{
+				stream.write(static_cast<uint16_t>(UNINDEXED_PACKET));
+				stream.write(id);
+			}
+		}
+
+		uint32_t PacketDispatcher::peekId(BitStream& stream)
+		{
+			Table& table = getTable();
+			size_t readBit = stream.readBit();
+			uint32_t id = 0;
+
+			if (stream.remaining() >= 16)
+			{
+				uint16_t index = UNINDEXED_PACKET;
+				stream.read(index);
+
+				if (index == UNINDEXED_PACKET)
+				{
+					if (stream.remaining() >= 32)
+						stream.read(id);
+				}
+				else if (index < table.entries.size())
+					id = table.entries[index]->id;
+			}
+
+			stream.readBit(readBit);
+
+			return id;
+		}
+
+		PacketDispatcher::Lease PacketDispatcher::acquire(BitStream& stream)
+		{
+			Table& table = getTable();
+			Lease lease;
+
+			stream.read(lease.index);
+
+			if (lease.index == UNINDEXED_PACKET)
+			{
+				uint32_t id = 0;
+				stream.read(id);
+
+				lease.unpooled = PacketBase::getPacket(id);
+				lease.packet = lease.unpooled.get();
+			}
+			else if (lease.index < table.entries.size())
+			{
+				Entry& entry = *table.entries[lease.index];
+
+				std::lock_guard guard(entry.lock);
+				if (entry.free.empty())
+				{
+					lease.packet = entry.create();
+				}
+				else
+				{
+					lease.packet = entry.free.back();
+					entry.free.pop_back();
+				}
+			}
+
+			return lease;
+		}
+
+		PacketDispatcher::Table::Table()
+		{
+			add<PacketDestroyObject>();
+			add<PacketHandshake>();
+			add<PacketInput>();
+			add<PacketMTUAck>();
+			add<PacketMTUProbe>();
+			add<PacketNACK>();
+			add<PacketPing>();
+			add<PacketSnapshot>();
+			add<PacketSnapshotAck>();
+			add<PacketSpawnBatch>();
+			add<PacketSpawnObject>();
+			add<PacketUpdateBatch>();
+			add<PacketUpdateComponent>();
+			add<PacketUpdateComponents>();
+			add<PacketUpdateRigidBody>();
+			add<PacketUpdateTransform>();
+
+			// Registration order may differ between builds, but id order may not
+			std::sort(entries.begin(), entries.end(), [](std::unique_ptr<Entry> const& lhs, std::unique_ptr<Entry> const& rhs) { return lhs->id < rhs->id; });
+
+			for (size_t i = 0; i < entries.size(); ++i)
+				indices.emplace(entries[i]->id, static_cast<uint16_t>(i));
+		}
+
+		PacketDispatcher::Table::~Table()
+		{
+			for (auto& entry : entries)
+			{
+				for (PacketBase* packet : entry->free)
+					delete packet;
+			}
+		}
+
+		PacketDispatcher::Table& PacketDispatcher::getTable()
+		{
+			static Table table;
+			return table;
+		}
+	}
+}
\ No newline at end of file
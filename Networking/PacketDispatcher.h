@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "BitStream.h"
+#include "Packet.h"
+
+#define UNINDEXED_PACKET 0xFFFF	// Dense id followed by the full CRC32 id, for packet types missing from the dispatch table
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Maps packet ids to dense 16 bit indices (assigned in CRC32 order, so both ends agree), and recycles received
+		// packets through a per-type pool so that steady-state dispatch performs no heap allocation.
+		class PacketDispatcher
+		{
+			public:
+				class Lease
+				{
+					friend class PacketDispatcher;
+
+					public:
+						Lease() = default;
+
+						Lease(Lease&& other);
+
+						Lease(Lease const&) = delete;
+
+						~Lease();
+
+						Lease& operator=(Lease&& other);
+
+						Lease& operator=(Lease const&) = delete;
+
+						PacketBase* operator->() const;
+
+						PacketBase& operator*() const;
+
+						explicit operator bool() const;
+
+					private:
+						void release();
+
+						PacketBase* packet = nullptr;
+						uint16_t index = UNINDEXED_PACKET;
+						std::shared_ptr<PacketBase> unpooled;	// Packet types missing from the table fall back to PacketBase::getPacket
+				};
+
+				static void writeId(BitStream& stream, uint32_t id);
+
+				// Returns the full id of the packet whose id is next in the stream (or 0 if it is truncated or unknown),
+				// without moving the read position
+				static uint32_t peekId(BitStream& stream);
+
+				// Reads an id written by writeId, and leases a reset packet of that type from its pool.
+				static Lease acquire(BitStream& stream);
+
+			private:
+				struct Entry
+				{
+					uint32_t id = 0;
+					PacketBase* (*create)() = nullptr;
+					void (*reset)(PacketBase*) = nullptr;
+					std::vector<PacketBase*> free;
+					std::mutex lock;
+				};
+
+				struct Table
+				{
+					Table();
+
+					~Table();
+
+					template <typename T>
+					void add();
+
+					std::vector<std::unique_ptr<Entry>> entries;	// Sorted by id
+					std::unordered_map<uint32_t, uint16_t> indices;	// Id -> dense index
+				};
+
+				template <typename T, typename = void>
+				struct HasReset : std::false_type {};
+
+				template <typename T>
+				struct HasReset<T, std::void_t<decltype(std::declval<T&>().reset())>> : std::true_type {};
+
+				static Table& getTable();
+		};
+
+		template <typename T>
+		void PacketDispatcher::Table::add()
+		{
+			std::unique_ptr<Entry> entry(new Entry);
+			entry->create = []() -> PacketBase* { return new T(); };
+			entry->reset = [](PacketBase* packet)
+			{
+				// Types which own containers implement reset() to clear them without releasing their storage
+				if constexpr (HasReset<T>::value)
+					static_cast<T*>(packet)->reset();
+				else
+					*static_cast<T*>(packet) = T();
+			};
+
+			PacketBase* packet = entry->create();
+			entry->id = packet->getId();
+			entry->free.push_back(packet);
+
+			entries.emplace_back(std::move(entry));
+		}
+	}
+}
\ No newline at end of file
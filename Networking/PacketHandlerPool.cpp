@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <chrono>
+
+#include "Clock.h"
+#include "PacketHandlerPool.h"
+
+namespace
+{
+	thread_local TechDemo::IO::PacketHandlerPool::Queue const* handling = nullptr;	// Queue whose handler is executing on this thread
+}
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketHandlerPool::Queue::Queue(Connection const& conn, Direction direction, ConnectionMetrics& metrics) : conn(conn), direction(direction), metrics(metrics)
+		{
+		}
+
+		void PacketHandlerPool::Queue::push(PacketDispatcher::Lease&& packet)
+		{
+			// Wait for the handlers to catch up rather than reorder or drop packets
+			while (!packets.push(std::move(packet)))
+			{
+				if (closed)
+					return;
+
+				std::this_thread::yield();
+			}
+
+			metrics.recordHandlerQueueDepth(packets.size());
+
+			if (!scheduled.exchange(true))
+				schedule(shared_from_this());
+		}
+
+		void PacketHandlerPool::Queue::close()
+		{
+			closed = true;
+
+			// A handler may close its own connection
+			if (handling != this)
+			{
+				while (running)
+					std::this_thread::yield();
+			}
+		}
+
+		bool PacketHandlerPool::Queue::drain(size_t budget)
+		{
+			Queue const* previous = handling;
+			handling = this;
+
+			PacketDispatcher::Lease packet;
+			for (size_t handled = 0; handled < budget && packets.pop(packet); ++handled)
+			{
+				running = true;
+
+				// Once closed the connection (and its metrics) may no longer exist
+				if (closed)
+				{
+					running = false;
+					break;
+				}
+
+				packet->handle(conn, direction);
+				packet = PacketDispatcher::Lease();
+
+				metrics.recordHandlerQueueDepth(packets.size());
+
+				running = false;
+			}
+
+			handling = previous;
+
+			return !closed && !packets.empty();
+		}
+
+		void PacketHandlerPool::setWorkers(unsigned count)
+		{
+			State& state = getState();
+
+			stop(state);
+			start(state, count);
+		}
+
+		unsigned PacketHandlerPool::getWorkers()
+		{
+			return static_cast<unsigned>(getState().workers.size());
+		}
+
+		void PacketHandlerPool::drain()
+		{
+			State& state = getState();
+			std::deque<std::shared_ptr<Queue>> queues;
+
+			state.tick.lock.lock();
+			std::swap(queues, state.tick.queues);
+			state.tick.lock.unlock();
+
+			for (auto const& queue : queues)
+				run(queue, HANDLER_QUEUE_SIZE);
+		}
+
+		PacketHandlerPool::State::State()
+		{
+			start(*this, std::max(1U, std::thread::hardware_concurrency() / 2));
+		}
+
+		PacketHandlerPool::State::~State()
+		{
+			stop(*this);
+		}
+
+		void PacketHandlerPool::schedule(std::shared_ptr<Queue> const& queue)
+		{
+			State& state = getState();
+			Worker& worker = state.workers.empty() ? state.tick : *state.workers[state.next++ % state.workers.size()];
+
+			worker.lock.lock();
+			worker.queues.push_back(queue);
+			worker.lock.unlock();
+
+			state.signal.notify_one();
+		}
+
+		void PacketHandlerPool::run(std::shared_ptr<Queue> const& queue, size_t budget)
+		{
+			bool remaining = queue->drain(budget);
+			queue->scheduled = false;
+
+			// A packet pushed before the flag was cleared did not schedule the queue itself
+			if ((remaining || (!queue->closed && !queue->packets.empty())) && !queue->scheduled.exchange(true))
+				schedule(queue);
+		}
+
+		std::shared_ptr<PacketHandlerPool::Queue> PacketHandlerPool::take(State& state, size_t index)
+		{
+			std::shared_ptr<Queue> queue;
+			size_t count = state.workers.size();
+
+			// Own queues are taken oldest first, and stolen queues newest first
+			for (size_t i = 0; i < count && !queue; ++i)
+			{
+				Worker& worker = *state.workers[(index + i) % count];
+
+				std::lock_guard guard(worker.lock);
+				if (!worker.queues.empty())
+				{
+					if (i == 0)
+					{
+						queue = std::move(worker.queues.front());
+						worker.queues.pop_front();
+					}
+					else
+					{
+						queue = std::move(worker.queues.back());
+						worker.queues.pop_back();
+					}
+				}
+			}
+
+			return queue;
+		}
+
+		void PacketHandlerPool::workerLoop(State& state, size_t index)
+		{
+			while (state.running)
+			{
+				if (std::shared_ptr<Queue> queue = take(state, index))
+				{
+					run(queue, HANDLER_BUDGET);
+					continue;
+				}
+
+				std::unique_lock lock(state.signalLock);
+				state.signal.wait_for(lock, std::chrono::milliseconds(1));
+			}
+		}
+
+		void PacketHandlerPool::start(State& state, unsigned count)
+		{
+			state.running = true;
+
+			for (unsigned i = 0; i < count; ++i)
+				state.workers.emplace_back(new Worker);
+
+			for (unsigned i = 0; i < count; ++i)
+				state.workers[i]->thread = std::thread(&PacketHandlerPool::workerLoop, std::ref(state), static_cast<size_t>(i));
+
+			if (count == 0 && !state.tickClock)
+				state.tickClock = Util::Clock::addClock(40, []() { drain(); }, Util::Clock::getMainThreadId());
+			else if (count && state.tickClock)
+			{
+				Util::Clock::removeClock(state.tickClock);
+				state.tickClock = 0;
+			}
+
+			// Hand over anything that was waiting on the previous configuration
+			std::deque<std::shared_ptr<Queue>> queues;
+			std::swap(queues, state.tick.queues);
+
+			for (auto const& queue : queues)
+				schedule(queue);
+		}
+
+		void PacketHandlerPool::stop(State& state)
+		{
+			state.running = false;
+			state.signal.notify_all();
+
+			for (auto& worker : state.workers)
+			{
+				if (worker->thread.joinable())
+					worker->thread.join();
+
+				for (auto& queue : worker->queues)
+					state.tick.queues.push_back(queue);
+			}
+
+			state.workers.clear();
+		}
+
+		PacketHandlerPool::State& PacketHandlerPool::getState()
+		{
+			static State state;
+			return state;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ConnectionMetrics.h"
+#include "Packet.h"
+#include "PacketDispatcher.h"
+#include "SPSCQueue.h"
+
+#define HANDLER_QUEUE_SIZE 1024	// Decoded packets a connection may have waiting to be handled
+#define HANDLER_BUDGET 64		// Packets handled per turn before a worker moves on to another connection
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Runs packet handlers away from the socket threads. Each connection's packets are handled in order by one worker at
+		// a time, while different connections are handled in parallel. Idle workers steal connections from busy ones.
+		class PacketHandlerPool
+		{
+			public:
+				class Queue : public std::enable_shared_from_this<Queue>
+				{
+					friend class PacketHandlerPool;
+
+					public:
+						Queue(Connection const& conn, Direction direction, ConnectionMetrics& metrics);
+
+						// Called from the connection's socket thread only
+						void push(PacketDispatcher::Lease&& packet);
+
+						// Discards anything not yet handled, and waits for a handler in progress to return
+						void close();
+
+					private:
+						// Returns whether packets remain
+						bool drain(size_t budget);
+
+						Connection const& conn;
+						Direction direction;
+						ConnectionMetrics& metrics;
+						Util::SPSCQueue<PacketDispatcher::Lease, HANDLER_QUEUE_SIZE> packets;
+						std::atomic_bool scheduled = false;	// Waiting in, or being run by, exactly one worker
+						std::atomic_bool running = false;	// A handler is executing
+						std::atomic_bool closed = false;
+				};
+
+				// 0 workers defers handlers to the game tick. Should be set before any connection receives packets.
+				static void setWorkers(unsigned count);
+
+				static unsigned getWorkers();
+
+				// Handles everything waiting on the calling thread
+				static void drain();
+
+			private:
+				struct Worker
+				{
+					std::deque<std::shared_ptr<Queue>> queues;
+					std::mutex lock;
+					std::thread thread;
+				};
+
+				struct State
+				{
+					State();
+
+					~State();
+
+					std::vector<std::unique_ptr<Worker>> workers;
+					Worker tick;						// Queues waiting for the game tick when there are no workers
+					std::atomic_size_t next = 0U;		// Round robin assignment of newly scheduled queues
+					std::atomic_bool running = true;
+					std::mutex signalLock;
+					std::condition_variable signal;
+					long tickClock = 0;
+				};
+
+				static void schedule(std::shared_ptr<Queue> const& queue);
+
+				static void run(std::shared_ptr<Queue> const& queue, size_t budget);
+
+				static std::shared_ptr<Queue> take(State& state, size_t index);
+
+				static void workerLoop(State& state, size_t index);
+
+				static void start(State& state, unsigned count);
+
+				static void stop(State& state);
+
+				static State& getState();
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "InetConnection.h"
+#include "PacketInput.h"
+#include "PlayerConnection.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketInput::PacketInput(std::deque<inputType> const& inputs) : Packet<PacketInput>()
+		{
+			for (auto iter = inputs.rbegin(); iter != inputs.rend() && this->inputs.size() < INPUT_REDUNDANCY; ++iter)
+			{
+				// Older inputs are sent as a 16 bit offset from the next, so stop at a gap too large to express
+				if (!this->inputs.empty() && this->inputs.back().first - iter->first > 0xFFFFULL)
+					break;
+
+				this->inputs.emplace_back(iter->first, BitStream(iter->second));
+			}
+		}
+
+		void PacketInput::serialize(BitStream& stream)
+		{
+			stream.write(static_cast<unsigned char>(inputs.size()));
+
+			if (inputs.empty())
+				return;
+
+			stream.write(static_cast<uint64_t>(inputs.front().first));
+			stream.write(inputs.front().second);
+
+			for (size_t i = 1; i < inputs.size(); ++i)
+			{
+				BitStream const& newer = inputs[i - 1].second;
+				BitStream const& input = inputs[i].second;
+
+				stream.write(static_cast<uint16_t>(inputs[i - 1].first - inputs[i].first), 16);
+
+				// Inputs rarely change between samples, so each byte costs a bit unless it differs from the newer input's
+				bool delta = input.size() == newer.size();
+				stream.write(delta, 1);
+
+				if (!delta)
+				{
+					stream.write(input);
+					continue;
+				}
+
+				auto const& bytes = input.data();
+				auto const& newerBytes = newer.data();
+
+				for (size_t j = 0; j < bytes.size(); ++j)
+				{
+					bool changed = bytes[j] != newerBytes[j];
+					stream.write(changed, 1);
+
+					if (changed)
+						stream.write(bytes[j]);
+				}
+			}
+		}
+
+		void PacketInput::deserialize(BitStream& stream)
+		{
+			unsigned char count = 0U;
+			stream.read(count);
+
+			if (!count)
+				return;
+
+			uint64_t timestamp = 0ULL;
+			stream.read(timestamp);
+
+			BitStream newest;
+			stream.read(newest);
+
+			inputs.reserve(count);
+			inputs.emplace_back(timestamp, std::move(newest));
+
+			for (unsigned char i = 1; i < count; ++i)
+			{
+				uint16_t offset = 0U;
+				stream.read(offset, 16);
+
+				bool delta = false;
+				stream.read(delta, 1);
+
+				BitStream input;
+
+				if (!delta)
+					stream.read(input);
+				else
+				{
+					BitStream const& newer = inputs.back().second;
+					std::string bytes(newer.data().data(), newer.data().size());
+
+					for (size_t j = 0; j < bytes.size(); ++j)
+					{
+						bool changed = false;
+						stream.read(changed, 1);
+
+						if (changed)
+							stream.read(bytes[j]);
+					}
+
+					input.write(bytes.data(), static_cast<unsigned>(newer.size()));
+				}
+
+				inputs.emplace_back(inputs.back().first - offset, std::move(input));
+			}
+		}
+
+		void PacketInput::handle(InetConnection const& conn, Direction direction)
+		{
+			if (PlayerConnection const* player = dynamic_cast<PlayerConnection const*>(&conn))
+				const_cast<PlayerConnection*>(player)->receiveInputs(inputs);
+		}
+
+		bool PacketInput::shouldRetransmit() const
+		{
+			return false;	// The next packet repeats anything lost
+		}
+
+		void PacketInput::reset()
+		{
+			inputs.clear();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "Packet.h"
+
+#define INPUT_REDUNDANCY 8		// Inputs carried by each packet, covering losses of up to about one in eight
+#define INPUT_QUEUE_SIZE 64		// Received inputs waiting for the server's simulation
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Unreliable channel for client inputs. Every packet repeats the last few timestamped inputs, each older one encoded
+		// as the bytes it differs by from the next, so the server recovers a lost input from the next packet rather than
+		// waiting a round trip for a retransmission. Packets are sent outside the ordered window, and inputs already
+		// received are skipped by their timestamp.
+		class PacketInput : public Packet<PacketInput>
+		{
+			public:
+				using inputType = std::pair<unsigned long long, BitStream>;
+
+				PacketInput() = default;
+
+				// Newest input last
+				PacketInput(std::deque<inputType> const& inputs);
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+				virtual bool shouldRetransmit() const;
+
+				virtual void reset();
+
+			private:
+				std::vector<inputType> inputs;	// Newest input first
+		};
+	}
+}
\ No newline at end of file
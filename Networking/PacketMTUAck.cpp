@@ -0,0 +1,27 @@
+#include "InetConnection.h"
+#include "PacketMTUAck.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketMTUAck::PacketMTUAck(unsigned short size) : Packet<PacketMTUAck>(), size(size)
+		{
+		}
+
+		void PacketMTUAck::serialize(BitStream& stream)
+		{
+			stream.write(size);
+		}
+
+		void PacketMTUAck::deserialize(BitStream& stream)
+		{
+			stream.read(size);
+		}
+
+		void PacketMTUAck::handle(InetConnection const& conn, Direction direction)
+		{
+			const_cast<InetConnection&>(conn).confirmMTU(size);
+		}
+	}
+}
\ No newline at end of file
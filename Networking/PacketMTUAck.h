@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Packet.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		class PacketMTUAck : public Packet<PacketMTUAck>
+		{
+			public:
+				PacketMTUAck() = default;
+
+				PacketMTUAck(unsigned short size);
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+			private:
+				uint16_t size = 0U;
+		};
+	}
+}
\ No newline at end of file
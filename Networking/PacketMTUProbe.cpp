@@ -0,0 +1,43 @@
+#include "InetConnection.h"
+#include "PacketMTUAck.h"
+#include "PacketMTUProbe.h"
+
+#define PROBE_OVERHEAD 12	// Sequence number (4), packet length (2), packet index (2), probe size (2), padding length (2)
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketMTUProbe::PacketMTUProbe(unsigned short size) : Packet<PacketMTUProbe>(), size(size), padding(size > PROBE_OVERHEAD ? size - PROBE_OVERHEAD : 0, '\0')
+		{
+		}
+
+		void PacketMTUProbe::serialize(BitStream& stream)
+		{
+			stream.write(size);
+			stream.write(padding);
+		}
+
+		void PacketMTUProbe::deserialize(BitStream& stream)
+		{
+			stream.read(size);
+			stream.read(padding);
+		}
+
+		void PacketMTUProbe::handle(InetConnection const& conn, Direction direction)
+		{
+			conn.send(new PacketMTUAck(size));
+		}
+
+		bool PacketMTUProbe::shouldRetransmit() const
+		{
+			return false;
+		}
+
+		void PacketMTUProbe::reset()
+		{
+			size = 0U;
+			padding.clear();
+		}
+	}
+}
\ No newline at end of file
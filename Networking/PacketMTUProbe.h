@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Packet.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Padded to an exact datagram size, and acknowledged by the receiver if it arrives intact
+		class PacketMTUProbe : public Packet<PacketMTUProbe>
+		{
+			public:
+				PacketMTUProbe() = default;
+
+				PacketMTUProbe(unsigned short size);
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+				virtual bool shouldRetransmit() const;
+
+				void reset();
+
+			private:
+				uint16_t size = 0U;
+				std::string padding;
+		};
+	}
+}
\ No newline at end of file
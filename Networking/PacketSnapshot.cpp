@@ -0,0 +1,146 @@
+#include <algorithm>
+
+#include "InetConnection.h"
+#include "JitterBuffer.h"
+#include "PacketSnapshot.h"
+#include "PacketSnapshotAck.h"
+#include "PlayerConnection.h"
+
+#define SNAPSHOT_OVERHEAD 30	// Sequence number (4), packet length (2), packet index (2), baseline (8), timestamp (8), part (2), parts (2), count (2)
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		std::vector<std::shared_ptr<PacketSnapshot>> PacketSnapshot::create(unsigned long long baseline, unsigned long long timestamp, changeType const& changes, unsigned short fragmentSize)
+		{
+			std::vector<std::shared_ptr<PacketSnapshot>> snapshots;
+			size_t budget = (fragmentSize > SNAPSHOT_OVERHEAD ? fragmentSize - SNAPSHOT_OVERHEAD : 0) * Util::byteSize();
+
+			for (auto const& component : changes)
+			{
+				BitStream record;
+				writeRecord(record, component);
+
+				// Start a new part once this record would push the current one past a single datagram
+				if (snapshots.empty() || (snapshots.back()->count && snapshots.back()->components.size() + record.size() > budget))
+				{
+					snapshots.emplace_back(new PacketSnapshot);
+					snapshots.back()->baseline = baseline;
+					snapshots.back()->timestamp = timestamp;
+					snapshots.back()->part = static_cast<uint16_t>(snapshots.size() - 1);
+				}
+
+				snapshots.back()->components << record;
+				++snapshots.back()->count;
+			}
+
+			for (auto& snapshot : snapshots)
+				snapshot->parts = static_cast<uint16_t>(snapshots.size());
+
+			return snapshots;
+		}
+
+		size_t PacketSnapshot::measure(changeType::value_type const& component)
+		{
+			BitStream record;
+			writeRecord(record, component);
+
+			return (record.size() + Util::byteSize() - 1) / Util::byteSize();
+		}
+
+		void PacketSnapshot::serialize(BitStream& stream)
+		{
+			stream.write(baseline);
+			stream.write(timestamp);
+			stream.write(part);
+			stream.write(parts);
+			stream.write(count);
+			stream << components;
+		}
+
+		void PacketSnapshot::deserialize(BitStream& stream)
+		{
+			stream.read(baseline);
+			stream.read(timestamp);
+			stream.read(part);
+			stream.read(parts);
+			stream.read(count);
+
+			for (uint16_t i = 0; i < count; ++i)
+			{
+				Util::UUID componentId;
+				stream.read(componentId);
+
+				uint16_t variables = 0;
+				stream.read(variables);
+
+				auto& component = changes[componentId];
+
+				for (uint16_t j = 0; j < variables; ++j)
+				{
+					uint16_t id = 0;
+					stream.read(id);
+
+					auto& variable = component[id];
+					stream.read(variable.first);
+					stream.read(variable.second);
+				}
+			}
+		}
+
+		void PacketSnapshot::handle(InetConnection const& conn, Direction direction)
+		{
+			InetConnection& connection = const_cast<InetConnection&>(conn);
+
+			// Parts of a snapshot older than one already applied would roll state back
+			if (timestamp < connection.lastSnapshot || !parts || part >= parts)
+				return;
+
+			if (timestamp != connection.lastSnapshot)
+			{
+				connection.lastSnapshot = timestamp;
+				connection.snapshotParts.assign(parts, false);
+
+				if (PlayerConnection* player = dynamic_cast<PlayerConnection*>(&connection))
+					player->sampleServerClock(timestamp);
+			}
+
+			JitterBuffer::push(timestamp, std::move(changes));
+
+			connection.snapshotParts[part] = true;
+
+			if (std::find(connection.snapshotParts.begin(), connection.snapshotParts.end(), false) == connection.snapshotParts.end())
+				conn.send(new PacketSnapshotAck(timestamp));
+		}
+
+		bool PacketSnapshot::shouldRetransmit() const
+		{
+			return false;	// Anything lost is resent in the next delta, as the baseline will not have advanced
+		}
+
+		void PacketSnapshot::reset()
+		{
+			baseline = 0ULL;
+			timestamp = 0ULL;
+			part = 0U;
+			parts = 0U;
+			count = 0U;
+			components.clear();
+			changes.clear();
+		}
+
+		void PacketSnapshot::writeRecord(BitStream& record, changeType::value_type const& component)
+		{
+			record.write(component.first);
+			record.write(static_cast<uint16_t>(component.second.size()));
+
+			for (auto const& variable : component.second)
+			{
+				record.write(variable.first);
+				record.write(static_cast<uint64_t>(variable.second.first));
+				record.write(variable.second.second);
+			}
+		}
+	}
+}
\ No newline at end of file
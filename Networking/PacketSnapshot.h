@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Packet.h"
+#include "UUID.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Every change since the client's acknowledged baseline, split into parts which each fit a single datagram
+		class PacketSnapshot : public Packet<PacketSnapshot>
+		{
+			public:
+				using changeType = std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, BitStream>>>;
+
+				PacketSnapshot() = default;
+
+				static std::vector<std::shared_ptr<PacketSnapshot>> create(unsigned long long baseline, unsigned long long timestamp, changeType const& changes, unsigned short fragmentSize);
+
+				// Bytes a component's record takes up in a snapshot
+				static size_t measure(changeType::value_type const& component);
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+				virtual bool shouldRetransmit() const;
+
+				void reset();
+
+			private:
+				static void writeRecord(BitStream& record, changeType::value_type const& component);
+
+				uint64_t baseline = 0ULL;
+				uint64_t timestamp = 0ULL;
+				uint16_t part = 0U;
+				uint16_t parts = 0U;
+				uint16_t count = 0U;
+				BitStream components;	// Serialized component records (sending side)
+				changeType changes;		// Deserialized component records (receiving side)
+		};
+	}
+}
\ No newline at end of file
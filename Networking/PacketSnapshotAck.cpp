@@ -0,0 +1,34 @@
+#include "InetConnection.h"
+#include "PacketSnapshotAck.h"
+#include "PlayerConnection.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketSnapshotAck::PacketSnapshotAck(unsigned long long timestamp) : Packet<PacketSnapshotAck>(), timestamp(timestamp)
+		{
+		}
+
+		void PacketSnapshotAck::serialize(BitStream& stream)
+		{
+			stream.write(timestamp);
+		}
+
+		void PacketSnapshotAck::deserialize(BitStream& stream)
+		{
+			stream.read(timestamp);
+		}
+
+		void PacketSnapshotAck::handle(InetConnection const& conn, Direction direction)
+		{
+			if (PlayerConnection const* player = dynamic_cast<PlayerConnection const*>(&conn))
+				const_cast<PlayerConnection*>(player)->acknowledgeSnapshot(timestamp);
+		}
+
+		bool PacketSnapshotAck::shouldRetransmit() const
+		{
+			return false;	// A later acknowledgement supersedes a lost one
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Packet.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Confirms every part of a snapshot arrived, making it the baseline for the next delta
+		class PacketSnapshotAck : public Packet<PacketSnapshotAck>
+		{
+			public:
+				PacketSnapshotAck() = default;
+
+				PacketSnapshotAck(unsigned long long timestamp);
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+				virtual bool shouldRetransmit() const;
+
+			private:
+				uint64_t timestamp = 0ULL;
+		};
+	}
+}
\ No newline at end of file
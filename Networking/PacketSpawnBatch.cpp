@@ -0,0 +1,70 @@
+#include "Messenger.h"
+#include "NetworkManager.h"
+#include "PacketSpawnBatch.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		void PacketSpawnBatch::add(BitStream const& record)
+		{
+			records << record;
+			++count;
+		}
+
+		size_t PacketSpawnBatch::getSize() const
+		{
+			return records.size();
+		}
+
+		uint16_t PacketSpawnBatch::getCount() const
+		{
+			return count;
+		}
+
+		void PacketSpawnBatch::setProgress(uint32_t streamed, uint32_t total)
+		{
+			this->streamed = streamed;
+			this->total = total;
+		}
+
+		void PacketSpawnBatch::serialize(BitStream& stream)
+		{
+			stream.write(streamed);
+			stream.write(total);
+			stream.write(count);
+			stream << records;
+		}
+
+		void PacketSpawnBatch::deserialize(BitStream& stream)
+		{
+			stream.read(streamed);
+			stream.read(total);
+			stream.read(count);
+
+			for (uint16_t i = 0; i < count; ++i)
+			{
+				std::shared_ptr<PacketSpawnObject> spawn = std::make_shared<PacketSpawnObject>();
+				spawn->deserialize(stream);
+				spawns.push_back(std::move(spawn));
+			}
+		}
+
+		void PacketSpawnBatch::handle(InetConnection const& conn, Direction direction)
+		{
+			for (auto const& spawn : spawns)
+				spawn->handle(conn, direction);
+
+			Util::Messenger::send(new ClientJoinProgress{ streamed, total });
+		}
+
+		void PacketSpawnBatch::reset()
+		{
+			streamed = 0U;
+			total = 0U;
+			count = 0U;
+			records.clear();
+			spawns.clear();
+		}
+	}
+}
\ No newline at end of file
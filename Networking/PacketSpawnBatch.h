@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Packet.h"
+#include "PacketSpawnObject.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Several object spawns packed into a single datagram while the initial state is streamed to a client, along with how
+		// many of the spawns queued for it have been sent so far.
+		class PacketSpawnBatch : public Packet<PacketSpawnBatch>
+		{
+			public:
+				PacketSpawnBatch() = default;
+
+				// Appends a serialized PacketSpawnObject
+				void add(BitStream const& record);
+
+				// Bits of spawns added so far
+				size_t getSize() const;
+
+				uint16_t getCount() const;
+
+				void setProgress(uint32_t streamed, uint32_t total);
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+				void reset();
+
+			private:
+				uint32_t streamed = 0U;
+				uint32_t total = 0U;
+				uint16_t count = 0U;
+				BitStream records;										// Serialized spawns (sending side)
+				std::vector<std::shared_ptr<PacketSpawnObject>> spawns;	// Deserialized spawns (receiving side)
+		};
+	}
+}
\ No newline at end of file
@@ -1,21 +1,47 @@
+#include <algorithm>
+
+#include "ComponentPool.h"
 #include "Engine.h"
 #include "GameObject.h"
-#include "Model.h"
+#include "InetConnection.h"
+#include "ModelReferences.h"
 #include "PacketSpawnObject.h"
 
+#ifndef HEADLESS
+#include "Camera.h"
+#include "PlayerController.h"
+#endif
+
 namespace TechDemo
 {
 	namespace IO
 	{
-		PacketSpawnObject::PacketSpawnObject(const Util::UUID& uuid, const std::string& model, const World::Transform& modelOffset, const std::unordered_set<std::shared_ptr<World::ComponentBase>>& components) : Packet<PacketSpawnObject>(), uuid(uuid), model(model), modelOffset(modelOffset), components(components)
+		PacketSpawnObject::PacketSpawnObject(const Util::UUID& uuid, const std::string& model, const World::Transform& modelOffset, const std::unordered_set<std::shared_ptr<World::ComponentBase>>& components, bool observer) : Packet<PacketSpawnObject>(), uuid(uuid), modelOffset(modelOffset), components(components.begin(), components.end()), observer(observer)
 		{
+			this->model.value = model;
 		}
 
 		void PacketSpawnObject::serialize(BitStream& stream)
+		{
+			write(stream, nullptr, nullptr);
+		}
+
+		void PacketSpawnObject::serialize(BitStream& stream, StringTable& strings, TypeTable& types)
+		{
+			write(stream, &strings, &types);
+		}
+
+		void PacketSpawnObject::write(BitStream& stream, StringTable* strings, TypeTable* types)
 		{
 			stream.write(uuid);
-			stream.write(model);
+
+			if (strings)
+				strings->write(stream, model.value);
+			else
+				StringTable::writeInline(stream, model.value);
+
 			stream.write(modelOffset);
+			stream.write(observer, 1);
 
 			uint16_t size = 0U;
 			BitStream compStr;
@@ -24,9 +50,17 @@ namespace TechDemo
 			{
 				if (comp->synchronized())
 				{
-					compStr.write(comp->getTypeHash());
+					if (types)
+						types->write(compStr, comp->getTypeHash());
+					else
+						TypeTable::writeInline(compStr, comp->getTypeHash());
+
 					compStr.write(comp->getUUID());
-					compStr.write(*comp);
+
+					// Sent with its length, so the receiver can hold it until the type is resolved, or skip an unknown type
+					BitStream data;
+					data.write(*comp);
+					compStr.write(data);
 
 					++size;
 				}
@@ -39,36 +73,65 @@ namespace TechDemo
 		void PacketSpawnObject::deserialize(BitStream& stream)
 		{
 			stream.read(uuid);
-			stream.read(model);
+			StringTable::read(stream, model);
 			stream.read(modelOffset);
+			stream.read(observer, 1);
 
 			uint16_t size = 0;
 			stream.read(size);
 
-			for (uint16_t i = 0; i < size; ++i)
+			records.resize(size);
+
+			for (auto& record : records)
+			{
+				TypeTable::read(stream, record.type);
+				stream.read(record.uuid);
+				stream.read(record.data);
+			}
+		}
+
+		void PacketSpawnObject::handle(InetConnection const& conn, Direction direction)
+		{
+			std::vector<TypeTable::Entry> types;
+			for (auto const& record : records)
+				types.push_back(record.type);
+
+			// The packet returns to its pool once handled, so a spawn held for its model path or types keeps its own copies
+			conn.getReceivedStrings().resolve(model, [&conn, uuid = uuid, modelOffset = modelOffset, records = records, types = std::move(types), observer = observer](std::string const& model)
 			{
-				uint32_t type = 0;
-				stream.read(type);
+				conn.getReceivedTypes().resolve(types, [uuid, model, modelOffset, records, observer](std::vector<uint32_t> const& hashes)
+				{
+					spawn(uuid, model, modelOffset, create(records, hashes), observer);
+				});
+			});
+		}
 
-				auto comp = World::ComponentBase::create(type);
+		std::vector<std::shared_ptr<World::ComponentBase>> PacketSpawnObject::create(std::vector<Record> const& records, std::vector<uint32_t> const& hashes)
+		{
+			std::vector<std::shared_ptr<World::ComponentBase>> components;
 
-				Util::UUID uuid;
-				stream.read(uuid);
+			for (size_t i = 0; i < records.size() && i < hashes.size(); ++i)
+			{
+				auto comp = World::ComponentPool::create(hashes[i]);
+				if (!comp)
+					continue;
 
-				comp->uuid = uuid;
+				comp->uuid = records[i].uuid;
 
-				stream.read(*comp);
+				BitStream data(records[i].data);
+				data.read(*comp);
 
-				components.emplace(comp);
+				components.emplace_back(comp);
 			}
+
+			return components;
 		}
 
-		void PacketSpawnObject::handle(InetConnection const& conn, Direction direction)
+		void PacketSpawnObject::spawn(Util::UUID const& uuid, std::string const& model, World::Transform const& modelOffset, std::vector<std::shared_ptr<World::ComponentBase>> const& components, bool observer)
 		{
 			World::GameObject* object = new World::GameObject(uuid);
 
-			if (!model.empty())
-				object->setModel(Graphics::Model::getModel(model));
+			World::ModelReferences::assign(*object, model);
 
 			object->getModelOffset() = modelOffset;
 
@@ -80,6 +143,20 @@ namespace TechDemo
 				comp->init();
 			object->componentsLock.unlock();
 
+#ifndef HEADLESS
+			// The server does not need the camera, so it is created here rather than replicated
+			if (observer)
+			{
+				static const uint32_t controllerHash = Util::CRC32::checksum(Util::getQualifiedName<IO::PlayerController>());
+
+				object->addComponent<Graphics::Camera>()->setSynchronized(true);
+
+				// Nor does a headless server carry the controller
+				if (std::none_of(components.begin(), components.end(), [](std::shared_ptr<World::ComponentBase> const& comp) { return comp->getTypeHash() == controllerHash; }))
+					object->addComponent<IO::PlayerController>();
+			}
+#endif
+
 			Engine::getScene().addObject(object);
 		}
 
@@ -87,5 +164,15 @@ namespace TechDemo
 		{
 			this->uuid = uuid;
 		}
+
+		void PacketSpawnObject::reset()
+		{
+			uuid = Util::UUID();
+			model = StringTable::Entry();
+			modelOffset = World::Transform();
+			components.clear();
+			records.clear();
+			observer = false;
+		}
 	}
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <unordered_set>
+#include <vector>
 
 #include "Component.h"
 #include "Packet.h"
+#include "StringTable.h"
+#include "TypeTable.h"
 #include "UUID.h"
 
 namespace TechDemo
@@ -15,21 +18,45 @@ namespace TechDemo
 			public:
 				PacketSpawnObject() = default;
 
-				PacketSpawnObject(const Util::UUID& uuid, const std::string& model, const World::Transform& modelOffset, const std::unordered_set<std::shared_ptr<World::ComponentBase>>& components);
+				// An observer object is the receiving client's own, and is given a camera on arrival
+				PacketSpawnObject(const Util::UUID& uuid, const std::string& model, const World::Transform& modelOffset, const std::unordered_set<std::shared_ptr<World::ComponentBase>>& components, bool observer = false);
 
+				// Writes the model path and component types inline, as there is no connection to keep tables for
 				virtual void serialize(BitStream& stream);
 
+				// Writes the model path and component types through the connection's tables
+				void serialize(BitStream& stream, StringTable& strings, TypeTable& types);
+
 				virtual void deserialize(BitStream& stream);
 
 				virtual void handle(InetConnection const& conn, Direction direction);
 
 				void setUUID(const Util::UUID& uuid);
 
+				// Clears the packet for reuse by the dispatcher's pool, keeping its storage.
+				void reset();
+
 			private:
+				// A received component, which is only created once its type has been resolved
+				struct Record
+				{
+					TypeTable::Entry type;
+					Util::UUID uuid;
+					BitStream data;
+				};
+
+				void write(BitStream& stream, StringTable* strings, TypeTable* types);
+
+				static std::vector<std::shared_ptr<World::ComponentBase>> create(std::vector<Record> const& records, std::vector<uint32_t> const& hashes);
+
+				static void spawn(Util::UUID const& uuid, std::string const& model, World::Transform const& modelOffset, std::vector<std::shared_ptr<World::ComponentBase>> const& components, bool observer);
+
 				Util::UUID uuid;
-				std::string model;
+				StringTable::Entry model;
 				World::Transform modelOffset;
-				std::unordered_set<std::shared_ptr<World::ComponentBase>> components;
+				std::vector<std::shared_ptr<World::ComponentBase>> components;	// Sending side
+				std::vector<Record> records;										// Receiving side
+				bool observer = false;
 		};
 	}
 }
\ No newline at end of file
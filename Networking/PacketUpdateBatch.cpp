@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <limits>
+
+#include "Component.h"
+#include "PacketUpdateBatch.h"
+#include "RTTI.h"
+#include "Simulation.h"
+
+#define BATCH_OVERHEAD 18	// Sequence number (4), packet length (2), packet index (2), timestamp (8), count (2)
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		std::vector<std::shared_ptr<PacketUpdateBatch>> PacketUpdateBatch::create(unsigned long long timestamp, changeType const& changes, unsigned short fragmentSize, std::unordered_map<Util::UUID, uint32_t> const& types)
+		{
+			std::vector<std::shared_ptr<PacketUpdateBatch>> batches;
+			size_t budget = (fragmentSize > BATCH_OVERHEAD ? fragmentSize - BATCH_OVERHEAD : 0) * Util::byteSize();
+
+			for (auto const& component : changes)
+			{
+				uint32_t typeHash = 0U;
+
+				if (std::shared_ptr<World::ComponentBase> instance = World::ComponentBase::getComponent(component.first))
+					typeHash = instance->getTypeHash();
+				else
+				{
+					auto known = types.find(component.first);
+					if (known == types.end())
+						continue;
+
+					typeHash = known->second;
+				}
+
+				Util::RTTI::Type const* type = Util::RTTI::getType(typeHash);
+
+				if (!type)
+					continue;
+
+				// Both ends number the same registered variables, so a variable's id is its position in the mask
+				uint16_t variables = type->getVariableCount();
+
+				// Variables are sent with their length, so a receiver without the type can skip past them
+				BitStream data;
+
+				for (uint16_t id = 0; id < variables; ++id)
+					data.write(component.second.count(id) != 0, 1);
+
+				for (uint16_t id = 0; id < variables; ++id)
+				{
+					auto variable = component.second.find(id);
+					if (variable == component.second.end())
+						continue;
+
+					// Changes are rarely older than a tick, so most timestamps fit as an age relative to the batch
+					unsigned long long time = variable->second.first;
+					if (time <= timestamp && timestamp - time <= std::numeric_limits<uint32_t>::max())
+					{
+						data.write(true, 1);
+						data.write(static_cast<uint32_t>(timestamp - time));
+					}
+					else
+					{
+						data.write(false, 1);
+						data.write(static_cast<uint64_t>(time));
+					}
+
+					// Fixed size values are sent without a length, as the receiver knows the size from the type
+					auto info = type->getVariable(id);
+					Util::RTTI::Type const* varType = std::get<2>(info);
+					BitStream const& value = variable->second.second;
+
+					if (varType && !std::get<3>(info) && value.size() == varType->size)
+					{
+						data.write(true, 1);
+						data << value;
+					}
+					else
+					{
+						data.write(false, 1);
+						data.write(value);
+					}
+				}
+
+				BitStream record;
+				record.write(component.first);
+				record.write(typeHash);
+				record.write(data);
+
+				// Start another batch only once this record would push the current one past a single datagram
+				if (batches.empty() || (batches.back()->count && batches.back()->components.size() + record.size() > budget))
+				{
+					batches.emplace_back(new PacketUpdateBatch);
+					batches.back()->timestamp = timestamp;
+				}
+
+				batches.back()->components << record;
+				++batches.back()->count;
+			}
+
+			return batches;
+		}
+
+		void PacketUpdateBatch::serialize(BitStream& stream)
+		{
+			stream.write(timestamp);
+			stream.write(count);
+			stream << components;
+		}
+
+		void PacketUpdateBatch::deserialize(BitStream& stream)
+		{
+			stream.read(timestamp);
+			stream.read(count);
+
+			for (uint16_t i = 0; i < count; ++i)
+			{
+				Util::UUID componentId;
+				stream.read(componentId);
+
+				uint32_t typeHash = 0U;
+				stream.read(typeHash);
+
+				BitStream data;
+				stream.read(data);
+
+				Util::RTTI::Type const* type = Util::RTTI::getType(typeHash);
+
+				// Skipped, as a type this end does not register cannot be decoded
+				if (!type)
+					continue;
+
+				std::vector<uint16_t> changed;
+				for (uint16_t id = 0; id < type->getVariableCount(); ++id)
+				{
+					bool set = false;
+					data.read(set, 1);
+
+					if (set)
+						changed.push_back(id);
+				}
+
+				auto& component = changes[componentId];
+
+				for (uint16_t id : changed)
+				{
+					auto& variable = component[id];
+
+					bool relative = false;
+					data.read(relative, 1);
+
+					if (relative)
+					{
+						uint32_t age = 0U;
+						data.read(age);
+						variable.first = timestamp - age;
+					}
+					else
+						data.read(variable.first);
+
+					bool fixed = false;
+					data.read(fixed, 1);
+
+					if (fixed)
+					{
+						for (unsigned remaining = static_cast<unsigned>(std::get<2>(type->getVariable(id))->size); remaining;)
+						{
+							unsigned bits = std::min(remaining, static_cast<unsigned>(Util::byteSize()));
+
+							char c = 0;
+							data.read(c, bits);
+							variable.second.write(c, bits);
+
+							remaining -= bits;
+						}
+					}
+					else
+						data.read(variable.second);
+				}
+			}
+		}
+
+		void PacketUpdateBatch::handle(InetConnection const& conn, Direction direction)
+		{
+			// Applied by the simulation thread at the start of its next tick
+			for (auto& component : changes)
+				World::Simulation::enqueue(component.first, std::move(component.second));
+		}
+
+		void PacketUpdateBatch::reset()
+		{
+			timestamp = 0ULL;
+			count = 0U;
+			components.clear();
+			changes.clear();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Packet.h"
+#include "UUID.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Every component changed on the client during one tick. Variables are sent as a bitmask over the component type's
+		// leaf variable ids rather than by name, and the message is only split when it would not fit a single datagram. Each
+		// record carries its length, so records of a type the receiver does not register are skipped.
+		class PacketUpdateBatch : public Packet<PacketUpdateBatch>
+		{
+			public:
+				using changeType = std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, BitStream>>>;
+
+				PacketUpdateBatch() = default;
+
+				// Component types are taken from the live components, or from types for components with no local instance (such
+				// as a headless client's)
+				static std::vector<std::shared_ptr<PacketUpdateBatch>> create(unsigned long long timestamp, changeType const& changes, unsigned short fragmentSize, std::unordered_map<Util::UUID, uint32_t> const& types = {});
+
+				virtual void serialize(BitStream& stream);
+
+				virtual void deserialize(BitStream& stream);
+
+				virtual void handle(InetConnection const& conn, Direction direction);
+
+				void reset();
+
+			private:
+				uint64_t timestamp = 0ULL;
+				uint16_t count = 0U;
+				BitStream components;	// Serialized component records (sending side)
+				changeType changes;		// Deserialized component records (receiving side)
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include <algorithm>
+
+#include "BitStream.h"
+#include "Parity.h"
+
+#define FEC_HEADER 7	// Sequence number (4), group size (1), length parity (2)
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		void ParityEncoder::setEnabled(bool enabled)
+		{
+			this->enabled = enabled;
+		}
+
+		bool ParityEncoder::isEnabled() const
+		{
+			return enabled;
+		}
+
+		unsigned char ParityEncoder::getGroupSize() const
+		{
+			return groupSize;
+		}
+
+		void ParityEncoder::adapt(unsigned long long sent, unsigned long long resent)
+		{
+			unsigned long long sentDelta = sent - lastSent;
+			unsigned long long resentDelta = resent - lastResent;
+
+			lastSent = sent;
+			lastResent = resent;
+
+			// Every retransmission answers a datagram the receiver reported missing
+			if (sentDelta)
+				lossRate += (std::min(static_cast<float>(resentDelta) / sentDelta, 1.0f) - lossRate) * FEC_LOSS_SMOOTHING;
+
+			float size = lossRate > 0.0f ? FEC_TARGET_LOSSES / lossRate : static_cast<float>(FEC_MAX_GROUP);
+			groupSize = static_cast<unsigned char>(std::clamp(size, static_cast<float>(FEC_MIN_GROUP), static_cast<float>(FEC_MAX_GROUP)));
+		}
+
+		std::string ParityEncoder::add(uint32_t sequenceNumber, const char* header, unsigned headerLength, const char* data, unsigned length)
+		{
+			if (!enabled || headerLength < sizeof(uint32_t))
+				return std::string();
+
+			// A group only covers consecutive datagrams, as the receiver identifies them by their position in it
+			if (count && sequenceNumber != first + count)
+				count = 0;
+
+			if (!count)
+			{
+				first = sequenceNumber;
+				lengths = 0U;
+				parity.clear();
+			}
+
+			// The sequence number is implied by the position in the group, so is left out
+			unsigned covered = headerLength - sizeof(uint32_t) + length;
+			if (parity.size() < covered)
+				parity.resize(covered, 0);
+
+			size_t position = 0;
+			for (unsigned i = sizeof(uint32_t); i < headerLength; ++i)
+				parity[position++] ^= header[i];
+
+			for (unsigned i = 0; i < length; ++i)
+				parity[position++] ^= data[i];
+
+			lengths ^= static_cast<uint16_t>(covered);
+
+			if (++count < groupSize)
+				return std::string();
+
+			BitStream stream;
+			stream.write(static_cast<uint32_t>(first + FEC_SEQUENCE_OFFSET));
+			stream.write(count);
+			stream.write(lengths);
+
+			count = 0;
+
+			return std::string(stream.data().data(), stream.data().size()).append(parity);
+		}
+
+		void ParityEncoder::skip()
+		{
+			count = 0;
+		}
+
+		void ParityDecoder::add(uint32_t sequenceNumber, const char* data, unsigned length)
+		{
+			if (datagrams.emplace(sequenceNumber, std::string(data, length)).second)
+			{
+				order.push_back(sequenceNumber);
+
+				if (order.size() > FEC_WINDOW)
+				{
+					datagrams.erase(order.front());
+					order.pop_front();
+				}
+			}
+		}
+
+		std::string ParityDecoder::recover(const char* data, unsigned length, uint32_t expectedSequenceNumber) const
+		{
+			if (length < FEC_HEADER)
+				return std::string();
+
+			BitStream stream(const_cast<char*>(data), FEC_HEADER);
+
+			uint32_t first = 0U;
+			unsigned char count = 0U;
+			uint16_t lengths = 0U;
+
+			stream.read(first);
+			stream.read(count);
+			stream.read(lengths);
+
+			first -= FEC_SEQUENCE_OFFSET;
+
+			uint32_t missing = 0U;
+			unsigned missingCount = 0U;
+
+			for (unsigned char i = 0; i < count; ++i)
+			{
+				if (!datagrams.count(first + i))
+				{
+					missing = first + i;
+					++missingCount;
+				}
+			}
+
+			// Datagrams before the expected one have been received already, and merely aged out of the window
+			if (missingCount != 1 || missing - expectedSequenceNumber >= FEC_SEQUENCE_OFFSET)
+				return std::string();
+
+			std::string datagram(data + FEC_HEADER, length - FEC_HEADER);
+
+			for (unsigned char i = 0; i < count; ++i)
+			{
+				if (first + i == missing)
+					continue;
+
+				std::string const& other = datagrams.at(first + i);
+				size_t covered = other.size() - sizeof(uint32_t);
+
+				for (size_t j = 0; j < covered && j < datagram.size(); ++j)
+					datagram[j] ^= other[sizeof(uint32_t) + j];
+
+				lengths ^= static_cast<uint16_t>(covered);
+			}
+
+			if (lengths > datagram.size())
+				return std::string();
+
+			datagram.resize(lengths);
+
+			BitStream header;
+			header.write(missing);
+
+			return std::string(header.data().data(), header.data().size()).append(datagram);
+		}
+
+		bool ParityDecoder::isParity(uint32_t sequenceNumber, uint32_t expectedSequenceNumber)
+		{
+			// Real datagrams are never more than an eighth of the sequence space either side of the expected one, and
+			// unsequenced datagrams lie a quarter ahead of it
+			uint32_t distance = sequenceNumber - expectedSequenceNumber;
+			return distance >= FEC_SEQUENCE_OFFSET - FEC_SEQUENCE_OFFSET / 4 && distance < FEC_SEQUENCE_OFFSET + FEC_SEQUENCE_OFFSET / 4;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#define FEC_SEQUENCE_OFFSET 0x80000000U	// Parity datagrams are numbered half the sequence space away from those they cover
+#define FEC_OVERHEAD 3					// Group size (1) and length parity (2), beyond the largest datagram covered
+#define FEC_MIN_GROUP 2					// Datagrams covered by each parity datagram at the highest loss rates
+#define FEC_MAX_GROUP 32				// Datagrams covered by each parity datagram on a clean link
+#define FEC_TARGET_LOSSES 0.5f			// Expected losses per group the group size is chosen for (one can be rebuilt)
+#define FEC_LOSS_SMOOTHING 0.1f			// Weight of each new sample in the smoothed loss rate
+#define FEC_WINDOW 256					// Received datagrams kept to rebuild a lost one from
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Follows every group of consecutive datagrams with the XOR of them all, so that the receiver can rebuild one lost
+		// datagram per group without waiting a round trip for it to be resent. The group size shrinks as loss rises.
+		class ParityEncoder
+		{
+			public:
+				void setEnabled(bool enabled);
+
+				bool isEnabled() const;
+
+				unsigned char getGroupSize() const;
+
+				// Feeds the sender's datagram counters into the loss estimate, and resizes groups to suit it
+				void adapt(unsigned long long sent, unsigned long long resent);
+
+				// Adds a datagram (split into a header and data). Returns the parity datagram to send once a group is complete.
+				std::string add(uint32_t sequenceNumber, const char* header, unsigned headerLength, const char* data = nullptr, unsigned length = 0U);
+
+				// Ends the current group without sending its parity, for datagrams which cannot be covered
+				void skip();
+
+			private:
+				std::atomic_bool enabled = false;
+				std::atomic_uchar groupSize = FEC_MAX_GROUP;
+				float lossRate = 0.0f;
+				unsigned long long lastSent = 0ULL;
+				unsigned long long lastResent = 0ULL;
+
+				uint32_t first = 0U;		// Sequence number of the first datagram in the group
+				unsigned char count = 0U;	// Datagrams in the group so far
+				uint16_t lengths = 0U;		// XOR of the datagram lengths
+				std::string parity;			// XOR of the datagrams, less their sequence numbers
+		};
+
+		class ParityDecoder
+		{
+			public:
+				// Keeps a received datagram to rebuild others from
+				void add(uint32_t sequenceNumber, const char* data, unsigned length);
+
+				// Rebuilds the one datagram missing from a parity datagram's group. Returns an empty string if none is missing,
+				// more than one is, or the missing datagram is older than the oldest one still expected.
+				std::string recover(const char* data, unsigned length, uint32_t expectedSequenceNumber) const;
+
+				static bool isParity(uint32_t sequenceNumber, uint32_t expectedSequenceNumber);
+
+			private:
+				std::unordered_map<uint32_t, std::string> datagrams;
+				std::deque<uint32_t> order;	// Oldest first
+		};
+	}
+}
\ No newline at end of file
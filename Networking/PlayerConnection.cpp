@@ -1,29 +1,34 @@
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 #include <winsock2.h>
 #include <ws2tcpip.h>
 
-#include "Clock.h"
 #include "GameObject.h"
-#include "History.h"
+#include "InterestManager.h"
 #include "Packet.h"
+#include "PacketDispatcher.h"
+#include "PacketInput.h"
 #include "PacketNACK.h"
 #include "PacketPing.h"
-#include "PacketUpdateComponent.h"
+#include "PacketSnapshot.h"
+#include "PacketUpdateBatch.h"
 #include "PacketUpdateComponents.h"
 #include "PacketUpdateRigidBody.h"
 #include "PacketUpdateTransform.h"
 #include "PlayerConnection.h"
 #include "PlayerController.h"
+#include "PriorityAccumulator.h"
 #include "Serializable.h"
 #include "ServerConnection.h"
+#include "Simulation.h"
+#include "TimingWheel.h"
 
 #include "Engine.h"
 
-#define BUFFER_SIZE 1300
-
 namespace TechDemo
 {
 	namespace IO
@@ -35,10 +40,12 @@ namespace TechDemo
 		PlayerConnection::PlayerConnection(std::string const& ipAddress, unsigned short port, unsigned socket) : InetConnection(ipAddress, port, socket)
 		{
 			connected = true;
-			rttClock = Util::Clock::addClock(40, [this]()
+			rttClock = Util::TimingWheel::addSpread(std::chrono::milliseconds(CONNECTION_TICK_PERIOD), [this]()
 			{
 				if (isConnected())
 				{
+					recordRTT();
+
 					rttHistory.push_back(static_cast<float>(rtt.load()));
 					if (rttHistory.size() > 150)
 						rttHistory.erase(rttHistory.begin());
@@ -49,27 +56,50 @@ namespace TechDemo
 					ping->setTimestamp(timestamp);
 					send(std::shared_ptr<PacketBase>(ping));
 
-					//auto changes = World::History::getChanges<World::Transform>(Engine::getScene().getUUID(), lastUpdate, timestamp);
-					
-					//if (!changes.empty())
-					//	send(new PacketUpdateComponents(changes));
+					// Delta against the last snapshot the client confirmed, so lost snapshots are covered by the next one
+					if (unsigned long long baseline = ackedSnapshot)
+					{
+						// Cut from the simulation's newest published tick, so the snapshot's timestamp is lowered to match
+						unsigned long long snapshot = timestamp;
+						auto changes = World::Simulation::getChanges(Engine::getScene().getUUID(), baseline, snapshot);
+
+						std::unordered_map<Util::UUID, float> distances;
+						if (InterestManager::forEachRelevant(this, [&](Util::UUID const& componentId, float distance) { distances.emplace(componentId, distance); }))
+						{
+							for (auto iter = changes.begin(); iter != changes.end();)
+								iter = distances.count(iter->first) ? std::next(iter) : changes.erase(iter);
+						}
 
-					//for (auto const& pair : World::History::getChanges(Engine::getScene().getUUID(), lastUpdate, timestamp))
-					//	send(new PacketUpdateComponent(pair.first, pair.second));
+						auto selected = priorities.select(snapshot, baseline, changes, distances, updateBudget);
+
+						if (!selected.empty())
+						{
+							for (auto const& part : PacketSnapshot::create(baseline, snapshot, selected, getPayloadSize()))
+								send(part);
+						}
+						else if (changes.empty())
+							advanceSnapshot(snapshot);	// Nothing is waiting to be sent or acknowledged
+					}
 
 					missingPacketsLock.lock();
 					if (!missingPackets.empty())
 						send(new PacketNACK(missingPackets));
 					missingPacketsLock.unlock();
 
+					probeMTU();
+					adaptParity();
+
 					lastUpdate = timestamp;
 				}
-			}, Util::Clock::getMainThreadId());
+			});
 		}
 
 		PlayerConnection::~PlayerConnection()
 		{
-			Util::Clock::removeClock(rttClock);
+			// Handlers must not run against a partially destroyed connection
+			handlers->close();
+
+			Util::TimingWheel::remove(rttClock);
 		}
 
 		bool PlayerConnection::connect(std::string const& address)
@@ -81,10 +111,12 @@ namespace TechDemo
 		{
 			if (InetConnection::connect(ipAddress, port))
 			{
-				rttClock = Util::Clock::addClock(40, [this]()
+				rttClock = Util::TimingWheel::addSpread(std::chrono::milliseconds(CONNECTION_TICK_PERIOD), [this]()
 				{
 					if (isConnected())
 					{
+						recordRTT();
+
 						rttHistory.push_back(static_cast<float>(rtt.load()));
 						if (rttHistory.size() > 150)
 							rttHistory.erase(rttHistory.begin());
@@ -95,17 +127,28 @@ namespace TechDemo
 						ping->setTimestamp(timestamp);
 						send(std::shared_ptr<PacketBase>(ping));
 
-						for (auto const& pair : World::History::getChanges(Engine::getScene().getUUID(), lastUpdate, timestamp))
-							send(new PacketUpdateComponent(pair.first, pair.second));
+						// Lowered to the simulation's newest published tick, so changes logged after it go out next time
+						auto changes = World::Simulation::getChanges(Engine::getScene().getUUID(), lastUpdate, timestamp);
+
+						if (!changes.empty())
+						{
+							for (auto const& batch : PacketUpdateBatch::create(timestamp, changes, getPayloadSize()))
+								send(batch);
+						}
 
 						missingPacketsLock.lock();
 						if (!missingPackets.empty())
 							send(new PacketNACK(missingPackets));
 						missingPacketsLock.unlock();
 
+						probeMTU();
+						adaptParity();
+
 						lastUpdate = timestamp;
 					}
-				}, Util::Clock::getMainThreadId());
+					else
+						retryHandshake();
+				});
 
 				return true;
 			}
@@ -117,9 +160,12 @@ namespace TechDemo
 		{
 			if (InetConnection::disconnect())
 			{
-				Util::Clock::removeClock(rttClock);
+				Util::TimingWheel::remove(rttClock);
 				rttClock = 0;
 				rtt = 0;
+				recordedRTT = 0;
+				timeOffset = 0L;
+				clockSampled = false;
 
 				return true;
 			}
@@ -134,111 +180,109 @@ namespace TechDemo
 
 		bool PlayerConnection::send(std::shared_ptr<PacketBase> const& packet) const
 		{
+			return send(packet, getPayloadSize());
+		}
+
+		bool PlayerConnection::send(std::shared_ptr<PacketBase> const& packet, unsigned short fragmentSize) const
+		{
+			auto requested = std::chrono::steady_clock::now();
+
 			if (!local)
 			{
 				if (packet && connected && socket)
 				{
-					std::lock_guard lock(sendLock);
-
-					if (connected)
-					{
-						IO::BitStream str, buff;
+					IO::BitStream str;
 
-						str.write(packet->getId());
-						packet->serialize(str);
+					PacketDispatcher::writeId(str, packet->getId());
+					packet->serialize(str);
 
-						auto& data = str.data();
-						uint32_t sequenceNumber = nextSequenceNumber++;
-						buff.write(sequenceNumber);
-						buff.write(static_cast<uint16_t>(str.size()), 16);
-
-						for (size_t remaining = data.size(), size = std::min(remaining, static_cast<size_t>(BUFFER_SIZE) - buff.data().size()), offset = 0; remaining > 0; remaining -= size, offset += size, size = std::min(remaining, static_cast<size_t>(BUFFER_SIZE) - buff.data().size()))
-						{
-							std::string b = str.data(offset, size);
-							buff.write(b.data(), static_cast<unsigned>(std::min(b.size() * Util::byteSize(), str.size() - (offset * Util::byteSize()))));
-
-							std::string buffer(buff.data().data(), buff.data().size());
-
-							if (packet->shouldRetransmit())
-							{
-								sentPacketLock.lock();
-								sentPackets.insert(std::make_pair(sequenceNumber, buffer));
-								sentPacketLock.unlock();
-							}
-							else
-							{
-								IO::BitStream bs;
-								bs.write(sequenceNumber);	// Sequence Number
-								if (offset == 0)
-									bs.write(0, 16);		// Size
-
-								sentPacketLock.lock();
-								sentPackets.insert(std::make_pair(sequenceNumber, std::string(bs.data().data(), bs.data().size())));
-								sentPacketLock.unlock();
-							}
-
-							sockaddr_storage addr = { 0 };
-
-							sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
-							inAddr.sin_family = AF_INET;
-							inAddr.sin_port = htons(port);
-							inet_pton(AF_INET, ipAddress.data(), &inAddr.sin_addr);
-
-							// TODO: Replace with priority order controlled buffer
-							if (::sendto(socket, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR)
-							{
-								std::cerr << "An error occurred while sending a packet to " << ipAddress << ":" << port << ": " << getLastError().second;
-								return false;
-							}
-
-							Engine::server->bytesSent += buffer.size();
-							++Engine::server->packetsSent;
-							buff.clear();
-
-							if (remaining - size > 0)
-								buff.write(sequenceNumber = nextSequenceNumber++);
-						}
-
-						return true;
-					}
+					return send(std::make_shared<const std::string>(str.data().data(), str.data().size()), str.size(), packet->shouldRetransmit(), fragmentSize, requested);
 				}
 
 				return false;
 			}
 			
-			return InetConnection::send(packet);
+			return InetConnection::send(packet, fragmentSize);
 		}
 
-		bool PlayerConnection::send(const char* data, unsigned short length) const
+		bool PlayerConnection::send(std::shared_ptr<const std::string> const& payload, size_t bits, bool reliable, unsigned short fragmentSize, std::chrono::steady_clock::time_point requested) const
 		{
-			if (data && length && connected && socket)
+			if (payload && connected && socket)
 			{
 				std::lock_guard lock(sendLock);
+
 				if (connected)
 				{
-					if (!local)
+					for (size_t offset = 0, size = 0; offset < payload->size(); offset += size)
 					{
-						sockaddr_storage addr = { 0 };
+						uint32_t sequenceNumber = nextSequenceNumber++;
+
+						IO::BitStream header;
+						header.write(sequenceNumber);
+						if (offset == 0)
+							header.write(static_cast<uint16_t>(bits), 16);
 
-						sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
-						inAddr.sin_family = AF_INET;
-						inAddr.sin_port = htons(port);
-						inet_pton(AF_INET, ipAddress.data(), &inAddr.sin_addr);
+						auto& head = header.data();
+						size = std::min(payload->size() - offset, static_cast<size_t>(fragmentSize) - head.size());
+
+						if (reliable)
+						{
+							sentPacketLock.lock();
+							sentPackets.insert(std::make_pair(sequenceNumber, std::string(head.data(), head.size()).append(*payload, offset, size)));
+							sentPacketLock.unlock();
+						}
+						else
+						{
+							IO::BitStream bs;
+							bs.write(sequenceNumber);	// Sequence Number
+							if (offset == 0)
+								bs.write(0, 16);		// Size
+
+							sentPacketLock.lock();
+							sentPackets.insert(std::make_pair(sequenceNumber, std::string(bs.data().data(), bs.data().size())));
+							sentPacketLock.unlock();
+						}
 
-						if (::sendto(socket, data, length, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR)
+						// TODO: Replace with priority order controlled buffer
+						if (transmit(head.data(), static_cast<unsigned>(head.size()), payload->data() + offset, static_cast<unsigned>(size)) == SOCKET_ERROR)
 						{
 							std::cerr << "An error occurred while sending a packet to " << ipAddress << ":" << port << ": " << getLastError().second;
 							return false;
 						}
+
+						Engine::server->bytesSent += head.size() + size;
+						++Engine::server->packetsSent;
+						metrics.recordDatagramSent(head.size() + size);
+
+						protect(sequenceNumber, head.data(), static_cast<unsigned>(head.size()), payload->data() + offset, static_cast<unsigned>(size));
 					}
-					else if (::send(socket, data, length, 0) == SOCKET_ERROR)
+
+					metrics.recordSent(reliable ? Channel::Reliable : Channel::Unreliable, payload->size());
+					metrics.getQueueDelay().record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - requested).count());
+
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool PlayerConnection::send(const char* data, unsigned short length) const
+		{
+			if (data && length && connected && socket)
+			{
+				std::lock_guard lock(sendLock);
+				if (connected)
+				{
+					if (transmit(data, length) == SOCKET_ERROR)
 					{
-						std::cerr << "An error occurred while sending a packet: " << getLastError().second;
+						std::cerr << "An error occurred while sending a packet to " << ipAddress << ":" << port << ": " << getLastError().second;
 						return false;
 					}
 
 					(local ? bytesSent : Engine::server->bytesSent) += length;
 					local ? ++packetsResent : ++Engine::server->packetsResent;
+					metrics.recordResent(length);
 
 					return true;
 				}
@@ -247,11 +291,152 @@ namespace TechDemo
 			return false;
 		}
 
+		int PlayerConnection::transmit(const char* data, unsigned length) const
+		{
+			if (local)
+				return InetConnection::transmit(data, length);
+
+			sockaddr_storage addr = { 0 };
+
+			sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
+			inAddr.sin_family = AF_INET;
+			inAddr.sin_port = htons(port);
+			inet_pton(AF_INET, ipAddress.data(), &inAddr.sin_addr);
+
+			// Server-side connections share the server's emulated link unless given one of their own
+			std::shared_ptr<LinkEmulator> emulator = linkEmulator ? linkEmulator : Engine::server->linkEmulator;
+
+			if (emulator)
+				return emulator->transmit(Direction::Clientbound, socket, data, length, &addr);
+
+			if (std::shared_ptr<RegisteredIO> rio = Engine::server->registeredIO)
+				return rio->send(data, length, &addr);
+
+			return ::sendto(socket, data, static_cast<int>(length), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		}
+
+		int PlayerConnection::transmit(const char* header, unsigned headerLength, const char* data, unsigned length) const
+		{
+			if (local)
+				return InetConnection::transmit(header, headerLength, data, length);
+
+			// The link emulator and Registered I/O copy datagrams into buffers of their own regardless
+			if (linkEmulator || Engine::server->linkEmulator || Engine::server->registeredIO)
+			{
+				char datagram[MAX_FRAGMENT_SIZE];
+				std::memcpy(datagram, header, headerLength);
+				std::memcpy(datagram + headerLength, data, length);
+
+				return transmit(datagram, headerLength + length);
+			}
+
+			sockaddr_storage addr = { 0 };
+
+			sockaddr_in& inAddr = *reinterpret_cast<sockaddr_in*>(&addr);
+			inAddr.sin_family = AF_INET;
+			inAddr.sin_port = htons(port);
+			inet_pton(AF_INET, ipAddress.data(), &inAddr.sin_addr);
+
+			WSABUF buffers[2] = { { headerLength, const_cast<char*>(header) }, { length, const_cast<char*>(data) } };
+			DWORD sent = 0;
+
+			if (WSASendTo(socket, buffers, 2, &sent, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr), nullptr, nullptr) == SOCKET_ERROR)
+				return SOCKET_ERROR;
+
+			return static_cast<int>(sent);
+		}
+
+		unsigned long long PlayerConnection::getAckedSnapshot() const
+		{
+			return ackedSnapshot;
+		}
+
+		void PlayerConnection::setUpdateBudget(unsigned bytes)
+		{
+			updateBudget = bytes;
+		}
+
+		unsigned PlayerConnection::getUpdateBudget() const
+		{
+			return updateBudget;
+		}
+
+		void PlayerConnection::sendInput(unsigned long long timestamp, BitStream const& input)
+		{
+			sentInputs.emplace_back(timestamp, BitStream(input));
+
+			if (sentInputs.size() > INPUT_REDUNDANCY)
+				sentInputs.pop_front();
+
+			// Each packet repeats the inputs before it, so it is neither resent nor held back behind a lost datagram
+			sendUnsequenced(std::shared_ptr<PacketBase>(new PacketInput(sentInputs)));
+		}
+
+		bool PlayerConnection::popInput(unsigned long long& timestamp, BitStream& input)
+		{
+			PacketInput::inputType next;
+
+			if (!receivedInputs.pop(next))
+				return false;
+
+			timestamp = next.first;
+			input = std::move(next.second);
+
+			return true;
+		}
+
+		void PlayerConnection::receiveInputs(std::vector<PacketInput::inputType> const& inputs)
+		{
+			// Oldest first, skipping those an earlier packet already carried
+			for (auto iter = inputs.rbegin(); iter != inputs.rend(); ++iter)
+			{
+				if (iter->first <= lastInput)
+					continue;
+
+				if (!receivedInputs.push(std::make_pair(iter->first, BitStream(iter->second))))
+					break;	// The simulation has fallen behind, so the rest arrive again with the next packet
+
+				lastInput = iter->first;
+			}
+		}
+
+		void PlayerConnection::acknowledgeSnapshot(unsigned long long timestamp)
+		{
+			advanceSnapshot(priorities.acknowledge(timestamp));
+		}
+
+		void PlayerConnection::advanceSnapshot(unsigned long long timestamp)
+		{
+			unsigned long long baseline = ackedSnapshot;
+			while (timestamp > baseline && !ackedSnapshot.compare_exchange_weak(baseline, timestamp));
+		}
+
+		void PlayerConnection::recordRTT()
+		{
+			// Each reply measures a round trip to the nanosecond, so a repeated value is the same sample seen again
+			int sample = rtt;
+
+			if (sample && sample != recordedRTT)
+			{
+				recordedRTT = sample;
+				metrics.getRTT().record(sample);
+			}
+		}
+
 		int PlayerConnection::getRTT() const
 		{
 			return rtt;
 		}
 
+		void PlayerConnection::sampleServerClock(unsigned long long timestamp)
+		{
+			// The snapshot left the server about half a round trip ago
+			long long sample = static_cast<long long>(timestamp) + rtt / 2 / 1000000 - static_cast<long long>(Engine::getTimestamp());
+			long long offset = timeOffset;
+
+			timeOffset = static_cast<long>(clockSampled.exchange(true) ? offset + (sample - offset) / CLOCK_OFFSET_SMOOTHING : sample);
+		}
+
 		const std::vector<float>& PlayerConnection::getRTTHistory() const
 		{
 			return rttHistory;
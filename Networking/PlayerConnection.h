@@ -1,6 +1,13 @@
 #pragma once
 
+#include <deque>
+
 #include "InetConnection.h"
+#include "PacketInput.h"
+#include "PriorityAccumulator.h"
+#include "SPSCQueue.h"
+
+#define CLOCK_OFFSET_SMOOTHING 8	// Snapshots the server clock offset estimate is averaged over
 
 namespace TechDemo
 {
@@ -8,12 +15,16 @@ namespace TechDemo
 	{
 		class NetworkManager;	// Forward declaration
 		class PacketPing;		// Forward declaration
+		class PacketSnapshotAck;	// Forward declaration
 
 		class PlayerConnection : public InetConnection
 		{
 			friend class InetConnection;
+			friend class InterestManager;
 			friend class NetworkManager;
+			friend class PacketInput;
 			friend class PacketPing;
+			friend class PacketSnapshotAck;
 			friend class ServerConnection;
 
 			public:
@@ -38,13 +49,59 @@ namespace TechDemo
 
 				const std::vector<float>& getRTTHistory() const;
 
+				// Client side. Refines the estimate of the server's clock (see getTimeOffset) from a snapshot's timestamp.
+				void sampleServerClock(unsigned long long timestamp);
+
+				// Oldest timestamp the client may not have every change after
+				unsigned long long getAckedSnapshot() const;
+
+				// Bytes of snapshot records sent to the client each tick, the least important changes being deferred
+				void setUpdateBudget(unsigned bytes);
+
+				unsigned getUpdateBudget() const;
+
+				// Client side. Sends the input along with the last few, so the server is not held up by a lost one.
+				void sendInput(unsigned long long timestamp, BitStream const& input);
+
+				// Server side. Takes the oldest input not yet simulated, returning false if there is none.
+				bool popInput(unsigned long long& timestamp, BitStream& input);
+
+			protected:
+				virtual bool send(std::shared_ptr<PacketBase> const& packet, unsigned short fragmentSize) const;
+
+				virtual int transmit(const char* data, unsigned length) const;
+
+				virtual int transmit(const char* header, unsigned headerLength, const char* data, unsigned length) const;
+
+				// Fragments an already serialized packet, sending each fragment as this connection's header followed by a slice of the payload
+				bool send(std::shared_ptr<const std::string> const& payload, size_t bits, bool reliable, unsigned short fragmentSize, std::chrono::steady_clock::time_point requested) const;
+
+				// Called every connection tick, recording the round trip into the metrics once the ping handler has measured a new one
+				void recordRTT();
+
 			private:
 				PlayerConnection(std::string const& ipAddress, unsigned short port, unsigned socket);
 
+				void acknowledgeSnapshot(unsigned long long timestamp);
+
+				void advanceSnapshot(unsigned long long timestamp);
+
+				void receiveInputs(std::vector<PacketInput::inputType> const& inputs);
+
 				std::atomic_int rtt = 0;
-				long rttClock = 0;
+				int recordedRTT = 0;		// Last round trip recorded into the metrics (only touched by the connection tick)
+				std::atomic_bool clockSampled = false;
+				uint64_t rttClock = 0ULL;	// Per-connection tick
 				std::vector<float> rttHistory = std::vector<float>(150);
 				std::atomic_ullong lastUpdate = 0ULL;
+				std::atomic_ullong ackedSnapshot = 0ULL;	// Baseline for the next snapshot delta
+				std::atomic_uint updateBudget = PRIORITY_BUDGET;
+				PriorityAccumulator priorities;
+
+				// Input Redundancy
+				std::deque<PacketInput::inputType> sentInputs;									// Last inputs sent, oldest first
+				unsigned long long lastInput = 0ULL;											// Newest input received (only touched by handlers)
+				Util::SPSCQueue<PacketInput::inputType, INPUT_QUEUE_SIZE> receivedInputs;	// Inputs waiting to be simulated
 		};
 	}
 }
\ No newline at end of file
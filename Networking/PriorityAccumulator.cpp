@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Component.h"
+#include "PriorityAccumulator.h"
+#include "RTTI.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		PacketSnapshot::changeType PriorityAccumulator::select(unsigned long long timestamp, unsigned long long baseline, PacketSnapshot::changeType& changes, std::unordered_map<Util::UUID, float> const& distances, size_t budget)
+		{
+			std::lock_guard guard(lock);
+			std::vector<std::pair<float, Util::UUID>> candidates;
+
+			for (auto iter = changes.begin(); iter != changes.end();)
+			{
+				Component& component = components[iter->first];
+				unsigned long long since = std::max(component.baseline, baseline);
+
+				// Components sent in a newer snapshot than the connection's baseline only need what changed after it
+				for (auto variable = iter->second.begin(); variable != iter->second.end();)
+					variable = variable->second.first > since ? std::next(variable) : iter->second.erase(variable);
+
+				if (iter->second.empty())
+				{
+					iter = changes.erase(iter);
+					continue;
+				}
+
+				auto distance = distances.find(iter->first);
+				float proximity = distance != distances.end() ? 1.0f / (1.0f + distance->second / PRIORITY_DISTANCE_SCALE) : 1.0f;
+
+				component.priority += proximity * (1.0f + measure(iter->first, component, iter->second));
+				candidates.emplace_back(component.priority, iter->first);
+
+				++iter;
+			}
+
+			std::sort(candidates.begin(), candidates.end(), [](auto const& lhs, auto const& rhs) { return lhs.first > rhs.first; });
+
+			PacketSnapshot::changeType selected;
+			Pending& sent = pending[timestamp];
+			sent.baseline = timestamp;
+
+			size_t used = 0;
+			for (auto const& candidate : candidates)
+			{
+				auto iter = changes.find(candidate.second);
+				Component& component = components[candidate.second];
+				size_t size = PacketSnapshot::measure(*iter);
+
+				// The most important component is always sent, however large it is
+				if (!selected.empty() && used + size > budget)
+				{
+					sent.baseline = std::min(sent.baseline, std::max(component.baseline, baseline));
+					continue;
+				}
+
+				used += size;
+				component.priority = 0.0f;
+
+				for (auto const& variable : iter->second)
+					component.sent.insert_or_assign(variable.first, BitStream(variable.second.second));
+
+				sent.components.push_back(iter->first);
+				selected.emplace(iter->first, std::move(iter->second));
+				changes.erase(iter);
+			}
+
+			if (selected.empty())
+				pending.erase(timestamp);
+
+			// A client that stops acknowledging only loses the ability to confirm its oldest snapshots
+			while (pending.size() > PRIORITY_PENDING_LIMIT)
+				pending.erase(pending.begin());
+
+			if (++ticks % PRIORITY_PRUNE_TICKS == 0)
+			{
+				for (auto iter = components.begin(); iter != components.end();)
+					iter = World::ComponentBase::getComponent(iter->first) ? std::next(iter) : components.erase(iter);
+			}
+
+			return selected;
+		}
+
+		unsigned long long PriorityAccumulator::acknowledge(unsigned long long timestamp)
+		{
+			std::lock_guard guard(lock);
+
+			auto iter = pending.find(timestamp);
+			if (iter == pending.end())
+				return 0ULL;
+
+			for (auto const& componentId : iter->second.components)
+			{
+				// Pruned once destroyed
+				auto component = components.find(componentId);
+				if (component != components.end())
+					component->second.baseline = std::max(component->second.baseline, timestamp);
+			}
+
+			unsigned long long baseline = iter->second.baseline;
+
+			// Anything lost from an older snapshot was either sent again in this one or deferred behind its baseline
+			pending.erase(pending.begin(), std::next(iter));
+
+			return baseline;
+		}
+
+		float PriorityAccumulator::measure(Util::UUID const& componentId, Component const& component, std::unordered_map<uint16_t, std::pair<unsigned long long, BitStream>> const& variables) const
+		{
+			std::shared_ptr<World::ComponentBase> instance = World::ComponentBase::getComponent(componentId);
+			Util::RTTI::Type const* type = instance ? Util::RTTI::getType(instance->getTypeHash()) : nullptr;
+
+			float change = 0.0f;
+
+			for (auto const& variable : variables)
+			{
+				auto sent = component.sent.find(variable.first);
+				auto difference = type ? std::get<6>(type->getVariable(variable.first)) : nullptr;
+
+				// Without a difference function, or anything sent to compare against, every change counts the same
+				if (!difference || sent == component.sent.end() || sent->second.size() != variable.second.second.size())
+				{
+					change += 1.0f;
+					continue;
+				}
+
+				BitStream delta;
+				difference(sent->second.data().data(), variable.second.second.data().data(), delta);
+
+				// Deltas made up of floats (positions, rotations, velocities) are measured by their length
+				if (delta.size() && delta.size() % Util::bitSize<float>() == 0)
+				{
+					float length = 0.0f;
+
+					while (delta.remaining())
+					{
+						float value = 0.0f;
+						delta.read(value);
+						length += value * value;
+					}
+
+					change += std::sqrt(length);
+				}
+				else if (delta.size())
+					change += 1.0f;
+			}
+
+			return change;
+		}
+	}
+}
\ No newline at end of file
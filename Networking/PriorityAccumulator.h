@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "PacketSnapshot.h"
+#include "UUID.h"
+
+#define PRIORITY_BUDGET 4096			// Bytes of snapshot records sent to each client per tick
+#define PRIORITY_DISTANCE_SCALE 8.0f	// Distance at which a component accumulates priority at half the rate
+#define PRIORITY_PENDING_LIMIT 128		// Unacknowledged snapshots remembered, the oldest forgotten first (over 3 s of ticks)
+#define PRIORITY_PRUNE_TICKS 40			// Ticks between dropping the state of destroyed components
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Decides which changed components a client is sent each tick. Every component waiting to be sent gains priority
+		// each tick from how close it is to the viewer and how much it has changed, and the highest are sent until the
+		// byte budget is used up. The rest keep their priority, so they are eventually sent however far away they are.
+		class PriorityAccumulator
+		{
+			public:
+				// Removes the components which do not need to be sent from changes, and returns the ones to be sent this tick.
+				// Anything deferred is left in changes.
+				PacketSnapshot::changeType select(unsigned long long timestamp, unsigned long long baseline, PacketSnapshot::changeType& changes, std::unordered_map<Util::UUID, float> const& distances, size_t budget);
+
+				// Marks the components sent in a snapshot as received. Returns the oldest baseline still needed, or 0 if the snapshot is unknown.
+				unsigned long long acknowledge(unsigned long long timestamp);
+
+			private:
+				struct Component
+				{
+					float priority = 0.0f;
+					unsigned long long baseline = 0ULL;					// Newest snapshot the client acknowledged this component in
+					std::unordered_map<uint16_t, BitStream> sent;	// Values last sent, to measure the change against
+				};
+
+				struct Pending
+				{
+					std::vector<Util::UUID> components;
+					unsigned long long baseline = 0ULL;	// Oldest baseline of a deferred component
+				};
+
+				// How far a component has moved since it was last sent, using each variable's difference function
+				float measure(Util::UUID const& componentId, Component const& component, std::unordered_map<uint16_t, std::pair<unsigned long long, BitStream>> const& variables) const;
+
+				std::unordered_map<Util::UUID, Component> components;
+				std::map<unsigned long long, Pending> pending;	// Snapshots waiting to be acknowledged
+				unsigned long ticks = 0UL;
+				std::mutex lock;
+		};
+	}
+}
\ No newline at end of file
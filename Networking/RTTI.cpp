@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <deque>
 
 #include "RTTI.h"
@@ -308,6 +309,61 @@ namespace TechDemo
 			return result;
 		}
 
+		uint16_t RTTI::Type::getVariableCount() const
+		{
+			const Leaves* leaves = getLeaves(hash);
+			return leaves ? static_cast<uint16_t>(leaves->leaves.size()) : 0U;
+		}
+
+		uint16_t RTTI::Type::getVariableId(const std::string& variable) const
+		{
+			if (const Leaves* leaves = getLeaves(hash))
+			{
+				auto iter = leaves->ids.find(variable);
+				if (iter != leaves->ids.end())
+					return iter->second;
+			}
+
+			return INVALID_VARIABLE;
+		}
+
+		const std::string& RTTI::Type::getVariableName(uint16_t id) const
+		{
+			static const std::string unknown;
+
+			const Leaves* leaves = getLeaves(hash);
+			return leaves && id < leaves->leaves.size() ? leaves->leaves[id].name : unknown;
+		}
+
+		std::tuple<bool, int32_t, const RTTI::Type*, bool, bool(*)(IO::BitStream const&, IO::BitStream const&), void (*)(const char*, const char*, float, char*), void (*)(const char*, const char*, IO::BitStream&), void (*)(IO::BitStream const&, IO::BitStream const&, char*), void(*)(char*), void(*)(char*)> RTTI::Type::getVariable(uint16_t id) const
+		{
+			const Leaves* leaves = getLeaves(hash);
+			if (!leaves || id >= leaves->leaves.size())
+				return std::make_tuple(false, 0, nullptr, false, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+
+			return leaves->leaves[id].variable;
+		}
+
+		std::tuple<bool, char*, const RTTI::Type*, bool, bool(*)(IO::BitStream const&, IO::BitStream const&), void (*)(const char*, const char*, float, char*), void (*)(const char*, const char*, IO::BitStream&), void (*)(IO::BitStream const&, IO::BitStream const&, char*), void(*)(char*), void(*)(char*)> RTTI::Type::getVariable(char* data, uint16_t id) const
+		{
+			const Leaves* leaves = getLeaves(hash);
+			if (!leaves || id >= leaves->leaves.size() || !data || leaves->leaves[id].path.empty())
+				return std::make_tuple(false, nullptr, nullptr, false, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+
+			const Leaf& leaf = leaves->leaves[id];
+
+			for (size_t i = 0; i + 1 < leaf.path.size(); ++i)
+			{
+				data = !leaf.path[i].second ? data + leaf.path[i].first : *reinterpret_cast<char**>(data + leaf.path[i].first);
+
+				if (!data)
+					return std::make_tuple(false, nullptr, nullptr, false, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+			}
+
+			auto const& v = leaf.variable;
+			return std::make_tuple(true, data + leaf.path.back().first, std::get<2>(v), std::get<3>(v), std::get<4>(v), std::get<5>(v), std::get<6>(v), std::get<7>(v), std::get<8>(v), std::get<9>(v));
+		}
+
 		const RTTI::Type* RTTI::getType(uint32_t typeHash)
 		{
 			auto& types = getTypes();
@@ -320,5 +376,72 @@ namespace TechDemo
 			static std::unordered_map<uint32_t, Type> types;
 			return types;
 		}
+
+		const RTTI::Leaves* RTTI::getLeaves(uint32_t typeHash)
+		{
+			// Nested types may be registered from other translation units, so the ids are numbered once every type is known
+			static std::unordered_map<uint32_t, Leaves> const leaves = []()
+			{
+				std::unordered_map<uint32_t, Leaves> result;
+
+				for (auto const& type : getTypes())
+				{
+					std::unordered_set<std::string> names = type.second.getVariableNames(true);
+
+					Leaves& entry = result[type.first];
+					entry.leaves.reserve(names.size());
+
+					for (auto const& name : names)
+						entry.leaves.push_back(Leaf{ name });
+
+					std::sort(entry.leaves.begin(), entry.leaves.end(), [](Leaf const& lhs, Leaf const& rhs) { return lhs.name < rhs.name; });
+
+					if (entry.leaves.size() >= INVALID_VARIABLE)
+						entry.leaves.resize(INVALID_VARIABLE);
+
+					for (size_t id = 0; id < entry.leaves.size(); ++id)
+					{
+						Leaf& leaf = entry.leaves[id];
+						entry.ids.emplace(leaf.name, static_cast<uint16_t>(id));
+
+						// Resolve the path one variable at a time, as getVariable(data, name) does
+						const Type* current = &type.second;
+						int32_t offset = 0;
+						bool direct = true;	// No pointer is followed on the way to the leaf
+						size_t begin = 0;
+
+						while (current && begin <= leaf.name.size())
+						{
+							size_t end = std::min(leaf.name.find('.', begin), leaf.name.size());
+							leaf.variable = current->getVariable(leaf.name.substr(begin, end - begin));
+
+							if (!std::get<0>(leaf.variable))
+								break;
+
+							leaf.path.emplace_back(std::get<1>(leaf.variable), std::get<3>(leaf.variable));
+							offset += std::get<1>(leaf.variable);
+							current = std::get<2>(leaf.variable);
+							begin = end + 1;
+
+							if (begin <= leaf.name.size())
+								direct = direct && !std::get<3>(leaf.variable);
+						}
+
+						if (begin <= leaf.name.size())
+						{
+							leaf.path.clear();
+							leaf.variable = std::make_tuple(false, 0, nullptr, false, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+						}
+						else if (direct)
+							std::get<1>(leaf.variable) = offset;
+					}
+				}
+
+				return result;
+			}();
+
+			auto iter = leaves.find(typeHash);
+			return iter != leaves.end() ? &iter->second : nullptr;
+		}
 	}
 }
\ No newline at end of file
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <new>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "BitStream.h"
 #include "Hash.h"
 #include "Util.h"
 
+#define INVALID_VARIABLE 0xFFFF	// Variable id of names a type doesn't have
 #define TOSTRING(str) #str
 #define PREPARE_TYPE(type) friend struct TechDemo::Util::Registrant<type>;\
 static TechDemo::Util::Registrant<type> _registrant
@@ -60,6 +63,9 @@ namespace TechDemo
 					size_t size = 0;	// Size of type in bits
 					bool isSerializable = false;	// Inherits from Serializable class
 					char* (*creator)() = nullptr;	// Creator function
+					char* (*placer)(char*) = nullptr;	// Default constructs the type in the given memory
+					void (*destroyer)(char*) = nullptr;	// Destroys an instance constructed by placer, without freeing its memory
+					size_t alignment = 0;	// Alignment of type in bytes (0 if unknown)
 					std::unordered_map<uint32_t, int32_t> bases;	// Base type hash -> offset
 					std::unordered_map<std::string, std::tuple<uint32_t, int32_t, bool, bool (*)(IO::BitStream const&, IO::BitStream const&), void (*)(const char*, const char*, float, char*), void (*)(const char*, const char*, IO::BitStream&), void (*)(IO::BitStream const&, IO::BitStream const&, char*), void (*)(char*), void (*)(char*)>> variables;	// Var name -> (Var type hash, offset, is pointer, comparator function, interpolator function, difference function, accumulate function, pre-modify callback, post-modify callback)
 
@@ -86,12 +92,44 @@ namespace TechDemo
 					std::unordered_set<std::string> getVariableNames(bool onlyLeaves = false) const;
 
 					std::unordered_set<std::string> getVariableNames(char* data, bool onlyLeaves = false) const;
+
+					// Leaf variables (as given by getVariableNames(true)) are numbered densely in name order, so that builds
+					// registering the same types agree. Only valid once static initialization (and so registration) has finished.
+					uint16_t getVariableCount() const;
+
+					// Returns INVALID_VARIABLE for unknown variables
+					uint16_t getVariableId(const std::string& variable) const;
+
+					// Names are only kept for debugging. Returns an empty string for unknown ids.
+					const std::string& getVariableName(uint16_t id) const;
+
+					// As with a leaf's name, but without splitting the name or hashing its parts. The offset is only meaningful
+					// for leaves which are not reached through a pointer.
+					std::tuple<bool, int32_t, const Type*, bool, bool(*)(IO::BitStream const&, IO::BitStream const&), void (*)(const char*, const char*, float, char*), void (*)(const char*, const char*, IO::BitStream&), void (*)(IO::BitStream const&, IO::BitStream const&, char*), void(*)(char*), void(*)(char*)> getVariable(uint16_t id) const;
+
+					std::tuple<bool, char*, const Type*, bool, bool(*)(IO::BitStream const&, IO::BitStream const&), void (*)(const char*, const char*, float, char*), void (*)(const char*, const char*, IO::BitStream&), void (*)(IO::BitStream const&, IO::BitStream const&, char*), void(*)(char*), void(*)(char*)> getVariable(char* data, uint16_t id) const;
 				};
 
 				static const Type* getType(uint32_t typeHash);
 
 			private:
 				static std::unordered_map<uint32_t, Type>& getTypes();
+
+				struct Leaf
+				{
+					std::string name;
+					std::vector<std::pair<int32_t, bool>> path;	// Offset of each variable on the way to the leaf, and whether it is a pointer
+					std::tuple<bool, int32_t, const Type*, bool, bool(*)(IO::BitStream const&, IO::BitStream const&), void (*)(const char*, const char*, float, char*), void (*)(const char*, const char*, IO::BitStream&), void (*)(IO::BitStream const&, IO::BitStream const&, char*), void(*)(char*), void(*)(char*)> variable;
+				};
+
+				struct Leaves
+				{
+					std::vector<Leaf> leaves;	// By id
+					std::unordered_map<std::string, uint16_t> ids;
+				};
+
+				// Leaf variables of a registered type, or nullptr if the type is unknown
+				static Leaves const* getLeaves(uint32_t typeHash);
 		};
 
 		template <typename T>
@@ -119,7 +157,7 @@ namespace TechDemo
 				if constexpr (std::is_trivially_default_constructible_v<B>)
 					creator = []() -> char* { return reinterpret_cast<char*>(new B()); };
 
-				RTTI::getTypes().try_emplace(base, RTTI::Type{ base, bitSize<B>(), std::is_base_of_v<Serializable, B>, creator });
+				RTTI::getTypes().try_emplace(base, RTTI::Type{ base, bitSize<B>(), std::is_base_of_v<Serializable, B>, creator, getPlacer<B>(), getDestroyer<B>(), alignof(B) });
 				RTTI::getTypes()[key].bases.try_emplace(base, static_cast<int32_t>(reinterpret_cast<intptr_t>(dynamic_cast<B*>(reinterpret_cast<T*>(0)))));
 			}
 
@@ -205,7 +243,32 @@ namespace TechDemo
 				char* (*creator)() = nullptr;
 				if constexpr (std::is_trivially_default_constructible_v<R>)
 					creator = []() -> char* { return reinterpret_cast<char*>(new R()); };
-				RTTI::getTypes().try_emplace(key, RTTI::Type{ key, bitSize<R>(), std::is_base_of_v<Serializable, R>, creator });
+				RTTI::getTypes().try_emplace(key, RTTI::Type{ key, bitSize<R>(), std::is_base_of_v<Serializable, R>, creator, getPlacer<R>(), getDestroyer<R>(), alignof(R) });
+			}
+
+			// Detected from within the registrant, so default constructors kept private with PREPARE_TYPE still count
+			template <typename R, typename = void>
+			struct IsPlaceable : std::false_type {};
+
+			template <typename R>
+			struct IsPlaceable<R, std::void_t<decltype(::new (static_cast<void*>(nullptr)) R())>> : std::true_type {};
+
+			template <typename R>
+			static char* (*getPlacer())(char*)
+			{
+				if constexpr (std::is_class_v<R> && !std::is_abstract_v<R> && IsPlaceable<R>::value)
+					return [](char* memory) -> char* { return reinterpret_cast<char*>(new (memory) R()); };
+				else
+					return nullptr;
+			}
+
+			template <typename R>
+			static void (*getDestroyer())(char*)
+			{
+				if constexpr (std::is_class_v<R> && std::is_destructible_v<R>)
+					return [](char* memory) { reinterpret_cast<R*>(memory)->~R(); };
+				else
+					return nullptr;
 			}
 		};
 	}
@@ -0,0 +1,266 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+
+#include "InetConnection.h"
+#include "RegisteredIO.h"
+
+#define RIO_DATA_SIZE ((RIO_RECEIVE_SLOTS + RIO_SEND_SLOTS) * MAX_FRAGMENT_SIZE)
+#define RIO_ADDRESS_SIZE ((RIO_RECEIVE_SLOTS + RIO_SEND_SLOTS) * sizeof(SOCKADDR_INET))
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		RegisteredIO::RegisteredIO() : rio(new RIO_EXTENSION_FUNCTION_TABLE())
+		{
+		}
+
+		RegisteredIO::~RegisteredIO()
+		{
+			if (receiveQueue)
+				rio->RIOCloseCompletionQueue(receiveQueue);
+
+			if (sendQueue)
+				rio->RIOCloseCompletionQueue(sendQueue);
+
+			if (dataBufferId)
+				rio->RIODeregisterBuffer(dataBufferId);
+
+			if (addressBufferId)
+				rio->RIODeregisterBuffer(addressBufferId);
+
+			if (dataBuffer)
+				VirtualFree(dataBuffer, 0, MEM_RELEASE);
+
+			if (addressBuffer)
+				VirtualFree(addressBuffer, 0, MEM_RELEASE);
+
+			if (event)
+				CloseHandle(event);
+		}
+
+		unsigned RegisteredIO::createSocket()
+		{
+			SOCKET socket = WSASocketW(AF_INET, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_REGISTERED_IO);
+			return socket == INVALID_SOCKET ? SOCKET_ERROR : static_cast<unsigned>(socket);
+		}
+
+		bool RegisteredIO::open(unsigned socket)
+		{
+			GUID functionTableId = WSAID_MULTIPLE_RIO;
+			DWORD bytes = 0;
+
+			rio->cbSize = sizeof(RIO_EXTENSION_FUNCTION_TABLE);
+			if (WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &functionTableId, sizeof(functionTableId), rio.get(), sizeof(RIO_EXTENSION_FUNCTION_TABLE), &bytes, nullptr, nullptr) == SOCKET_ERROR)
+			{
+				std::cerr << "An error occurred while loading the Registered I/O extensions: " << WSAGetLastError() << std::endl;
+				return false;
+			}
+
+			dataBuffer = static_cast<char*>(VirtualAlloc(nullptr, RIO_DATA_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+			addressBuffer = static_cast<char*>(VirtualAlloc(nullptr, RIO_ADDRESS_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+			if (!dataBuffer || !addressBuffer)
+			{
+				std::cerr << "An error occurred while allocating Registered I/O buffers: " << GetLastError() << std::endl;
+				return false;
+			}
+
+			if ((dataBufferId = rio->RIORegisterBuffer(dataBuffer, RIO_DATA_SIZE)) == RIO_INVALID_BUFFERID || (addressBufferId = rio->RIORegisterBuffer(addressBuffer, RIO_ADDRESS_SIZE)) == RIO_INVALID_BUFFERID)
+			{
+				std::cerr << "An error occurred while registering Registered I/O buffers: " << WSAGetLastError() << std::endl;
+				return false;
+			}
+
+			event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+			RIO_NOTIFICATION_COMPLETION notification = {};
+			notification.Type = RIO_EVENT_COMPLETION;
+			notification.Event.EventHandle = event;
+			notification.Event.NotifyReset = TRUE;
+
+			if ((receiveQueue = rio->RIOCreateCompletionQueue(RIO_RECEIVE_SLOTS, &notification)) == RIO_INVALID_CQ || (sendQueue = rio->RIOCreateCompletionQueue(RIO_SEND_SLOTS, nullptr)) == RIO_INVALID_CQ)
+			{
+				std::cerr << "An error occurred while creating Registered I/O completion queues: " << WSAGetLastError() << std::endl;
+				return false;
+			}
+
+			if ((requestQueue = rio->RIOCreateRequestQueue(socket, RIO_RECEIVE_SLOTS, 1, RIO_SEND_SLOTS, 1, receiveQueue, sendQueue, nullptr)) == RIO_INVALID_RQ)
+			{
+				std::cerr << "An error occurred while creating a Registered I/O request queue: " << WSAGetLastError() << std::endl;
+				return false;
+			}
+
+			std::lock_guard guard(lock);
+
+			freeSendSlots.reserve(RIO_SEND_SLOTS);
+			for (unsigned slot = RIO_RECEIVE_SLOTS + RIO_SEND_SLOTS; slot > RIO_RECEIVE_SLOTS; freeSendSlots.push_back(--slot));
+
+			for (unsigned slot = 0; slot < RIO_RECEIVE_SLOTS; ++slot)
+			{
+				if (!post(slot, RIO_MSG_DEFER))
+					return false;
+			}
+
+			rio->RIOReceiveEx(requestQueue, nullptr, 0, nullptr, nullptr, nullptr, nullptr, RIO_MSG_COMMIT_ONLY, nullptr);
+
+			return true;
+		}
+
+		int RegisteredIO::poll(std::function<void(sockaddr_storage&, char*, int)> const& receiver, unsigned long timeout)
+		{
+			RIORESULT results[RIO_BATCH];
+
+			ULONG count = rio->RIODequeueCompletion(receiveQueue, results, RIO_BATCH);
+
+			if (count == 0)
+			{
+				// Only arm the notification (a system call) once the queue has run dry
+				rio->RIONotify(receiveQueue);
+				WaitForSingleObject(event, timeout);
+				count = rio->RIODequeueCompletion(receiveQueue, results, RIO_BATCH);
+			}
+
+			if (count == RIO_CORRUPT_CQ)
+			{
+				std::cerr << "An error occurred while polling for available packets: The completion queue is corrupt." << std::endl;
+				return -1;
+			}
+
+			for (ULONG i = 0; i < count; ++i)
+			{
+				unsigned slot = static_cast<unsigned>(results[i].RequestContext);
+
+				if (results[i].Status == 0)
+				{
+					sockaddr_storage addr = {0};
+					std::memcpy(&addr, addressBuffer + slot * sizeof(SOCKADDR_INET), sizeof(SOCKADDR_INET));
+
+					receiver(addr, dataBuffer + slot * MAX_FRAGMENT_SIZE, static_cast<int>(results[i].BytesTransferred));
+				}
+
+				std::lock_guard guard(lock);
+				post(slot, RIO_MSG_DEFER);
+			}
+
+			if (count)
+			{
+				std::lock_guard guard(lock);
+				rio->RIOReceiveEx(requestQueue, nullptr, 0, nullptr, nullptr, nullptr, nullptr, RIO_MSG_COMMIT_ONLY, nullptr);
+			}
+
+			return static_cast<int>(count);
+		}
+
+		int RegisteredIO::send(const char* data, unsigned length, sockaddr_storage const* address)
+		{
+			if (!data || !length || length > MAX_FRAGMENT_SIZE)
+				return SOCKET_ERROR;
+
+			std::lock_guard guard(lock);
+
+			if (freeSendSlots.empty())
+				reclaim();
+
+			if (freeSendSlots.empty())
+			{
+				// Deferred sends hold their slots until submitted, so a batch larger than the slots is sent in parts
+				if (uncommitted)
+					commit();
+
+				// Sends complete as soon as the stack has copied them, so the slots free up again shortly
+				for (auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RIO_SEND_WAIT); freeSendSlots.empty() && std::chrono::steady_clock::now() < deadline; std::this_thread::yield())
+					reclaim();
+			}
+
+			if (freeSendSlots.empty())
+			{
+				WSASetLastError(WSAENOBUFS);
+				return SOCKET_ERROR;
+			}
+
+			unsigned slot = freeSendSlots.back();
+			freeSendSlots.pop_back();
+
+			std::memcpy(dataBuffer + slot * MAX_FRAGMENT_SIZE, data, length);
+
+			RIO_BUF buffer = {dataBufferId, slot * MAX_FRAGMENT_SIZE, length};
+			RIO_BUF remote = {addressBufferId, static_cast<ULONG>(slot * sizeof(SOCKADDR_INET)), sizeof(SOCKADDR_INET)};
+
+			if (address)
+				std::memcpy(addressBuffer + remote.Offset, address, sizeof(SOCKADDR_INET));
+
+			if (!rio->RIOSendEx(requestQueue, &buffer, 1, nullptr, address ? &remote : nullptr, nullptr, nullptr, batchDepth ? RIO_MSG_DEFER : 0, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(slot))))
+			{
+				freeSendSlots.push_back(slot);
+				return SOCKET_ERROR;
+			}
+
+			uncommitted = batchDepth > 0;
+
+			return static_cast<int>(length);
+		}
+
+		void RegisteredIO::beginBatch()
+		{
+			std::lock_guard guard(lock);
+			++batchDepth;
+		}
+
+		void RegisteredIO::endBatch()
+		{
+			std::lock_guard guard(lock);
+
+			if (batchDepth && --batchDepth == 0 && uncommitted)
+				commit();
+		}
+
+		bool RegisteredIO::isOpen() const
+		{
+			return requestQueue != nullptr;
+		}
+
+		bool RegisteredIO::post(unsigned slot, unsigned long flags)
+		{
+			RIO_BUF buffer = {dataBufferId, slot * MAX_FRAGMENT_SIZE, MAX_FRAGMENT_SIZE};
+			RIO_BUF remote = {addressBufferId, static_cast<ULONG>(slot * sizeof(SOCKADDR_INET)), sizeof(SOCKADDR_INET)};
+
+			if (!rio->RIOReceiveEx(requestQueue, &buffer, 1, nullptr, &remote, nullptr, nullptr, flags, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(slot))))
+			{
+				std::cerr << "An error occurred while posting a Registered I/O receive: " << WSAGetLastError() << std::endl;
+				return false;
+			}
+
+			return true;
+		}
+
+		void RegisteredIO::reclaim()
+		{
+			RIORESULT results[RIO_BATCH];
+			ULONG count = 0;
+
+			while ((count = rio->RIODequeueCompletion(sendQueue, results, RIO_BATCH)) && count != RIO_CORRUPT_CQ)
+			{
+				for (ULONG i = 0; i < count; ++i)
+					freeSendSlots.push_back(static_cast<unsigned>(results[i].RequestContext));
+			}
+		}
+
+		void RegisteredIO::commit()
+		{
+			rio->RIOSendEx(requestQueue, nullptr, 0, nullptr, nullptr, nullptr, nullptr, RIO_MSG_COMMIT_ONLY, nullptr);
+			uncommitted = false;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define RIO_RECEIVE_SLOTS 1024	// Receives kept posted against the socket
+#define RIO_SEND_SLOTS 1024		// Sends that may be in flight at once
+#define RIO_BATCH 64			// Completions dequeued per poll
+#define RIO_SEND_WAIT 10		// Milliseconds a send waits for an in flight send to free its slot before failing
+
+struct sockaddr_storage;				// Forward declaration
+struct _RIO_EXTENSION_FUNCTION_TABLE;	// Forward declaration
+struct RIO_BUFFERID_t;					// Forward declaration
+struct RIO_CQ_t;						// Forward declaration
+struct RIO_RQ_t;						// Forward declaration
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		enum class SocketBackend
+		{
+			Select,			// Readiness polling with one recv/send call per datagram
+			RegisteredIO	// Registered buffers and polled completion queues
+		};
+
+		// Winsock Registered I/O over a single UDP socket. Receives are pre-posted into a registered slab and reposted as
+		// they complete, and sends are copied into registered slots, so the steady state issues no system call per datagram.
+		class RegisteredIO
+		{
+			public:
+				RegisteredIO();
+
+				~RegisteredIO();
+
+				// Creates a UDP socket which may be used with Registered I/O.
+				static unsigned createSocket();
+
+				bool open(unsigned socket);
+
+				// Handles every completed receive, waiting up to timeout milliseconds if none are ready. Returns the number handled.
+				int poll(std::function<void(sockaddr_storage&, char*, int)> const& receiver, unsigned long timeout);
+
+				// Queues a datagram, using the socket's connected address if none is given.
+				int send(const char* data, unsigned length, sockaddr_storage const* address = nullptr);
+
+				// Sends queued between beginBatch and endBatch are submitted together, or in parts if they outnumber the slots.
+				void beginBatch();
+
+				void endBatch();
+
+				bool isOpen() const;
+
+			private:
+				bool post(unsigned slot, unsigned long flags);
+
+				void reclaim();
+
+				void commit();
+
+				std::unique_ptr<_RIO_EXTENSION_FUNCTION_TABLE> rio;
+				RIO_CQ_t* receiveQueue = nullptr;
+				RIO_CQ_t* sendQueue = nullptr;
+				RIO_RQ_t* requestQueue = nullptr;
+				RIO_BUFFERID_t* dataBufferId = nullptr;
+				RIO_BUFFERID_t* addressBufferId = nullptr;
+				char* dataBuffer = nullptr;		// Receive slots followed by send slots, MAX_FRAGMENT_SIZE bytes each
+				char* addressBuffer = nullptr;	// One SOCKADDR_INET per slot
+				void* event = nullptr;			// Signalled when receives complete while the queue is empty
+
+				std::vector<unsigned> freeSendSlots;
+				unsigned batchDepth = 0;
+				bool uncommitted = false;
+				std::mutex lock;				// Request queues may only be used by one thread at a time
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma comment (lib, "Ws2_32.lib")
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <winsock2.h>
+
+#include "DatagramCapture.h"
+#include "Engine.h"
+#include "PacketHandlerPool.h"
+#include "PlayerConnection.h"
+#include "ServerConnection.h"
+
+using namespace TechDemo;
+
+namespace
+{
+	struct Options
+	{
+		std::string capture;
+		unsigned workers = 0;	// Handler threads (0 handles each datagram's packets inline, for repeatable timings)
+	};
+
+	Options parse(int argc, char** argv)
+	{
+		Options options;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg(argv[i]);
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "--capture" && hasValue)
+				options.capture = argv[++i];
+			else if (arg == "--workers" && hasValue)
+				options.workers = static_cast<unsigned>(std::max(std::stoi(argv[++i]), 0));
+			else
+				std::cerr << "Ignoring unknown argument \"" << arg << "\"" << std::endl;
+		}
+
+		return options;
+	}
+}
+
+// Feeds a capture recorded with InetConnection::setCapture through the same reassembly and dispatch code, as fast as
+// possible and without any sockets, and reports the throughput.
+int main(int argc, char** argv)
+{
+	Options options = parse(argc, argv);
+
+	if (options.capture.empty())
+	{
+		std::cerr << "Usage: ReplayCapture --capture <file> [--workers <count>]" << std::endl;
+		return -1;
+	}
+
+	WSAData winSockData;
+	if (int result = WSAStartup(MAKEWORD(2, 2), &winSockData))
+	{
+		std::cerr << "An error occurred while starting Windows Sockets (" << result << ")" << std::endl;
+		return -1;
+	}
+
+	IO::DatagramCapture::Reader reader;
+	if (!reader.open(options.capture))
+		return -1;
+
+	// Read up front, so the timings only cover the receive path
+	std::vector<IO::DatagramCapture::Record> records;
+	unsigned long long bytes = 0ULL;
+
+	for (IO::DatagramCapture::Record record; reader.next(record);)
+	{
+		if (record.data.size() > MAX_FRAGMENT_SIZE)
+			continue;
+
+		bytes += record.data.size();
+		records.push_back(std::move(record));
+	}
+
+	if (records.empty())
+	{
+		std::cerr << "The capture holds no datagrams" << std::endl;
+		return -1;
+	}
+
+	IO::PacketHandlerPool::setWorkers(options.workers);
+
+	std::shared_ptr<IO::InetConnection> conn;
+
+	// The cookies in a server capture were signed with the capturing process's secret
+	if (reader.getRole() == IO::DatagramCapture::Role::Server)
+	{
+		std::shared_ptr<IO::ServerConnection> server = std::make_shared<IO::ServerConnection>();
+		server->setHandshakeCookies(false);
+		Engine::server = server;
+		conn = server;
+	}
+	else
+		conn = std::make_shared<IO::PlayerConnection>();
+
+	std::vector<char> buffer(MAX_FRAGMENT_SIZE);
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (auto& record : records)
+	{
+		sockaddr_storage address;
+		bool hasAddress = reader.getAddress(record.address, address);
+
+		// The receive path may modify the datagram in place
+		std::copy(record.data.begin(), record.data.end(), buffer.begin());
+		conn->replay(hasAddress ? &address : nullptr, buffer.data(), static_cast<int>(record.data.size()));
+
+		if (!options.workers)
+			IO::PacketHandlerPool::drain();
+	}
+
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	float captured = records.back().timestamp / 1000000.0f;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Datagrams:     " << records.size() << std::endl;
+	std::cout << "Captured over: " << captured << " s" << std::endl;
+	std::cout << "Replayed in:   " << seconds << " s (" << (seconds > 0.0f ? captured / seconds : 0.0f) << "x)" << std::endl;
+	std::cout << "Throughput:    " << records.size() / seconds << " datagrams/s, " << bytes / (seconds * 1024.0f * 1024.0f) << " MB/s" << std::endl;
+
+	if (Engine::server)
+		Engine::server->disconnect();
+
+	WSACleanup();
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace TechDemo
+{
+	namespace Util
+	{
+		// Bounded lock-free ring buffer for exactly one producer thread and one consumer thread at a time
+		template <typename T, size_t Capacity>
+		class SPSCQueue
+		{
+			static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "The capacity of a single-producer single-consumer queue must be a power of two.");
+
+			public:
+				SPSCQueue() : slots(new T[Capacity])
+				{
+				}
+
+				// Producer only. Returns false if the queue is full.
+				bool push(T&& value)
+				{
+					size_t tail = this->tail.load(std::memory_order_relaxed);
+
+					if (tail - head.load(std::memory_order_acquire) == Capacity)
+						return false;
+
+					slots[tail & (Capacity - 1)] = std::move(value);
+					this->tail.store(tail + 1, std::memory_order_release);
+
+					return true;
+				}
+
+				// Consumer only. Returns false if the queue is empty.
+				bool pop(T& value)
+				{
+					size_t head = this->head.load(std::memory_order_relaxed);
+
+					if (head == tail.load(std::memory_order_acquire))
+						return false;
+
+					value = std::move(slots[head & (Capacity - 1)]);
+					this->head.store(head + 1, std::memory_order_release);
+
+					return true;
+				}
+
+				size_t size() const
+				{
+					size_t head = this->head.load(std::memory_order_acquire);
+					return tail.load(std::memory_order_acquire) - head;
+				}
+
+				bool empty() const
+				{
+					return size() == 0;
+				}
+
+			private:
+				std::unique_ptr<T[]> slots;
+				alignas(64) std::atomic_size_t head = 0U;	// Next slot to pop
+				alignas(64) std::atomic_size_t tail = 0U;	// Next slot to push
+		};
+	}
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <set>
 #include <sstream>
@@ -9,21 +10,22 @@
 #define WIN32_LEAN_AND_MEAN
 #endif
 
-#define BUFFER_SIZE 1300
-
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <iphlpapi.h>
 
-#include "Clock.h"
 #include "Engine.h"
+#include "HandshakeCookie.h"
 #include "Messenger.h"
+#include "MetricsExporter.h"
 #include "NetworkManager.h"
 #include "Packet.h"
+#include "PacketDispatcher.h"
 #include "PacketNACK.h"
 #include "PlayerConnection.h"
 #include "ServerConnection.h"
+#include "TimingWheel.h"
 
 namespace TechDemo
 {
@@ -31,7 +33,7 @@ namespace TechDemo
 	{
 		ServerConnection::ServerConnection() : InetConnection()
 		{
-			dataClock = Util::Clock::addClock(1, [this]()
+			dataClock = Util::TimingWheel::add(std::chrono::milliseconds(CONNECTION_STATS_PERIOD), [this]()
 			{
 				Engine::serverSentHistory.push_back(bytesSent / 128.0f);
 				Engine::serverRcvdHistory.push_back(bytesRcvd / 128.0f);
@@ -54,14 +56,19 @@ namespace TechDemo
 				bytesRcvd = 0;
 				packetsSent = 0;
 				packetsResent = 0;
-			}, Util::Clock::getMainThreadId());
+
+				for (auto const& client : getClients())
+					client->metrics.sample();
+
+				MetricsExporter::publish();
+			});
 		}
 
 		bool ServerConnection::listen(unsigned short port)
 		{
 			if (!connected && local)
 			{
-				if ((socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == SOCKET_ERROR)
+				if ((socket = backend == SocketBackend::RegisteredIO ? RegisteredIO::createSocket() : ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == SOCKET_ERROR)
 				{
 					std::cerr << "An error occurred while creating a new socket: " << getLastError().second;
 					return false;
@@ -82,6 +89,19 @@ namespace TechDemo
 					return false;
 				}
 
+				DWORD dontFragment = TRUE;
+				if (setsockopt(socket, IPPROTO_IP, IP_DONTFRAGMENT, reinterpret_cast<const char*>(&dontFragment), sizeof(dontFragment)) == SOCKET_ERROR)
+					std::cerr << "An error occurred while disabling fragmentation: " << getLastError().second;
+
+				registeredIO.reset();
+				if (backend == SocketBackend::RegisteredIO)
+				{
+					std::shared_ptr<RegisteredIO> rio = std::make_shared<RegisteredIO>();
+
+					if (rio->open(socket))
+						registeredIO = rio;
+				}
+
 				/*int bufferSize = 65535;
 				if (setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize)) == -1)
 					std::cerr << getLastError().second;
@@ -133,9 +153,34 @@ namespace TechDemo
 			{
 				sent = true;
 
+				auto requested = std::chrono::steady_clock::now();
+
+				// Serialized once, and shared by every client's datagrams
+				BitStream str;
+				PacketDispatcher::writeId(str, packet->getId());
+				packet->serialize(str);
+
+				std::shared_ptr<const std::string> payload = std::make_shared<const std::string>(str.data().data(), str.data().size());
+				bool reliable = packet->shouldRetransmit();
+
+				std::shared_ptr<RegisteredIO> rio = registeredIO;
+				if (rio)
+					rio->beginBatch();
+
 				std::lock_guard lock(connectionsLock);
 				for (auto& client : connections)
-					sent = client.second->send(packet) && sent;
+				{
+					std::shared_ptr<PlayerConnection> player = std::dynamic_pointer_cast<PlayerConnection>(client.second);
+
+					if (player && !player->local)
+						sent = player->send(payload, str.size(), reliable, player->getPayloadSize(), requested) && sent;
+					else
+						sent = client.second->send(packet) && sent;
+				}
+
+				// Submit the datagrams for every client at once
+				if (rio)
+					rio->endBatch();
 			}
 
 			return sent;
@@ -161,6 +206,29 @@ namespace TechDemo
 
 		void ServerConnection::listenLoop()
 		{
+			if (std::shared_ptr<RegisteredIO> rio = registeredIO)
+			{
+				Util::Messenger::send(new ServerStartListening);
+
+				while (connected)
+				{
+					sweepHandshakes();
+					receiveDelivered();
+
+					if (rio->poll([this](sockaddr_storage& addr, char* buffer, int bytes)
+					{
+						if (std::shared_ptr<DatagramCapture> capture = this->capture)
+							capture->record(&addr, buffer, bytes);
+
+						receiveFrom(addr, buffer, bytes);
+					}, 1) == SOCKET_ERROR)
+						break;
+				}
+
+				Util::Messenger::send(new ServerStop);
+				return;
+			}
+
 			fd_set fds, reads;
 			FD_ZERO(&fds);
 			FD_SET(socket, &fds);
@@ -173,17 +241,20 @@ namespace TechDemo
 
 			while (connected)
 			{
+				sweepHandshakes();
+				receiveDelivered();
+
 				reads = fds;
 
 				int result = ::select(socket + 1, &reads, nullptr, nullptr, &timeout);
 				if (result > 0)
 				{
 					int bytes;
-					char buffer[BUFFER_SIZE] = {0};
+					char buffer[MAX_FRAGMENT_SIZE] = {0};
 					sockaddr_storage addr;
 					int addrSize = sizeof(addr);
 
-					if ((bytes = ::recvfrom(socket, buffer, BUFFER_SIZE, 0, reinterpret_cast<sockaddr*>(&addr), &addrSize)) == SOCKET_ERROR)
+					if ((bytes = ::recvfrom(socket, buffer, MAX_FRAGMENT_SIZE, 0, reinterpret_cast<sockaddr*>(&addr), &addrSize)) == SOCKET_ERROR)
 					{
 						char ip[INET6_ADDRSTRLEN] = {0};
 						inet_ntop(AF_INET, getInetAddr(reinterpret_cast<sockaddr*>(&addr)), ip, INET6_ADDRSTRLEN);
@@ -209,197 +280,349 @@ namespace TechDemo
 						continue;
 					}
 
-					bytesRcvd += bytes;
+					if (std::shared_ptr<DatagramCapture> capture = this->capture)
+						capture->record(&addr, buffer, bytes);
 
-					std::pair<std::shared_ptr<InetConnection>, bool> conn = getConnection(&addr, socket);
+					receiveFrom(addr, buffer, bytes);
+				}
+				else if (result == SOCKET_ERROR)
+				{
+					std::cerr << "An error occurred while polling for available packets: " << getLastError().second;
+					continue;
+				}
+			}
 
-					if (conn.first)
-					{
-						BitStream data(buffer, bytes);
-						
-						uint32_t sequenceNumber = 0;
-						data.read(sequenceNumber);
+			Util::Messenger::send(new ServerStop);
+		}
 
-						if (conn.second)
-						{
-							std::cout << "Client " << conn.first->getRemoteAddress() << ":" << conn.first->getPort() << " has connected." << std::endl;
+		void ServerConnection::receiveFrom(sockaddr_storage& addr, char* buffer, int bytes)
+		{
+			bytesRcvd += bytes;
 
-							conn.first->lastSequenceNumber = sequenceNumber;
-							conn.first->expectedSequenceNumber = sequenceNumber + 1;
-						}
-						else
-						{
-							if (Util::Random::rand(0.0f, 1.0f) < packetDropChance)
-							{
-								++packetsLost;
-								conn.first->missingPacketsLock.lock();
-								conn.first->missingPackets.emplace(sequenceNumber);
-								conn.first->missingPacketsLock.unlock();
-								conn.first->lastSequenceNumber = std::max(conn.first->lastSequenceNumber, sequenceNumber);
-								conn.first->send(new PacketNACK(sequenceNumber, 1));
-								continue;
-							}
+			// Nothing is allocated for an address until it has echoed a cookie
+			if (std::shared_ptr<InetConnection> known = getConnection(&addr))
+			{
+				if (handshakeCookies ? HandshakeCookie::verify(addr, buffer, bytes) : HandshakeCookie::isCookie(buffer, bytes))
+				{
+					// The handshake echoed again after the connection was admitted
+					buffer += COOKIE_DATAGRAM_SIZE;
+					bytes -= COOKIE_DATAGRAM_SIZE;
+				}
+				else if (!pendingHandshakes.empty())
+					pendingHandshakes.erase(known->getRemoteAddress() + ":" + std::to_string(known->getPort()));
+			}
+			else if (!admit(addr, buffer, bytes))
+				return;
 
-							conn.first->missingPacketsLock.lock();
-							conn.first->missingPackets.erase(sequenceNumber);
-							conn.first->missingPacketsLock.unlock();
+			std::pair<std::shared_ptr<InetConnection>, bool> conn = getConnection(&addr, socket);
 
-							if (conn.first->expectedSequenceNumber == sequenceNumber)
-							{
-								++conn.first->expectedSequenceNumber;
+			if (conn.first)
+			{
+				conn.first->metrics.recordDatagramReceived(bytes);
 
-								if (!conn.first->receivedPackets.empty())
-								{
-									uint16_t size = 0;
-
-									bool useBoth = conn.first->dataStream.remaining();
-									BitStream* stream = useBoth ? &conn.first->dataStream : &data;
-									size_t readBit = stream->readBit();
-
-									while (!size && stream->remaining() >= 16)
-									{
-										stream->read(size, 16);
-
-										uint16_t skipped = std::min(size, static_cast<uint16_t>(stream->remaining()));
-										stream->skip(skipped);
-										size -= skipped;
-
-										if (size && useBoth)
-										{
-											stream->readBit(readBit);
-											stream = &data;
-											readBit = stream->readBit();
-											stream->skip(size);
-											size -= std::min(size, static_cast<uint16_t>(stream->remaining()));
-											useBoth = false;
-										}
-									}
-
-									if (stream->remaining())
-										stream->trim(stream->remaining());
+				BitStream data(buffer, bytes);
+				
+				uint32_t sequenceNumber = 0;
+				data.read(sequenceNumber);
 
-									stream->readBit(readBit);
+				if (conn.second)
+				{
+					std::cout << "Client " << conn.first->getRemoteAddress() << ":" << conn.first->getPort() << " has connected." << std::endl;
+
+					conn.first->lastSequenceNumber = sequenceNumber;
+					conn.first->expectedSequenceNumber = sequenceNumber + 1;
+				}
+				else if (InetConnection::isUnsequenced(sequenceNumber, conn.first->expectedSequenceNumber))
+				{
+					// Dispatched straight away, rather than parked behind whatever the window is still missing
+					conn.first->receiveUnsequenced(data);
+					return;
+				}
+				else if (ParityDecoder::isParity(sequenceNumber, conn.first->expectedSequenceNumber))
+				{
+					// Parity is numbered outside the window, so it must not be mistaken for a datagram far ahead of it
+					std::string recovered = conn.first->parityDecoder.recover(buffer, bytes, conn.first->expectedSequenceNumber);
+
+					if (!recovered.empty())
+						receiveFrom(addr, recovered.data(), static_cast<int>(recovered.size()));
+
+					return;
+				}
+				else
+				{
+					if (Util::Random::rand(0.0f, 1.0f) < packetDropChance)
+					{
+						++packetsLost;
+						conn.first->metrics.recordLost(1);
+						conn.first->missingPacketsLock.lock();
+						conn.first->missingPackets.emplace(sequenceNumber);
+						conn.first->missingPacketsLock.unlock();
+						conn.first->lastSequenceNumber = std::max(conn.first->lastSequenceNumber, sequenceNumber);
+						conn.first->send(new PacketNACK(sequenceNumber, 1));
+						return;
+					}
 
-									// Fit packet into stored packet data, and load following packets into buffer based on the packet length, incrementing expected number
-									for (auto iter = conn.first->receivedPackets.find(conn.first->expectedSequenceNumber); iter != conn.first->receivedPackets.end(); conn.first->receivedPackets.erase(iter), iter = conn.first->receivedPackets.find(++conn.first->expectedSequenceNumber))
-									{
-										BitStream& packetData = iter->second;
+					conn.first->parityDecoder.add(sequenceNumber, buffer, bytes);
 
-										if (size == 0)
-										{
-											packetData.peek(size, 16);
-											size += 16;
-										}
+					conn.first->missingPacketsLock.lock();
+					conn.first->missingPackets.erase(sequenceNumber);
+					conn.first->missingPacketsLock.unlock();
 
-										uint16_t len = std::min(size, static_cast<uint16_t>(packetData.remaining()));
+					if (conn.first->expectedSequenceNumber == sequenceNumber)
+					{
+						++conn.first->expectedSequenceNumber;
 
-										if (packetData.remaining() > len)
-											packetData.trim(packetData.remaining() - len);
+						if (!conn.first->receivedPackets.empty())
+						{
+							uint16_t size = 0;
 
-										data << packetData;
+							bool useBoth = conn.first->dataStream.remaining();
+							BitStream* stream = useBoth ? &conn.first->dataStream : &data;
+							size_t readBit = stream->readBit();
 
-										size -= len;
-									}
-								}
-								else
-								{
-									uint16_t size = 0;
-									data.peek(size, 16);
+							while (!size && stream->remaining() >= 16)
+							{
+								stream->read(size, 16);
+
+								uint16_t skipped = std::min(size, static_cast<uint16_t>(stream->remaining()));
+								stream->skip(skipped);
+								size -= skipped;
 
-									if (data.remaining() - 16 > size)
-										data.trim((data.remaining() - 16) - size);
+								if (size && useBoth)
+								{
+									stream->readBit(readBit);
+									stream = &data;
+									readBit = stream->readBit();
+									stream->skip(size);
+									size -= std::min(size, static_cast<uint16_t>(stream->remaining()));
+									useBoth = false;
 								}
 							}
-							else if (conn.first->expectedSequenceNumber < sequenceNumber)
-							{
-								if (conn.first->lastSequenceNumber < sequenceNumber)
-								{
-									uint32_t newPackets = sequenceNumber - conn.first->lastSequenceNumber;
 
-									if (newPackets > 1)
-									{
-										packetsLost += newPackets - 1;
+							if (stream->remaining())
+								stream->trim(stream->remaining());
+
+							stream->readBit(readBit);
 
-										conn.first->missingPacketsLock.lock();
-										for (uint32_t i = conn.first->lastSequenceNumber + 1; i < sequenceNumber; conn.first->missingPackets.emplace(i++));
-										conn.first->missingPacketsLock.unlock();
+							// Fit packet into stored packet data, and load following packets into buffer based on the packet length, incrementing expected number
+							for (auto iter = conn.first->receivedPackets.find(conn.first->expectedSequenceNumber); iter != conn.first->receivedPackets.end(); conn.first->receivedPackets.erase(iter), iter = conn.first->receivedPackets.find(++conn.first->expectedSequenceNumber))
+							{
+								BitStream& packetData = iter->second;
 
-										conn.first->send(new PacketNACK(conn.first->lastSequenceNumber + 1, newPackets - 1));
-									}
+								if (size == 0)
+								{
+									packetData.peek(size, 16);
+									size += 16;
 								}
 
-								// Record packet data, and delay further processing
-								conn.first->receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
-								conn.first->lastSequenceNumber = std::max(sequenceNumber, conn.first->lastSequenceNumber);
-								continue;
-							}
-							else
-							{
-								++packetsDuplicated;
-								continue; // Drop duplicate packet
-							}
+								uint16_t len = std::min(size, static_cast<uint16_t>(packetData.remaining()));
 
-							conn.first->lastSequenceNumber = std::max(sequenceNumber, conn.first->lastSequenceNumber);
-						}
+								if (packetData.remaining() > len)
+									packetData.trim(packetData.remaining() - len);
 
-						conn.first->dataStream << data;
+								data << packetData;
 
-						handle:
+								size -= len;
+							}
 
-						if (conn.first->dataStream.remaining() >= 16)
+							if (conn.first->receivedPackets.empty())
+								conn.first->metrics.getReassemblyDelay().record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - conn.first->reassemblyStart).count());
+						}
+						else
 						{
 							uint16_t size = 0;
-							conn.first->dataStream.peek(size, 16);
+							data.peek(size, 16);
 
-							if (size)
+							if (data.remaining() - 16 > size)
+								data.trim((data.remaining() - 16) - size);
+						}
+					}
+					else if (conn.first->expectedSequenceNumber < sequenceNumber)
+					{
+						if (conn.first->lastSequenceNumber < sequenceNumber)
+						{
+							uint32_t newPackets = sequenceNumber - conn.first->lastSequenceNumber;
+
+							if (newPackets > 1)
 							{
-								unsigned length = conn.first->dataStream.remaining() - 16 /* peek size */;
+								packetsLost += newPackets - 1;
+								conn.first->metrics.recordLost(newPackets - 1);
 
-								if (size <= length)
-								{
-									conn.first->dataStream.skip(16);
+								conn.first->missingPacketsLock.lock();
+								for (uint32_t i = conn.first->lastSequenceNumber + 1; i < sequenceNumber; conn.first->missingPackets.emplace(i++));
+								conn.first->missingPacketsLock.unlock();
 
-									unsigned long readBit = conn.first->dataStream.readBit();
+								conn.first->send(new PacketNACK(conn.first->lastSequenceNumber + 1, newPackets - 1));
+							}
+						}
 
-									uint32_t id = 0;
-									conn.first->dataStream.read(id);
+						if (conn.first->receivedPackets.empty())
+							conn.first->reassemblyStart = std::chrono::steady_clock::now();
 
-									std::shared_ptr<IO::PacketBase> packet = IO::PacketBase::getPacket(id);
+						// Record packet data, and delay further processing
+						conn.first->receivedPackets.insert(std::make_pair(sequenceNumber, std::move(data)));
+						conn.first->lastSequenceNumber = std::max(sequenceNumber, conn.first->lastSequenceNumber);
+						return;
+					}
+					else
+					{
+						++packetsDuplicated;
+						conn.first->metrics.recordDuplicated();
+						return; // Drop duplicate packet
+					}
 
-									if (packet)
-									{
-										packet->deserialize(conn.first->dataStream);
-										packet->handle(*std::dynamic_pointer_cast<Connection>(conn.first), Direction::Serverbound);
-									}
+					conn.first->lastSequenceNumber = std::max(sequenceNumber, conn.first->lastSequenceNumber);
+				}
 
-									// Discard remaining packet data, and remaining bits in last byte to prepare for next packet
-									//conn.first->dataStream.skip((size - (conn.first->dataStream.readBit() - readBit)) + ((Util::byteSize() - 1) - ((conn.first->dataStream.readBit() - 1) % Util::byteSize())));
+				conn.first->dataStream << data;
 
-									if (conn.first->dataStream.remaining() == 0)
-										conn.first->dataStream.clear();
+				handle:
 
-									goto handle;
-								}
-							}
-							else
+				if (conn.first->dataStream.remaining() >= 16)
+				{
+					uint16_t size = 0;
+					conn.first->dataStream.peek(size, 16);
+
+					if (size)
+					{
+						unsigned length = conn.first->dataStream.remaining() - 16 /* peek size */;
+
+						if (size <= length)
+						{
+							conn.first->dataStream.skip(16);
+
+							unsigned long readBit = conn.first->dataStream.readBit();
+
+							PacketDispatcher::Lease packet = PacketDispatcher::acquire(conn.first->dataStream);
+
+							if (packet)
 							{
-								conn.first->dataStream.skip(16);
-								goto handle;
+								packet->deserialize(conn.first->dataStream);
+								conn.first->metrics.recordReceived(packet->shouldRetransmit() ? Channel::Reliable : Channel::Unreliable, size / Util::byteSize());
+								conn.first->dispatch(std::move(packet));
 							}
-						}
 
-						if (conn.second)
-							Util::Messenger::send(new ServerIncomingConnect{ std::dynamic_pointer_cast<PlayerConnection>(conn.first) });
+							// Discard remaining packet data, and remaining bits in last byte to prepare for next packet
+							//conn.first->dataStream.skip((size - (conn.first->dataStream.readBit() - readBit)) + ((Util::byteSize() - 1) - ((conn.first->dataStream.readBit() - 1) % Util::byteSize())));
+
+							if (conn.first->dataStream.remaining() == 0)
+								conn.first->dataStream.clear();
+
+							goto handle;
+						}
+					}
+					else
+					{
+						conn.first->dataStream.skip(16);
+						goto handle;
 					}
 				}
-				else if (result == SOCKET_ERROR)
+
+				if (conn.second)
+					Util::Messenger::send(new ServerIncomingConnect{ std::dynamic_pointer_cast<PlayerConnection>(conn.first) });
+			}
+		}
+
+		void ServerConnection::replay(sockaddr_storage* address, char* buffer, int bytes)
+		{
+			if (address)
+				receiveFrom(*address, buffer, bytes);
+		}
+
+		void ServerConnection::setHandshakeCookies(bool enabled)
+		{
+			handshakeCookies = enabled;
+		}
+
+		bool ServerConnection::getHandshakeCookies() const
+		{
+			return handshakeCookies;
+		}
+
+		bool ServerConnection::admit(sockaddr_storage& addr, char*& buffer, int& bytes)
+		{
+			bool echoed = handshakeCookies ? HandshakeCookie::verify(addr, buffer, bytes) : HandshakeCookie::isCookie(buffer, bytes);
+
+			if (!echoed && handshakeCookies)
+			{
+				// Stateless, and never larger than the datagram it answers (clients pad their handshake to the cookie's size),
+				// so spoofed traffic cannot be reflected at a victim with any amplification
+				if (bytes < COOKIE_DATAGRAM_SIZE)
+					return false;
+
+				std::string challenge = HandshakeCookie::challenge(addr);
+
+				if (!challenge.empty() && transmitTo(addr, challenge.data(), static_cast<unsigned>(challenge.size())) == SOCKET_ERROR)
+					std::cerr << "An error occurred while sending a handshake cookie: " << getLastError().second;
+
+				return false;
+			}
+
+			if (pendingHandshakes.size() >= HANDSHAKE_PENDING_LIMIT)
+				expireHandshakes();
+
+			// The client echoes its handshake again on its own, so there is no need to remember it until there is room
+			if (pendingHandshakes.size() >= HANDSHAKE_PENDING_LIMIT)
+				return false;
+
+			char ip[INET6_ADDRSTRLEN] = {0};
+			inet_ntop(addr.ss_family, getInetAddr(reinterpret_cast<sockaddr*>(&addr)), ip, INET6_ADDRSTRLEN);
+			unsigned short port = ntohs(static_cast<unsigned short>(addr.ss_family == AF_INET6 ? reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port : (addr.ss_family == AF_INET ? reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port : 0)));
+
+			pendingHandshakes.emplace(std::string(ip) + ":" + std::to_string(port), std::chrono::steady_clock::now());
+
+			if (echoed)
+			{
+				buffer += COOKIE_DATAGRAM_SIZE;
+				bytes -= COOKIE_DATAGRAM_SIZE;
+			}
+
+			return true;
+		}
+
+		void ServerConnection::expireHandshakes()
+		{
+			auto now = std::chrono::steady_clock::now();
+			lastSweep = now;
+
+			std::lock_guard<std::recursive_mutex> lock(connectionsLock);
+
+			for (auto iter = pendingHandshakes.begin(); iter != pendingHandshakes.end();)
+			{
+				if (now - iter->second < std::chrono::milliseconds(HANDSHAKE_TIMEOUT))
 				{
-					std::cerr << "An error occurred while polling for available packets: " << getLastError().second;
+					++iter;
 					continue;
 				}
+
+				auto conn = connections.find(iter->first);
+
+				if (conn != connections.end())
+				{
+					Util::Messenger::send(new ServerClientDisconnect{ std::dynamic_pointer_cast<PlayerConnection>(conn->second) });
+					conn->second->disconnect();
+					connections.erase(conn);
+				}
+
+				iter = pendingHandshakes.erase(iter);
 			}
+		}
 
-			Util::Messenger::send(new ServerStop);
+		void ServerConnection::sweepHandshakes()
+		{
+			if (!pendingHandshakes.empty() && std::chrono::steady_clock::now() - lastSweep >= std::chrono::milliseconds(HANDSHAKE_SWEEP_INTERVAL))
+				expireHandshakes();
+		}
+
+		int ServerConnection::transmitTo(sockaddr_storage const& addr, const char* data, unsigned length) const
+		{
+			if (std::shared_ptr<LinkEmulator> emulator = linkEmulator)
+				return emulator->transmit(Direction::Clientbound, socket, data, length, &addr);
+
+			if (std::shared_ptr<RegisteredIO> rio = registeredIO)
+				return rio->send(data, length, &addr);
+
+			return ::sendto(socket, data, static_cast<int>(length), 0, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
 		}
 	}
 }
\ No newline at end of file
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "InetConnection.h"
 
+#define HANDSHAKE_PENDING_LIMIT 1024	// Connections admitted by cookie which have not been heard from since
+#define HANDSHAKE_TIMEOUT 5000			// Milliseconds an admitted connection has to follow up its handshake
+#define HANDSHAKE_SWEEP_INTERVAL 1000	// Milliseconds between sweeps of the admitted connections for expired ones
+
 namespace TechDemo
 {
 	namespace IO
@@ -30,8 +37,34 @@ namespace TechDemo
 
 				std::unordered_set<std::shared_ptr<PlayerConnection>> getClients() const;
 
+				virtual void replay(sockaddr_storage* address, char* buffer, int bytes);
+
+				// Admits unknown addresses without a cookie exchange, as when replaying a capture whose cookies were signed
+				// with another process's secret. Cookies echoed anyway are stripped.
+				void setHandshakeCookies(bool enabled);
+
+				bool getHandshakeCookies() const;
+
 			private:
 				void listenLoop();
+
+				void receiveFrom(sockaddr_storage& addr, char* buffer, int bytes);
+
+				// Decides whether a datagram from an unknown address may create a connection, answering it with a cookie if not.
+				// Strips the echoed cookie from the datagrams admitted.
+				bool admit(sockaddr_storage& addr, char*& buffer, int& bytes);
+
+				// Disconnects admitted connections which never followed up their handshake
+				void expireHandshakes();
+
+				// Expires handshakes at most once per sweep interval, so the table is cleared even while it has room
+				void sweepHandshakes();
+
+				int transmitTo(sockaddr_storage const& addr, const char* data, unsigned length) const;
+
+				std::unordered_map<std::string, std::chrono::steady_clock::time_point> pendingHandshakes;	// Only touched by the listening thread
+				std::chrono::steady_clock::time_point lastSweep;
+				bool handshakeCookies = true;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Engine.h"
+#include "History.h"
+#include "Simulation.h"
+
+namespace TechDemo
+{
+	namespace World
+	{
+		Util::MPSCQueue<Simulation::Update, SIMULATION_QUEUE_SIZE> Simulation::updates;
+		Util::TripleBuffer<std::shared_ptr<const Simulation::Frame>> Simulation::published;
+		std::function<void(unsigned long long)> Simulation::step;
+		std::deque<std::shared_ptr<const Simulation::Changes>> Simulation::recent;
+		Util::UUID Simulation::sceneId;
+		unsigned long long Simulation::lastTick = 0ULL;
+		std::atomic_bool Simulation::running = false;
+		std::thread Simulation::thread;
+
+		void Simulation::init()
+		{
+			if (running)
+				return;
+
+			recent.clear();
+			lastTick = 0ULL;
+			running = true;
+
+			std::thread simulationThread(&Simulation::run);
+			std::swap(thread, simulationThread);
+		}
+
+		void Simulation::shutdown()
+		{
+			if (!running)
+				return;
+
+			running = false;
+
+			if (thread.joinable())
+				thread.join();
+
+			// Nothing queued before the thread stopped is lost
+			for (Update update; updates.pop(update);)
+				History::applyChanges(update.componentId, update.variables);
+
+			recent.clear();
+		}
+
+		bool Simulation::isRunning()
+		{
+			return running;
+		}
+
+		void Simulation::setStep(std::function<void(unsigned long long)> const& step)
+		{
+			Simulation::step = step;
+		}
+
+		void Simulation::enqueue(Util::UUID const& componentId, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>&& variables)
+		{
+			Update update{ componentId, std::move(variables) };
+
+			if (!running)
+			{
+				History::applyChanges(update.componentId, update.variables);
+				return;
+			}
+
+			// The update is only moved from once it has been queued, and the queue is emptied every tick
+			for (auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(1000000000LL / SIMULATION_RATE); !updates.push(std::move(update)); std::this_thread::yield())
+			{
+				if (!running || std::chrono::steady_clock::now() >= deadline)
+				{
+					std::cerr << "An error occurred while queuing an update for the simulation: The queue is full." << std::endl;
+					return;
+				}
+			}
+		}
+
+		Simulation::changeType Simulation::getChanges(Util::UUID const& sceneId, unsigned long long fromExclusive, unsigned long long& toInclusive)
+		{
+			std::shared_ptr<const Frame> frame = running ? published.read() : nullptr;
+
+			if (!frame || !(frame->sceneId == sceneId))
+				return History::getChanges(sceneId, fromExclusive, toInclusive);
+
+			toInclusive = std::min(toInclusive, frame->timestamp);
+
+			changeType result;
+
+			if (toInclusive <= fromExclusive)
+				return result;
+
+			// Older than the changes still published, so only the History covers the whole range
+			if (frame->ticks.empty() || frame->ticks.front()->fromExclusive > fromExclusive)
+				return History::getChanges(sceneId, fromExclusive, toInclusive);
+
+			// Newest first, so a variable changed by several ticks keeps its newest value
+			for (auto iter = frame->ticks.rbegin(); iter != frame->ticks.rend() && (*iter)->toInclusive > fromExclusive; ++iter)
+			{
+				for (auto const& component : (*iter)->variables)
+				{
+					for (auto const& variable : component.second)
+					{
+						if (variable.second.first > fromExclusive && variable.second.first <= toInclusive)
+							result[component.first].emplace(variable.first, std::make_pair(variable.second.first, IO::BitStream(variable.second.second)));
+					}
+				}
+			}
+
+			return result;
+		}
+
+		void Simulation::run()
+		{
+			const auto period = std::chrono::nanoseconds(1000000000LL / SIMULATION_RATE);
+			auto next = std::chrono::steady_clock::now();
+
+			while (running)
+			{
+				tick(Engine::getTimestamp());
+
+				next += period;
+
+				// After a long stall the missed ticks are skipped, rather than run back to back
+				auto now = std::chrono::steady_clock::now();
+				if (now - next > period * SIMULATION_MAX_CATCH_UP)
+					next = now;
+
+				std::this_thread::sleep_until(next);
+			}
+		}
+
+		void Simulation::tick(unsigned long long timestamp)
+		{
+			Util::UUID scene = Engine::getScene().getUUID();
+			if (!(scene == sceneId))
+			{
+				sceneId = scene;
+				recent.clear();
+				lastTick = 0ULL;
+			}
+
+			std::shared_ptr<Changes> changes = std::make_shared<Changes>();
+			changes->fromExclusive = lastTick;
+			changes->toInclusive = std::max(lastTick, timestamp);
+
+			for (Update update; updates.pop(update);)
+			{
+				History::applyChanges(update.componentId, update.variables);
+
+				// The History files remote values under the sender's timestamps, which are usually behind the last tick, so
+				// they are published as of this tick rather than left for the range below to skip. Updates are popped in the
+				// order they arrived, so the newest arrival wins.
+				auto& variables = changes->variables[update.componentId];
+
+				for (auto& variable : update.variables)
+					variables.insert_or_assign(variable.first, std::make_pair(changes->toInclusive, std::move(variable.second.second)));
+			}
+
+			if (step)
+				step(timestamp);
+
+			// The History's locks are taken once per tick here, rather than once per connection tick. Everything published by
+			// earlier ticks is older than this range, so only this tick's changes are compared against.
+			for (auto& component : History::getChanges(sceneId, lastTick, timestamp))
+			{
+				auto& variables = changes->variables[component.first];
+
+				for (auto& variable : component.second)
+				{
+					auto iter = variables.find(variable.first);
+
+					if (iter == variables.end())
+						variables.emplace(variable.first, std::move(variable.second));
+					else if (variable.second.first >= iter->second.first)
+						iter->second = std::move(variable.second);
+				}
+			}
+
+			lastTick = changes->toInclusive;
+
+			recent.push_back(std::move(changes));
+			if (recent.size() > SIMULATION_HISTORY_TICKS)
+				recent.pop_front();
+
+			// Only the change sets' pointers are copied, however many variables they hold
+			published.write() = std::make_shared<const Frame>(Frame{ sceneId, lastTick, std::vector<std::shared_ptr<const Changes>>(recent.begin(), recent.end()) });
+			published.publish();
+		}
+	}
+}
\ No newline at end of file
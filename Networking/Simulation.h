@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BitStream.h"
+#include "MPSCQueue.h"
+#include "TripleBuffer.h"
+#include "UUID.h"
+
+#define SIMULATION_RATE 60				// Ticks per second
+#define SIMULATION_MAX_CATCH_UP 5		// Ticks run back to back after a stall before the rest are skipped
+#define SIMULATION_QUEUE_SIZE 4096		// Updates the network threads may have waiting for the next tick
+#define SIMULATION_HISTORY_TICKS 120	// Ticks of changes published, beyond which snapshots are cut from the History instead
+
+namespace TechDemo
+{
+	namespace World
+	{
+		// Fixed-timestep simulation thread. Network threads queue the updates they decode rather than applying them to the
+		// History themselves, and each tick applies them all at once, runs the step (physics and History::log belong there)
+		// and publishes the variables it changed through a triple buffer, alongside the change sets of the ticks before it.
+		// Snapshots are then cut from the published changes without the network side touching the History's locks.
+		class Simulation
+		{
+			public:
+				using changeType = std::unordered_map<Util::UUID, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>>;
+
+				Simulation() = delete;
+
+				static void init();
+
+				static void shutdown();
+
+				static bool isRunning();
+
+				// Runs on the simulation thread each tick, with the tick's timestamp, after the queued updates are applied
+				static void setStep(std::function<void(unsigned long long)> const& step);
+
+				// Any thread. Applied immediately while the simulation is not running. Waits up to a tick for room if the queue is
+				// full, and drops the update if there is still none, as applying it here would race the simulation thread.
+				static void enqueue(Util::UUID const& componentId, std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>>&& variables);
+
+				// Main thread only. The newest value of each variable changed in the range, as History::getChanges. Lowers the
+				// end of the range to the newest published tick, so nothing logged after it is skipped by a caller moving on.
+				static changeType getChanges(Util::UUID const& sceneId, unsigned long long fromExclusive, unsigned long long& toInclusive);
+
+			private:
+				struct Update
+				{
+					Util::UUID componentId;
+					std::unordered_map<uint16_t, std::pair<unsigned long long, IO::BitStream>> variables;
+				};
+
+				// Shared by the frames of every tick until it ages out, so publishing copies no variables
+				struct Changes
+				{
+					unsigned long long fromExclusive = 0ULL;	// The tick before
+					unsigned long long toInclusive = 0ULL;		// This tick
+					changeType variables;						// Newest value of each variable changed by this tick
+				};
+
+				struct Frame
+				{
+					Util::UUID sceneId;
+					unsigned long long timestamp = 0ULL;
+					std::vector<std::shared_ptr<const Changes>> ticks;	// Oldest first
+				};
+
+				static void run();
+
+				static void tick(unsigned long long timestamp);
+
+				static Util::MPSCQueue<Update, SIMULATION_QUEUE_SIZE> updates;
+				static Util::TripleBuffer<std::shared_ptr<const Frame>> published;
+				static std::function<void(unsigned long long)> step;
+				static std::deque<std::shared_ptr<const Changes>> recent;	// Only touched by the simulation thread
+				static Util::UUID sceneId;
+				static unsigned long long lastTick;
+				static std::atomic_bool running;
+				static std::thread thread;
+		};
+	}
+}
\ No newline at end of file
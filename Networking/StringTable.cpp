@@ -0,0 +1,96 @@
+#include "StringTable.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		void StringTable::write(BitStream& stream, std::string const& value)
+		{
+			std::unique_lock guard(lock);
+
+			auto iter = indices.find(value);
+			if (iter != indices.end())
+			{
+				stream.writeRanged(iter->second, STRING_TABLE_SIZE);
+				stream.write(false, 1);
+			}
+			else if (indices.size() < STRING_TABLE_SIZE)
+			{
+				uint32_t index = static_cast<uint32_t>(indices.size());
+				indices.emplace(value, index);
+
+				stream.writeRanged(index, STRING_TABLE_SIZE);
+				stream.write(true, 1);
+				stream.write(value);
+			}
+			else
+			{
+				guard.unlock();
+				writeInline(stream, value);
+			}
+		}
+
+		void StringTable::writeInline(BitStream& stream, std::string const& value)
+		{
+			stream.writeRanged(STRING_TABLE_SIZE, STRING_TABLE_SIZE);
+			stream.write(value);
+		}
+
+		void StringTable::read(BitStream& stream, Entry& entry)
+		{
+			stream.readRanged(entry.index, STRING_TABLE_SIZE);
+
+			entry.defined = entry.index == STRING_TABLE_SIZE;
+			if (!entry.defined)
+				stream.read(entry.defined, 1);
+
+			if (entry.defined)
+				stream.read(entry.value);
+		}
+
+		void StringTable::resolve(Entry const& entry, std::function<void(std::string const&)> const& callback)
+		{
+			if (entry.index >= STRING_TABLE_SIZE)
+			{
+				callback(entry.value);
+				return;
+			}
+
+			std::string value;
+			std::vector<std::function<void(std::string const&)>> callbacks;
+
+			{
+				std::lock_guard guard(lock);
+
+				if (entry.defined)
+				{
+					value = values[entry.index] = entry.value;
+
+					auto iter = waiting.find(entry.index);
+					if (iter != waiting.end())
+					{
+						callbacks = std::move(iter->second);
+						waiting.erase(iter);
+					}
+				}
+				else
+				{
+					auto iter = values.find(entry.index);
+					if (iter == values.end())
+					{
+						waiting[entry.index].push_back(callback);
+						return;
+					}
+
+					value = iter->second;
+				}
+			}
+
+			// Called without the lock, so that callbacks may use the table
+			callback(value);
+
+			for (auto const& waiter : callbacks)
+				waiter(value);
+		}
+	}
+}
\ No newline at end of file
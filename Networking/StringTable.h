@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BitStream.h"
+
+#define STRING_TABLE_SIZE 1023	// Entries per direction of a connection; the index past the last marks a string sent inline
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Dictionary for strings repeated across a connection's packets, such as model paths. The first time a string is
+		// written it is sent along with the index it was entered at, and after that only the index is, in as few bits as the
+		// table size needs. Entries are never evicted; strings written once the table is full are sent inline.
+		class StringTable
+		{
+			public:
+				struct Entry
+				{
+					uint32_t index = STRING_TABLE_SIZE;
+					bool defined = false;	// Whether the value was sent, rather than just the index
+					std::string value;
+				};
+
+				// Writes the string's index, preceded by the string itself the first time
+				void write(BitStream& stream, std::string const& value);
+
+				// Writes the string inline, for packets serialized without a connection's table
+				static void writeInline(BitStream& stream, std::string const& value);
+
+				static void read(BitStream& stream, Entry& entry);
+
+				// Enters any string the entry carries, and calls back with its value. Entries only referring to an index are
+				// held until the packet defining it has arrived, as reliable packets may be handled out of order.
+				void resolve(Entry const& entry, std::function<void(std::string const&)> const& callback);
+
+			private:
+				std::unordered_map<std::string, uint32_t> indices;	// Sending side
+				std::unordered_map<uint32_t, std::string> values;	// Receiving side
+				std::unordered_map<uint32_t, std::vector<std::function<void(std::string const&)>>> waiting;
+				std::mutex lock;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <vector>
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "GameObject.h"
+#include "PacketNACK.h"
+#include "PacketPing.h"
+#include "PacketUpdateBatch.h"
+#include "RTTI.h"
+#include "SwarmClient.h"
+
+namespace
+{
+	using namespace TechDemo;
+
+	// Ids of the leaf variables making up a transform's position: the position itself, or each axis if glm::vec3 registers
+	// its members. Looked up on first use, as variable ids are only numbered once registration has finished.
+	std::vector<uint16_t> const& getPositionIds()
+	{
+		static std::vector<uint16_t> const ids = []()
+		{
+			std::vector<uint16_t> result;
+
+			if (Util::RTTI::Type const* type = Util::RTTI::getType(Util::CRC32::checksum(Util::getQualifiedName<World::Transform>())))
+			{
+				if (uint16_t id = type->getVariableId("position"); id != INVALID_VARIABLE)
+					result.push_back(id);
+				else
+				{
+					for (const char* axis : { "position.x", "position.y", "position.z" })
+					{
+						if (uint16_t id = type->getVariableId(axis); id != INVALID_VARIABLE)
+							result.push_back(id);
+					}
+				}
+			}
+
+			if (result.size() != 1 && result.size() != 3)
+			{
+				std::cerr << "An error occurred while looking up the transform's position variables; no updates will be sent" << std::endl;
+				result.clear();
+			}
+
+			return result;
+		}();
+
+		return ids;
+	}
+}
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		SwarmClient::SwarmClient() : PlayerConnection()
+		{
+		}
+
+		bool SwarmClient::connect(std::string const& ipAddress, unsigned short port)
+		{
+			if (!connected && local && open(ipAddress, port))
+			{
+				u_long nonBlocking = 1;
+				if (ioctlsocket(socket, FIONBIO, &nonBlocking) == SOCKET_ERROR)
+					std::cerr << "An error occurred while making a socket non-blocking: " << getLastError().second;
+
+				sendHandshake();
+
+				return true;
+			}
+
+			return false;
+		}
+
+		void SwarmClient::tick(unsigned long long timestamp, bool sendUpdates)
+		{
+			if (isConnected())
+			{
+				recordRTT();
+
+				PacketPing* ping = new PacketPing(Direction::Serverbound);
+				ping->setTimestamp(timestamp);
+				send(std::shared_ptr<PacketBase>(ping));
+
+				if (sendUpdates)
+				{
+					// Synthetic movement, standing in for a replicated transform
+					position.x += 0.01f;
+
+					static const uint32_t transformHash = Util::CRC32::checksum(Util::getQualifiedName<World::Transform>());
+					std::vector<uint16_t> const& ids = getPositionIds();
+
+					PacketUpdateBatch::changeType changes;
+
+					for (size_t i = 0; i < ids.size(); ++i)
+					{
+						BitStream stream;
+
+						if (ids.size() == 1)
+							stream.write(position);
+						else
+							stream.write(position[static_cast<glm::length_t>(i)]);
+
+						changes[componentId].emplace(ids[i], std::make_pair(timestamp, std::move(stream)));
+					}
+
+					// Sent as the real client's tick does, with the type given, as the component has no local instance
+					if (!changes.empty())
+					{
+						for (auto const& batch : PacketUpdateBatch::create(timestamp, changes, getPayloadSize(), { { componentId, transformHash } }))
+							send(batch);
+					}
+				}
+
+				missingPacketsLock.lock();
+				if (!missingPackets.empty())
+					send(new PacketNACK(missingPackets));
+				missingPacketsLock.unlock();
+			}
+			else
+				retryHandshake();
+		}
+
+		bool SwarmClient::poll()
+		{
+			if (!socket)
+				return false;
+
+			char buffer[MAX_FRAGMENT_SIZE];
+			int bytes = ::recv(socket, buffer, MAX_FRAGMENT_SIZE, 0);
+
+			if (bytes == SOCKET_ERROR || bytes == 0)
+				return false;
+
+			++packetsReceived;
+			receive(buffer, bytes);
+
+			return true;
+		}
+
+		unsigned SwarmClient::getSocket() const
+		{
+			return socket;
+		}
+
+		unsigned long SwarmClient::getBytesSent() const
+		{
+			return bytesSent;
+		}
+
+		unsigned long SwarmClient::getBytesReceived() const
+		{
+			return bytesRcvd;
+		}
+
+		unsigned long SwarmClient::getPacketsSent() const
+		{
+			return packetsSent;
+		}
+
+		unsigned long SwarmClient::getPacketsReceived() const
+		{
+			return packetsReceived;
+		}
+
+		unsigned long SwarmClient::getPacketsLost() const
+		{
+			return packetsLost;
+		}
+
+		unsigned long long SwarmClient::getRTTCount() const
+		{
+			return metrics.getRTT().getCount();
+		}
+	}
+}
\ No newline at end of file
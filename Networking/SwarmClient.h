@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+#include <glm/glm.hpp>
+
+#include "PlayerConnection.h"
+#include "UUID.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Headless client connection, driven externally by the load generator rather than by its own thread and clocks
+		class SwarmClient : public PlayerConnection
+		{
+			public:
+				SwarmClient();
+
+				virtual bool connect(std::string const& ipAddress, unsigned short port);
+
+				void tick(unsigned long long timestamp, bool sendUpdates);
+
+				bool poll();
+
+				unsigned getSocket() const;
+
+				unsigned long getBytesSent() const;
+
+				unsigned long getBytesReceived() const;
+
+				unsigned long getPacketsSent() const;
+
+				unsigned long getPacketsReceived() const;
+
+				unsigned long getPacketsLost() const;
+
+				// Round trips measured so far, so each one is sampled once however often the RTT is read
+				unsigned long long getRTTCount() const;
+
+			private:
+				Util::UUID componentId;
+				glm::vec3 position = glm::vec3(0.0f);
+				std::atomic_ulong packetsReceived = 0UL;	// Datagrams read off the socket
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Clock.h"
+#include "TimingWheel.h"
+
+#define WHEEL_SPREAD_RATIO 0.6180339887	// Golden ratio conjugate, keeping any number of spread phases evenly apart
+
+namespace TechDemo
+{
+	namespace Util
+	{
+		uint64_t TimingWheel::add(std::chrono::milliseconds period, std::function<void()> const& callback, std::chrono::milliseconds phase)
+		{
+			State& state = getState();
+			std::lock_guard guard(state.lock);
+
+			uint32_t index;
+			if (!state.free.empty())
+			{
+				index = state.free.back();
+				state.free.pop_back();
+			}
+			else
+			{
+				index = static_cast<uint32_t>(state.timers.size());
+				state.timers.emplace_back();
+			}
+
+			Timer& timer = state.timers[index];
+			timer.period = std::max(1ULL, static_cast<unsigned long long>(period.count()));
+			timer.due = state.current + (phase.count() > 0 ? static_cast<uint64_t>(phase.count()) : timer.period);
+			timer.callback = std::make_shared<std::function<void()>>(callback);
+			timer.active = true;
+
+			link(state, index);
+
+			return getHandle(index, timer.generation);
+		}
+
+		uint64_t TimingWheel::addSpread(std::chrono::milliseconds period, std::function<void()> const& callback)
+		{
+			State& state = getState();
+			std::lock_guard guard(state.lock);
+
+			double fraction = std::fmod(static_cast<double>(state.spread++) * WHEEL_SPREAD_RATIO, 1.0);
+			auto phase = std::chrono::milliseconds(static_cast<long long>(fraction * period.count()) + 1);
+
+			return add(period, callback, phase);
+		}
+
+		void TimingWheel::remove(uint64_t timer)
+		{
+			State& state = getState();
+			std::lock_guard guard(state.lock);
+
+			Timer* entry = find(state, timer);
+			if (!entry)
+				return;
+
+			uint32_t index = static_cast<uint32_t>(timer & 0xFFFFFFFFULL);
+
+			if (entry->level != unlinked)
+				unlink(state, index);
+
+			entry->active = false;
+			entry->callback.reset();
+			++entry->generation;
+			state.free.push_back(index);
+		}
+
+		void TimingWheel::advance()
+		{
+			State& state = getState();
+			uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - state.start).count());
+
+			std::unique_lock guard(state.lock);
+
+			std::vector<uint64_t> due;
+
+			while (state.current < now)
+			{
+				++state.current;
+
+				// Cascade from the coarsest wheel which wrapped, so its timers can land in the finer wheels cascaded after it
+				unsigned wrapped = 0;
+				while (wrapped + 1 < WHEEL_LEVELS && !(state.current & ((1ULL << (WHEEL_SLOT_BITS * (wrapped + 1))) - 1)))
+					++wrapped;
+
+				for (unsigned level = wrapped; level > 0; --level)
+					cascade(state, level);
+
+				due.clear();
+
+				uint32_t& head = state.slots[0][state.current & (WHEEL_SLOTS - 1)];
+				while (head != none)
+				{
+					uint32_t index = head;
+					unlink(state, index);
+					due.push_back(getHandle(index, state.timers[index].generation));
+				}
+
+				for (uint64_t handle : due)
+				{
+					// An earlier callback may have removed it
+					Timer* timer = find(state, handle);
+					if (!timer)
+						continue;
+
+					// Callbacks may add or remove timers
+					std::shared_ptr<std::function<void()>> callback = timer->callback;
+
+					guard.unlock();
+					(*callback)();
+					guard.lock();
+
+					if ((timer = find(state, handle)))
+					{
+						// Timers which fell behind (e.g. during a long frame) skip the ticks they missed rather than bunch up
+						do
+							timer->due += timer->period;
+						while (timer->due <= state.current);
+
+						link(state, static_cast<uint32_t>(handle & 0xFFFFFFFFULL));
+					}
+				}
+			}
+		}
+
+		TimingWheel::State::State()
+		{
+			std::fill(&slots[0][0], &slots[0][0] + WHEEL_LEVELS * WHEEL_SLOTS, none);
+			clock = Clock::addClock(WHEEL_FREQUENCY, TimingWheel::advance, Clock::getMainThreadId());
+		}
+
+		TimingWheel::State::~State()
+		{
+			Clock::removeClock(clock);
+		}
+
+		uint64_t TimingWheel::getHandle(uint32_t index, uint32_t generation)
+		{
+			return (static_cast<uint64_t>(generation) << 32) | index;
+		}
+
+		TimingWheel::Timer* TimingWheel::find(State& state, uint64_t timer)
+		{
+			uint32_t index = static_cast<uint32_t>(timer & 0xFFFFFFFFULL);
+
+			if (index >= state.timers.size() || !state.timers[index].active || state.timers[index].generation != static_cast<uint32_t>(timer >> 32))
+				return nullptr;
+
+			return &state.timers[index];
+		}
+
+		void TimingWheel::link(State& state, uint32_t index)
+		{
+			Timer& timer = state.timers[index];
+
+			// Timers beyond the coarsest wheel wait in its furthest slot, and are placed again once it cascades. Those cascaded
+			// on the millisecond they are due land in the slot about to run.
+			constexpr uint64_t range = 1ULL << (WHEEL_SLOT_BITS * WHEEL_LEVELS);
+			uint64_t due = std::min(std::max(timer.due, state.current), state.current + range - 1);
+			uint64_t delta = due - state.current;
+
+			unsigned level = 0;
+			while (level + 1 < WHEEL_LEVELS && delta >= (1ULL << (WHEEL_SLOT_BITS * (level + 1))))
+				++level;
+
+			timer.level = static_cast<unsigned char>(level);
+			timer.slot = static_cast<unsigned char>((due >> (WHEEL_SLOT_BITS * level)) & (WHEEL_SLOTS - 1));
+			timer.previous = none;
+			timer.next = state.slots[level][timer.slot];
+
+			if (timer.next != none)
+				state.timers[timer.next].previous = index;
+
+			state.slots[level][timer.slot] = index;
+		}
+
+		void TimingWheel::unlink(State& state, uint32_t index)
+		{
+			Timer& timer = state.timers[index];
+
+			if (timer.previous != none)
+				state.timers[timer.previous].next = timer.next;
+			else
+				state.slots[timer.level][timer.slot] = timer.next;
+
+			if (timer.next != none)
+				state.timers[timer.next].previous = timer.previous;
+
+			timer.previous = none;
+			timer.next = none;
+			timer.level = unlinked;
+		}
+
+		void TimingWheel::cascade(State& state, unsigned level)
+		{
+			uint32_t index = state.slots[level][(state.current >> (WHEEL_SLOT_BITS * level)) & (WHEEL_SLOTS - 1)];
+
+			while (index != none)
+			{
+				uint32_t next = state.timers[index].next;
+
+				unlink(state, index);
+				link(state, index);
+
+				index = next;
+			}
+		}
+
+		TimingWheel::State& TimingWheel::getState()
+		{
+			static State state;
+			return state;
+		}
+	}
+}
\ No newline at end of file
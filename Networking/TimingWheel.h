@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define WHEEL_LEVELS 4							// Wheels of increasingly coarse slots (1 ms, 64 ms, ~4 s, ~4 min)
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1U << WHEEL_SLOT_BITS)		// Slots per wheel
+#define WHEEL_FREQUENCY 1000					// Rate (per second) the wheel is advanced from the main thread clock
+
+namespace TechDemo
+{
+	namespace Util
+	{
+		// Hierarchical timing wheel for large numbers of repeating timers, such as each connection's tick. Timers sit in
+		// millisecond slots, or in coarser wheels while they are further away (cascading down as they approach), so adding
+		// or removing one is O(1) and advancing only visits the timers which are due. Callbacks run on the main thread.
+		class TimingWheel
+		{
+			public:
+				TimingWheel() = delete;
+
+				// Calls the callback every period, the first time after the phase (or a full period without one)
+				static uint64_t add(std::chrono::milliseconds period, std::function<void()> const& callback, std::chrono::milliseconds phase = std::chrono::milliseconds(0));
+
+				// As add, with the phases of the timers added this way spread evenly across the period, so they do not all fire
+				// in the same frame
+				static uint64_t addSpread(std::chrono::milliseconds period, std::function<void()> const& callback);
+
+				static void remove(uint64_t timer);
+
+				// Runs every timer due since the last advance
+				static void advance();
+
+			private:
+				static constexpr uint32_t none = 0xFFFFFFFFU;	// End of a slot's list
+				static constexpr unsigned char unlinked = 0xFFU;
+
+				struct Timer
+				{
+					uint64_t due = 0ULL;		// Milliseconds since the wheel started
+					uint64_t period = 0ULL;
+					std::shared_ptr<std::function<void()>> callback;
+					uint32_t generation = 1U;	// Distinguishes the timers which reuse an index
+					uint32_t previous = none;
+					uint32_t next = none;
+					unsigned char level = unlinked;
+					unsigned char slot = 0U;
+					bool active = false;
+				};
+
+				struct State
+				{
+					State();
+
+					~State();
+
+					std::vector<Timer> timers;
+					std::vector<uint32_t> free;
+					uint32_t slots[WHEEL_LEVELS][WHEEL_SLOTS];	// Head of each slot's list
+					uint64_t current = 0ULL;					// Last millisecond advanced to
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					uint64_t spread = 0ULL;						// Timers added with spread phases
+					std::recursive_mutex lock;
+					long clock = 0;
+				};
+
+				static uint64_t getHandle(uint32_t index, uint32_t generation);
+
+				static Timer* find(State& state, uint64_t timer);
+
+				static void link(State& state, uint32_t index);
+
+				static void unlink(State& state, uint32_t index);
+
+				// Moves the timers in a coarse wheel's current slot down into the finer wheels
+				static void cascade(State& state, unsigned level);
+
+				static State& getState();
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+
+namespace TechDemo
+{
+	namespace Util
+	{
+		// Lock-free hand-off of the newest value from exactly one writer thread to exactly one reader thread. The writer fills
+		// its back buffer and swaps it with the middle one, and the reader swaps the middle one into its front buffer whenever
+		// it has been published since, so neither side ever waits for the other. Intermediate values may be skipped.
+		template <typename T>
+		class TripleBuffer
+		{
+			public:
+				// Writer only. The buffer to fill before the next publish, holding whatever was published three times ago.
+				T& write()
+				{
+					return buffers[back];
+				}
+
+				// Writer only
+				void publish()
+				{
+					back = middle.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+				}
+
+				// Reader only. The newest published value (or the default before the first publish).
+				T const& read()
+				{
+					if (middle.load(std::memory_order_relaxed) & fresh)
+						front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+
+					return buffers[front];
+				}
+
+			private:
+				static constexpr unsigned fresh = 4U;	// Set on the middle index when it has not been read yet
+
+				T buffers[3];
+				unsigned back = 0U;
+				alignas(64) std::atomic_uint middle = 1U;
+				alignas(64) unsigned front = 2U;
+		};
+	}
+}
\ No newline at end of file
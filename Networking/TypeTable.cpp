@@ -0,0 +1,122 @@
+#include "TypeTable.h"
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		void TypeTable::write(BitStream& stream, uint32_t hash)
+		{
+			std::unique_lock guard(lock);
+
+			auto iter = indices.find(hash);
+			if (iter != indices.end())
+			{
+				stream.writeRanged(iter->second, TYPE_TABLE_SIZE);
+				stream.write(false, 1);
+			}
+			else if (indices.size() < TYPE_TABLE_SIZE)
+			{
+				uint32_t index = static_cast<uint32_t>(indices.size());
+				indices.emplace(hash, index);
+
+				stream.writeRanged(index, TYPE_TABLE_SIZE);
+				stream.write(true, 1);
+				stream.write(hash);
+			}
+			else
+			{
+				guard.unlock();
+				writeInline(stream, hash);
+			}
+		}
+
+		void TypeTable::writeInline(BitStream& stream, uint32_t hash)
+		{
+			stream.writeRanged(TYPE_TABLE_SIZE, TYPE_TABLE_SIZE);
+			stream.write(hash);
+		}
+
+		void TypeTable::read(BitStream& stream, Entry& entry)
+		{
+			stream.readRanged(entry.index, TYPE_TABLE_SIZE);
+
+			entry.defined = entry.index == TYPE_TABLE_SIZE;
+			if (!entry.defined)
+				stream.read(entry.defined, 1);
+
+			if (entry.defined)
+				stream.read(entry.hash);
+		}
+
+		void TypeTable::resolve(std::vector<Entry> const& entries, std::function<void(std::vector<uint32_t> const&)> const& callback)
+		{
+			std::vector<uint32_t> resolved;
+			bool ready = false;
+			std::vector<std::pair<std::function<void(std::vector<uint32_t> const&)>, std::vector<uint32_t>>> woken;
+
+			{
+				std::lock_guard guard(lock);
+
+				bool defines = false;
+				for (auto const& entry : entries)
+				{
+					if (entry.defined && entry.index < TYPE_TABLE_SIZE)
+					{
+						hashes[entry.index] = entry.hash;
+						defines = true;
+					}
+				}
+
+				if (defines)
+				{
+					for (auto iter = waiting.begin(); iter != waiting.end();)
+					{
+						std::vector<uint32_t> waiterHashes;
+
+						if (lookup(iter->entries, waiterHashes))
+						{
+							woken.emplace_back(std::move(iter->callback), std::move(waiterHashes));
+							iter = waiting.erase(iter);
+						}
+						else
+							++iter;
+					}
+				}
+
+				ready = lookup(entries, resolved);
+				if (!ready)
+					waiting.push_back(Waiter{ entries, callback });
+			}
+
+			// Called without the lock, so that callbacks may use the table
+			if (ready)
+				callback(resolved);
+
+			for (auto const& waiter : woken)
+				waiter.first(waiter.second);
+		}
+
+		bool TypeTable::lookup(std::vector<Entry> const& entries, std::vector<uint32_t>& result) const
+		{
+			result.clear();
+			result.reserve(entries.size());
+
+			for (auto const& entry : entries)
+			{
+				if (entry.index >= TYPE_TABLE_SIZE || entry.defined)
+				{
+					result.push_back(entry.hash);
+					continue;
+				}
+
+				auto iter = hashes.find(entry.index);
+				if (iter == hashes.end())
+					return false;
+
+				result.push_back(iter->second);
+			}
+
+			return true;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BitStream.h"
+
+#define TYPE_TABLE_SIZE 255	// Entries per direction of a connection; the index past the last marks a hash sent inline
+
+namespace TechDemo
+{
+	namespace IO
+	{
+		// Dictionary for the component type hashes a connection's spawns carry, kept per connection rather than derived from
+		// the registered types, as builds may register different ones. Works as StringTable does: the first time a type is
+		// written its full hash is sent along with the index it was entered at, and after that only the index is.
+		class TypeTable
+		{
+			public:
+				struct Entry
+				{
+					uint32_t index = TYPE_TABLE_SIZE;
+					bool defined = false;	// Whether the hash was sent, rather than just the index
+					uint32_t hash = 0U;
+				};
+
+				// Writes the type's index, preceded by its hash the first time
+				void write(BitStream& stream, uint32_t hash);
+
+				// Writes the hash inline, for packets serialized without a connection's table
+				static void writeInline(BitStream& stream, uint32_t hash);
+
+				static void read(BitStream& stream, Entry& entry);
+
+				// Enters any hashes the entries carry, and calls back with every entry's hash. Entries only referring to an index
+				// are held until the packets defining them have arrived, as reliable packets may be handled out of order.
+				void resolve(std::vector<Entry> const& entries, std::function<void(std::vector<uint32_t> const&)> const& callback);
+
+			private:
+				struct Waiter
+				{
+					std::vector<Entry> entries;
+					std::function<void(std::vector<uint32_t> const&)> callback;
+				};
+
+				// Returns false if any entry's index is not yet defined. Expects the lock to be held.
+				bool lookup(std::vector<Entry> const& entries, std::vector<uint32_t>& result) const;
+
+				std::unordered_map<uint32_t, uint32_t> indices;	// Sending side
+				std::unordered_map<uint32_t, uint32_t> hashes;	// Receiving side
+				std::list<Waiter> waiting;
+				std::mutex lock;
+		};
+	}
+}
\ No newline at end of file